@@ -0,0 +1,105 @@
+// Measures add, call and disconnect performance of the callback classes.
+// Build with optimizations, e.g.
+// g++ -std=c++17 -O2 -I../.. callback.cpp
+
+#include <nytl/callback.hpp>
+#include <nytl/recursiveCallback.hpp>
+#include <nytl/slotCallback.hpp>
+
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <type_traits>
+
+// Returns the best time of the given function in nanoseconds.
+template<typename F>
+double measure(F&& func) {
+	constexpr auto runs = 10u;
+	auto best = 1e300;
+	for(auto r = 0u; r < runs; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		func();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+	}
+
+	return best;
+}
+
+template<typename CB> struct IsRecursive : std::false_type {};
+template<typename S, typename ID>
+struct IsRecursive<nytl::RecursiveCallback<S, ID>> : std::true_type {};
+
+template<typename CB>
+void bench(const char* name, unsigned count) {
+	constexpr auto calls = 100u;
+
+	std::printf("%s (%u handlers)\n", name, count);
+	unsigned long long sum {};
+
+	auto ns = measure([&]{
+		CB cb;
+		for(auto i = 0u; i < count; ++i) {
+			cb.add([&sum, i]{ sum += i; });
+		}
+	});
+	std::printf("  add:        %8.2f ns/handler\n", ns / count);
+
+	CB cb;
+	std::vector<typename CB::Connection> conns;
+	for(auto i = 0u; i < count; ++i) {
+		conns.push_back(cb.add([&sum, i]{ sum += i; }));
+	}
+
+	ns = measure([&]{
+		for(auto i = 0u; i < calls; ++i) {
+			cb();
+		}
+	});
+	std::printf("  call:       %8.2f ns/handler\n", ns / (calls * count));
+
+	// disconnect in an order that isn't favorable for any storage
+	ns = measure([&]{
+		CB cb;
+		std::vector<typename CB::Connection> conns;
+		for(auto i = 0u; i < count; ++i) {
+			conns.push_back(cb.add([&sum, i]{ sum += i; }));
+		}
+
+		for(auto i = 0u; i < count; i += 2) {
+			conns[i].disconnect();
+		}
+
+		for(auto i = count; i-- > 0;) {
+			conns[i].disconnect();
+		}
+	});
+	std::printf("  add + disconnect: %8.2f ns/handler\n", ns / count);
+
+	// recursive scenario for callbacks supporting it: disconnect from within
+	if constexpr(IsRecursive<CB>::value) {
+		ns = measure([&]{
+			CB cb;
+			for(auto i = 0u; i < count; ++i) {
+				cb.add([&sum, i](auto conn){ sum += i; conn.disconnect(); });
+			}
+			cb();
+		});
+		std::printf("  add + recursive disconnect: %8.2f ns/handler\n", ns / count);
+	}
+
+	std::printf("  (%llu)\n", sum % 10);
+}
+
+int main() {
+	for(auto count : {16u, 1024u, 16 * 1024u}) {
+		bench<nytl::Callback<void()>>("Callback", count);
+		bench<nytl::SlotCallback<void()>>("SlotCallback", count);
+		bench<nytl::RecursiveCallback<void()>>("RecursiveCallback", count);
+		bench<nytl::TrackedCallback<void()>>("TrackedCallback", count);
+		bench<nytl::PooledCallback<void()>>("PooledCallback", count);
+		bench<nytl::TrackedRecursiveCallback<void()>>("TrackedRecursiveCallback", count);
+		bench<nytl::PooledRecursiveCallback<void()>>("PooledRecursiveCallback", count);
+	}
+}
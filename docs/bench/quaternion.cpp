@@ -0,0 +1,100 @@
+// Compares accuracy and throughput of the quaternion interpolation functions.
+// Build with optimizations and NYTL_SIMD, e.g.
+// g++ -std=c++17 -O2 -march=native -DNYTL_SIMD -I../.. quaternion.cpp
+
+#include <nytl/quaternion.hpp>
+
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+template<typename P>
+std::vector<nytl::QuaternionT<P>> randomQuats(std::size_t count, std::uint32_t& seed) {
+	auto rand = [&]{
+		seed = seed * 1664525u + 1013904223u;
+		return double(seed >> 8) / double(1u << 23) - 1.0;
+	};
+
+	std::vector<nytl::QuaternionT<P>> ret;
+	ret.reserve(count);
+	for(auto i = 0u; i < count; ++i) {
+		ret.push_back(nytl::normalized(nytl::QuaternionT<P>{
+			P(rand()), P(rand()), P(rand()), P(rand())}));
+	}
+
+	return ret;
+}
+
+// Returns the average time per quaternion in nanoseconds.
+template<typename F>
+double measure(std::size_t count, F&& func) {
+	constexpr auto runs = 20u;
+	auto best = 1e300;
+	for(auto r = 0u; r < runs; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		func();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+	}
+
+	return best / count;
+}
+
+template<typename P>
+void bench(const char* name) {
+	constexpr auto count = 64 * 1024u;
+	std::uint32_t seed = 42u;
+	auto a = randomQuats<P>(count, seed);
+	auto b = randomQuats<P>(count, seed);
+	std::vector<P> t(count);
+	for(auto i = 0u; i < count; ++i) {
+		t[i] = P(i % 1024) / P(1023);
+	}
+
+	nytl::span<const nytl::QuaternionT<P>> sa(a);
+	nytl::span<const nytl::QuaternionT<P>> sb(b);
+	nytl::span<const P> st(t);
+	std::vector<nytl::QuaternionT<P>> ref(count);
+	std::vector<nytl::QuaternionT<P>> out(count);
+
+	// reference: the exact scalar slerp, computed in double precision
+	auto angleError = [&]{
+		auto ret = 0.0;
+		for(auto i = 0u; i < count; ++i) {
+			auto r = nytl::normalized(nytl::slerp(
+				static_cast<nytl::Quaternion>(a[i]),
+				static_cast<nytl::Quaternion>(b[i]), double(t[i])));
+			auto d = std::min(1.0, std::abs(nytl::dot(r, static_cast<nytl::Quaternion>(out[i]))));
+			ret = std::max(ret, 2 * std::acos(d));
+		}
+		return ret;
+	};
+
+	std::printf("%s (%u quaternions)\n", name, count);
+
+	auto ns = measure(count, [&]{
+		for(auto i = 0u; i < count; ++i) {
+			out[i] = nytl::slerp(a[i], b[i], t[i]);
+		}
+	});
+	std::printf("  slerp (scalar loop): %6.2f ns/quat, max error %.2e rad\n", ns, angleError());
+
+	ns = measure(count, [&]{ nytl::slerp(sa, sb, st, out); });
+	std::printf("  slerp (batch):       %6.2f ns/quat, max error %.2e rad\n", ns, angleError());
+
+	ns = measure(count, [&]{ nytl::slerpFast(sa, sb, st, out); });
+	std::printf("  slerpFast (batch):   %6.2f ns/quat, max error %.2e rad\n", ns, angleError());
+
+	ns = measure(count, [&]{ nytl::slerpFast(sa, sb, P(0.3), out); });
+	std::printf("  slerpFast (batch, shared t): %6.2f ns/quat\n", ns);
+
+	ns = measure(count, [&]{ nytl::nlerp(sa, sb, st, out); });
+	std::printf("  nlerp (batch):       %6.2f ns/quat, max error %.2e rad\n", ns, angleError());
+}
+
+int main() {
+	bench<float>("Quaternionf");
+	bench<double>("Quaternion");
+}
@@ -0,0 +1,268 @@
+// NYTL_TEST_CXX20: requires coroutines
+#include "test.hpp"
+#include <nytl/awaitableCallback.hpp>
+#include <nytl/parallel.hpp>
+#include <nytl/inplaceFunction.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+
+// Minimal eager coroutine type that is destroyed on completion
+struct Task {
+	struct promise_type {
+		Task get_return_object() {
+			return {std::coroutine_handle<promise_type>::from_promise(*this)};
+		}
+
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+// Counts allocations of coroutine frames
+static unsigned frameCount = 0u;
+struct CountedTask : Task {
+	struct promise_type : Task::promise_type {
+		CountedTask get_return_object() {
+			return {{std::coroutine_handle<Task::promise_type>::from_promise(*this)}};
+		}
+
+		static void* operator new(std::size_t size) {
+			++frameCount;
+			return ::operator new(size);
+		}
+
+		static void operator delete(void* ptr) {
+			::operator delete(ptr);
+		}
+	};
+};
+
+TEST(basic) {
+	nytl::AwaitableCallback<void(int, const std::string&)> cb;
+	auto called = 0u;
+	cb.add([&](int, const std::string&) { ++called; });
+
+	std::vector<int> vals;
+	std::string last;
+	auto loop = [&]() -> Task {
+		while(true) {
+			auto [i, str] = co_await cb.next();
+			vals.push_back(i);
+			last = str;
+			if(i < 0) {
+				co_return;
+			}
+		}
+	};
+
+	EXPECT(cb.awaited(), false);
+	loop();
+	EXPECT(cb.awaited(), true);
+	EXPECT(vals.size(), 0u);
+
+	cb(1, "a");
+	EXPECT(called, 1u);
+	EXPECT(vals.size(), 1u);
+	EXPECT(vals[0], 1);
+	EXPECT(last, "a");
+
+	cb(2, "bc");
+	EXPECT(vals.size(), 2u);
+	EXPECT(last, "bc");
+
+	cb(-1, "");
+	EXPECT(vals.size(), 3u);
+	EXPECT(cb.awaited(), false);
+
+	cb(3, "");
+	EXPECT(vals.size(), 3u);
+	EXPECT(called, 4u);
+}
+
+TEST(order) {
+	// waiters are resumed in order, waiters added while resuming
+	// are resumed on the next call
+	nytl::AwaitableCallback<void()> cb;
+	std::vector<int> order;
+	auto wait = [&](int id, unsigned count) -> Task {
+		for(auto i = 0u; i < count; ++i) {
+			co_await cb.next();
+			order.push_back(id);
+		}
+	};
+
+	wait(1, 2);
+	wait(2, 1);
+	wait(3, 2);
+
+	cb();
+	EXPECT(order.size(), 3u);
+	EXPECT(order[0], 1);
+	EXPECT(order[1], 2);
+	EXPECT(order[2], 3);
+
+	order.clear();
+	cb();
+	EXPECT(order.size(), 2u);
+	EXPECT(order[0], 1);
+	EXPECT(order[1], 3);
+	EXPECT(cb.awaited(), false);
+}
+
+TEST(handler) {
+	// waiters started from a registered function are resumed
+	// on the next call, not the current one
+	nytl::AwaitableCallback<void(int)> cb;
+	std::vector<int> vals;
+	auto wait = [&]() -> Task {
+		vals.push_back(co_await cb.next());
+	};
+
+	auto started = false;
+	auto conn = cb.add([&](int) {
+		if(!started) {
+			started = true;
+			wait();
+		}
+	});
+
+	cb(1);
+	EXPECT(vals.size(), 0u);
+	EXPECT(cb.awaited(), true);
+
+	cb(2);
+	EXPECT(vals.size(), 1u);
+	EXPECT(vals[0], 2);
+	EXPECT(cb.awaited(), false);
+
+	// a throwing function resumes neither the waiters that were awaiting
+	// nor the ones started from it
+	conn.disconnect();
+	vals.clear();
+	wait();
+	auto throwConn = cb.add([&](int) {
+		wait();
+		throw 42;
+	});
+
+	ERROR(cb(3), int);
+	EXPECT(vals.size(), 0u);
+
+	throwConn.disconnect();
+	cb(4);
+	EXPECT(vals.size(), 2u);
+	EXPECT(vals[0], 4);
+	EXPECT(vals[1], 4);
+}
+
+TEST(destroy) {
+	// destroying a suspended coroutine unlinks it
+	nytl::AwaitableCallback<int(int)> cb;
+	cb.add([](int x) { return 2 * x; });
+
+	std::vector<int> vals;
+	auto wait = [&]() -> Task {
+		vals.push_back(co_await cb.next());
+	};
+
+	auto t1 = wait();
+	auto t2 = wait();
+	auto t3 = wait();
+	t2.handle.destroy();
+
+	auto ret = cb(5);
+	EXPECT(ret.size(), 1u);
+	EXPECT(ret[0], 10);
+	EXPECT(vals.size(), 2u);
+	EXPECT(vals[0], 5);
+	EXPECT(vals[1], 5);
+	(void) t1;
+	(void) t3;
+
+	// resumed coroutine destroying another one
+	Task other;
+	auto killer = [&]() -> Task {
+		co_await cb.next();
+		other.handle.destroy();
+	};
+
+	vals.clear();
+	killer();
+	other = wait();
+	cb(1);
+	EXPECT(vals.size(), 0u);
+	EXPECT(cb.awaited(), false);
+
+	// destroying the callback first
+	auto dcb = std::make_unique<nytl::AwaitableCallback<void()>>();
+	auto dwait = [&]() -> Task { co_await dcb->next(); };
+	auto dt = dwait();
+	dcb.reset();
+	dt.handle.destroy();
+}
+
+TEST(allocation) {
+	// awaiting and resuming does not allocate beyond the frame
+	nytl::AwaitableCallback<void(int), nytl::ConnectionID, nytl::InplaceFunction> cb;
+	auto sum = 0;
+	auto loop = [&]() -> CountedTask {
+		for(auto i = 0; i < 100; ++i) {
+			sum += co_await cb.next();
+		}
+	};
+
+	loop();
+	EXPECT(frameCount, 1u);
+	for(auto i = 0; i < 100; ++i) {
+		cb(i);
+	}
+
+	EXPECT(sum, 99 * 50);
+	EXPECT(frameCount, 1u);
+}
+
+TEST(executor) {
+	nytl::AwaitableCallback<void(int)> cb;
+	std::vector<std::coroutine_handle<>> scheduled;
+	cb.executor([&](std::coroutine_handle<> h) { scheduled.push_back(h); });
+
+	auto got = 0;
+	auto wait = [&]() -> Task { got = co_await cb.next(); };
+	wait();
+	cb(7);
+	EXPECT(got, 0);
+	EXPECT(scheduled.size(), 1u);
+	scheduled[0].resume();
+	EXPECT(got, 7);
+
+	// resume on a thread pool
+	nytl::ThreadPool pool(1);
+	cb.executor([&](std::coroutine_handle<> h) { pool.enqueue([h]{ h.resume(); }); });
+
+	std::atomic<bool> done {false};
+	std::thread::id resumer;
+	auto poolWait = [&]() -> Task {
+		got = co_await cb.next();
+		resumer = std::this_thread::get_id();
+		done.store(true);
+	};
+
+	poolWait();
+	cb(42);
+	while(!done.load()) {
+		std::this_thread::yield();
+	}
+
+	EXPECT(got, 42);
+	EXPECT(resumer != std::this_thread::get_id(), true);
+}
@@ -1,6 +1,15 @@
 #include "test.hpp"
 #include <nytl/callback.hpp>
+#include <nytl/inplaceFunction.hpp>
+#include <nytl/collector.hpp>
 #include <nytl/tmpUtil.hpp>
+#include <nytl/flags.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <functional>
 
 
 // TODO: more testing with custom id type and stuff
@@ -104,4 +113,163 @@ TEST(tracked) {
 	}
 
 	EXPECT(conn.connected(), false);
-}
\ No newline at end of file
+}
+template<typename S> using SmallFunction = nytl::InplaceFunction<S, 16>;
+
+TEST(inplace) {
+	nytl::Callback<int(int), nytl::ConnectionID, SmallFunction> cb;
+	auto offset = 2;
+	cb += [offset](int x) { return x + offset; };
+	auto ptr = std::make_unique<int>(3);
+	auto conn = cb.add([p = std::move(ptr)](int x) { return x * *p; });
+
+	auto ret = cb(5);
+	EXPECT(ret.size(), 2u);
+	EXPECT(ret[0], 7);
+	EXPECT(ret[1], 15);
+
+	conn.disconnect();
+	EXPECT(cb(1).size(), 1u);
+	ERROR(cb.add(nullptr), std::invalid_argument);
+
+	// works with templates that have additional default arguments as well
+	nytl::Callback<void(), nytl::TrackedConnectionID, nytl::InplaceFunction> tcb;
+	auto called = 0u;
+	auto tconn = tcb.add([&]{ ++called; });
+	tcb();
+	EXPECT(called, 1u);
+	tconn.disconnect();
+	tcb();
+	EXPECT(called, 1u);
+}
+
+TEST(collect) {
+	nytl::Callback<int(int)> cb;
+	auto called = 0u;
+	cb.add([&](int x) { ++called; return x; });
+	cb.add([&](int x) { ++called; return 2 * x; });
+	cb.add([&](int x) { ++called; return x - 3; });
+
+	EXPECT(cb.collect(nytl::Fold<int>{10}, 3).value, 10 + 3 + 6 + 0);
+	EXPECT(called, 3u);
+	EXPECT((cb.collect(nytl::Fold<int, std::multiplies<>>{1}, 4).value), 4 * 8 * 1);
+
+	// short-circuiting
+	called = 0u;
+	EXPECT(*cb.collect(nytl::FirstValue<int>{}, 5).value, 5);
+	EXPECT(called, 1u);
+	EXPECT(*cb.collect(nytl::LastValue<int>{}, 5).value, 2);
+
+	called = 0u;
+	EXPECT(cb.collect(nytl::AllOf{}, 3).value, false);
+	EXPECT(called, 3u);
+	called = 0u;
+	EXPECT(cb.collect(nytl::AllOf{}, 0).value, false);
+	EXPECT(called, 1u);
+	called = 0u;
+	EXPECT(cb.collect(nytl::AnyOf{}, 3).value, true);
+	EXPECT(called, 1u);
+	EXPECT(cb.collect(nytl::AnyOf{}, 0).value, true);
+
+	std::vector<int> vec;
+	cb.collect(nytl::collectInto(std::back_inserter(vec)), 1);
+	EXPECT(vec.size(), 3u);
+	EXPECT(vec[2], -2);
+
+	// custom collector
+	auto count = 0u;
+	cb.collect([&](int val) { ++count; return val < 10; }, 6);
+	EXPECT(count, 2u);
+
+	nytl::Callback<const char*()> names;
+	names.add([]() -> const char* { return nullptr; });
+	names.add([]{ return "second"; });
+	names.add([]{ return "third"; });
+	EXPECT(std::string(names.collect(nytl::FirstNonEmpty<const char*>{}).value), "second");
+
+	nytl::Callback<int()> empty;
+	EXPECT(empty.collect(nytl::AllOf{}).value, true);
+	EXPECT(empty.collect(nytl::AnyOf{}).value, false);
+	EXPECT(empty.collect(nytl::FirstValue<int>{}).value.has_value(), false);
+}
+
+enum class Input {
+	key = 1,
+	mouse = 2,
+	touch = 4,
+};
+
+NYTL_FLAG_OPS(Input)
+
+TEST(priority) {
+	nytl::Callback<void(std::vector<int>&)> cb;
+	auto push = [](int i) { return [i](auto& vec) { vec.push_back(i); }; };
+	auto c1 = cb.add(push(1));
+	auto c2 = cb.add(push(2), 10);
+	auto c3 = cb.add(push(3), -5);
+	auto c4 = cb.add(push(4), 10);
+	auto c5 = cb.add(push(5));
+
+	std::vector<int> vec;
+	cb(vec);
+	EXPECT(vec.size(), 5u);
+	EXPECT(vec[0], 2);
+	EXPECT(vec[1], 4);
+	EXPECT(vec[2], 1);
+	EXPECT(vec[3], 5);
+	EXPECT(vec[4], 3);
+
+	// disconnect works independent of order
+	EXPECT(cb.disconnect(c4.id()), true);
+	EXPECT(cb.disconnect(c4.id()), false);
+	EXPECT(cb.disconnect(c1.id()), true);
+	EXPECT(cb.disconnect(c3.id()), true);
+	EXPECT(cb.disconnect(c2.id()), true);
+	EXPECT(cb.subscriptions().size(), 1u);
+	EXPECT(cb.disconnect(c5.id()), true);
+	EXPECT(cb.subscriptions().size(), 0u);
+}
+
+TEST(filter) {
+	nytl::Callback<int(int)> cb;
+	auto called = 0u;
+	cb.add([&](int i) { ++called; return i; });
+	cb.add([&](int i) { ++called; return 2 * i; }, 0,
+		nytl::Flags<Input>(Input::key).value());
+	cb.add([&](int i) { ++called; return 3 * i; }, 1,
+		Input::mouse | Input::touch);
+
+	EXPECT(cb(1).size(), 3u);
+	EXPECT(called, 3u);
+
+	called = 0u;
+	auto ret = cb.callFiltered(Input::key | Input::touch, 1);
+	EXPECT(called, 3u);
+	EXPECT(ret.size(), 3u);
+	EXPECT(ret[0], 3);
+	EXPECT(ret[2], 2);
+
+	called = 0u;
+	ret = cb.callFiltered(nytl::Flags<Input>(Input::mouse), 1);
+	EXPECT(called, 2u);
+	EXPECT(ret.size(), 2u);
+	EXPECT(ret[0], 3);
+	EXPECT(ret[1], 1);
+
+	called = 0u;
+	EXPECT(cb.collectFiltered(nytl::Fold<int>{}, 1u << 0, 2).value, 2 + 4);
+	EXPECT(called, 2u);
+	EXPECT(cb.callFiltered(0u, 1).size(), 0u);
+
+	// integral topics, one bit per topic
+	nytl::Callback<void()> topics;
+	auto count = 0u;
+	for(auto i = 0u; i < 64u; ++i) {
+		topics.add([&]{ ++count; }, 0, std::uint64_t(1) << i);
+	}
+
+	topics.callFiltered(std::uint64_t(1) << 63);
+	EXPECT(count, 1u);
+	topics.callFiltered(decltype(topics)::anyFilter);
+	EXPECT(count, 65u);
+}
@@ -0,0 +1,128 @@
+#include "test.hpp"
+#include <nytl/concurrentCallback.hpp>
+#include <nytl/inplaceFunction.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// basic connection and callback functionality, same as for Callback
+TEST(basic) {
+	nytl::ConcurrentCallback<void()> cb;
+	auto called = 0u;
+	cb();
+	EXPECT(called, 0u);
+
+	auto inc = [&]{ ++called; };
+	cb += inc;
+	cb.add(inc);
+	cb();
+	EXPECT(called, 2u);
+	EXPECT(cb.size(), 2u);
+
+	called = 0u;
+	cb = inc;
+	cb();
+	EXPECT(called, 1u);
+
+	called = 0u;
+	cb.clear();
+	cb();
+	EXPECT(called, 0u);
+	EXPECT(cb.size(), 0u);
+
+	auto conn1 = cb.add(inc);
+	cb();
+	EXPECT(called, 1u);
+	conn1.disconnect();
+	cb();
+	EXPECT(called, 1u);
+	EXPECT(cb.disconnect({42}), false);
+
+	ERROR(cb.add(std::function<void()>{}), std::invalid_argument);
+	ERROR(cb += std::function<void()>{}, std::invalid_argument);
+
+	nytl::ConcurrentCallback<int(int), nytl::ConnectionID, nytl::InplaceFunction> rcb;
+	rcb.add([](int x) { return x + 1; });
+	rcb.add([](int x) { return 2 * x; });
+	auto ret = rcb(3);
+	EXPECT(ret.size(), 2u);
+	EXPECT(ret[0], 4);
+	EXPECT(ret[1], 6);
+}
+
+TEST(recursive) {
+	// modifications from within a call don't affect the running call
+	nytl::TrackedConcurrentCallback<void()> cb;
+	auto called = 0u;
+	nytl::TrackedConnection conn2;
+	cb.add([&]{
+		++called;
+		cb.add([&]{ ++called; });
+		conn2.disconnect();
+	});
+	conn2 = cb.add([&]{ ++called; });
+
+	cb();
+	EXPECT(called, 2u);
+	EXPECT(conn2.connected(), false);
+	EXPECT(cb.size(), 2u);
+
+	called = 0u;
+	cb.add([&]{ cb.clear(); });
+	cb();
+	EXPECT(called, 2u);
+	EXPECT(cb.size(), 0u);
+
+	// exceptions
+	cb.add([&]{ throw 42; });
+	ERROR(cb(), int);
+	cb.clear();
+	cb();
+}
+
+TEST(threads) {
+	constexpr auto threadCount = 4u;
+	constexpr auto iterations = 2000u;
+
+	nytl::ConcurrentCallback<void(std::atomic<unsigned>&)> cb;
+	cb.add([](std::atomic<unsigned>& count) { ++count; });
+
+	// emitters, all handlers registered at any time increase count
+	std::atomic<bool> done {};
+	std::atomic<unsigned> count {};
+	std::vector<std::thread> threads;
+	for(auto i = 0u; i < threadCount; ++i) {
+		threads.emplace_back([&]{
+			// call at least once, the thread might only be scheduled
+			// after the modifications are done
+			do {
+				std::atomic<unsigned> local {};
+				cb(local);
+				EXPECT(local.load() >= 1u, true);
+				count += local.load();
+			} while(!done.load());
+		});
+	}
+
+	// modifier thread, also modifies from within calls
+	for(auto i = 0u; i < iterations; ++i) {
+		auto conn = cb.add([](std::atomic<unsigned>& count) { ++count; });
+		if(i % 100 == 0) {
+			cb.add([&cb](std::atomic<unsigned>& count) {
+				++count;
+				cb.add([](std::atomic<unsigned>&) {}).disconnect();
+			});
+		}
+
+		conn.disconnect();
+	}
+
+	done.store(true);
+	for(auto& thread : threads) {
+		thread.join();
+	}
+
+	EXPECT(cb.size(), 1u + iterations / 100);
+	EXPECT(count.load() > 0u, true);
+}
@@ -1,6 +1,7 @@
 #include "test.hpp"
 #include <nytl/connection.hpp>
 #include <nytl/callback.hpp>
+#include <nytl/recursiveCallback.hpp>
 
 TEST(basic) {
 	nytl::Connection basic;
@@ -34,3 +35,65 @@ TEST(tracked) {
 	EXPECT(tracked.connected(), false);
 	EXPECT(trackedCopy.connected(), false);
 }
+
+TEST(pooled) {
+	nytl::PooledConnectionID empty;
+	EXPECT(empty.get(), 0);
+	empty.removed();
+
+	nytl::PooledConnection conn;
+	nytl::PooledConnection copy;
+
+	{
+		nytl::PooledCallback<void()> cb;
+		conn = cb.add([]{});
+		copy = conn;
+		EXPECT(conn.connected(), true);
+		EXPECT(copy.connected(), true);
+		EXPECT(conn.id().get(), copy.id().get());
+
+		// disconnecting from a copy is seen by all copies
+		auto other = cb.add([]{});
+		auto otherCopy = other;
+		otherCopy.disconnect();
+		EXPECT(other.connected(), false);
+		EXPECT(conn.connected(), true);
+
+		// the entry is reused but old copies stay disconnected
+		auto reused = cb.add([]{});
+		EXPECT(reused.id().entry, other.id().entry);
+		EXPECT(reused.connected(), true);
+		EXPECT(other.connected(), false);
+		EXPECT(cb.disconnect(other.id()), false);
+
+		// clear
+		cb.clear();
+		EXPECT(reused.connected(), false);
+		conn = cb.add([]{});
+		copy = conn;
+	}
+
+	EXPECT(conn.connected(), false);
+	EXPECT(copy.connected(), false);
+
+	// recursive callback, removal deferred while iterating
+	nytl::PooledRecursiveCallback<void()> rcb;
+	auto called = 0u;
+	nytl::PooledConnection rconn;
+	rconn = rcb.add([&]{ ++called; rconn.disconnect(); EXPECT(rconn.connected(), false); });
+	auto rcopy = rconn;
+	rcb();
+	rcb();
+	EXPECT(called, 1u);
+	EXPECT(rcopy.connected(), false);
+
+	// works with the other id types as expected
+	nytl::UniqueConnectionT<nytl::PooledConnectable, nytl::PooledConnectionID> unique;
+	{
+		nytl::Callback<void(), nytl::PooledConnectionID> cb;
+		unique = cb.add([]{});
+		EXPECT(unique.connected(), true);
+		unique = {};
+		EXPECT(cb.disconnect(copy.id()), false);
+	}
+}
@@ -0,0 +1,200 @@
+#include "test.hpp"
+
+#include <nytl/dynMatOps.hpp>
+#include <nytl/dynMat.hpp>
+#include <nytl/matOps.hpp>
+#include <nytl/mat.hpp>
+#include <nytl/approx.hpp>
+#include <nytl/approxVec.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+// deterministic pseudo-random matrix with values in [-1, 1]
+nytl::DynMat<double> randomMat(std::size_t rows, std::size_t cols, std::uint32_t seed) {
+	nytl::DynMat<double> ret(rows, cols);
+	for(auto i = 0u; i < ret.size(); ++i) {
+		seed = seed * 1664525u + 1013904223u;
+		ret.data()[i] = double(seed >> 8) / double(1u << 23) - 1.0;
+	}
+
+	return ret;
+}
+
+double maxDiff(const nytl::DynMat<double>& a, const nytl::DynMat<double>& b) {
+	EXPECT(a.rows(), b.rows());
+	EXPECT(a.cols(), b.cols());
+	auto ret = 0.0;
+	for(auto i = 0u; i < a.size(); ++i) {
+		ret = std::max(ret, std::abs(a.data()[i] - b.data()[i]));
+	}
+
+	return ret;
+}
+
+nytl::DynMat<double> naiveMul(const nytl::DynMat<double>& a, const nytl::DynMat<double>& b) {
+	nytl::DynMat<double> ret(a.rows(), b.cols());
+	for(auto r = 0u; r < a.rows(); ++r) {
+		for(auto c = 0u; c < b.cols(); ++c) {
+			for(auto k = 0u; k < a.cols(); ++k) {
+				ret(r, c) += a(r, k) * b(k, c);
+			}
+		}
+	}
+
+	return ret;
+}
+
+TEST(basic) {
+	nytl::DynMat<float> a(3, 5, 1.f);
+	EXPECT(a.rows(), 3u);
+	EXPECT(a.cols(), 5u);
+	EXPECT(reinterpret_cast<std::uintptr_t>(a.data()) % 64, 0u);
+	EXPECT(a[2].size(), 5u);
+	EXPECT(a(2, 4), 1.f);
+	EXPECT(&a(1, 0), a.data() + 5);
+	ERROR(a.at(3, 0), std::out_of_range);
+
+	nytl::Mat<2, 3, int> m {1, 2, 3, 4, 5, 6};
+	auto dm = nytl::DynMat<int>(m);
+	EXPECT(dm(1, 2), 6);
+	EXPECT((static_cast<nytl::Mat<2, 3, int>>(dm)), m);
+	ERROR((static_cast<nytl::Mat<3, 2, int>>(dm)), std::invalid_argument);
+
+	auto t = nytl::transpose(dm);
+	EXPECT(t.rows(), 3u);
+	EXPECT(t(2, 1), 6);
+	EXPECT((static_cast<nytl::Mat<3, 2, int>>(t)), nytl::transpose(m));
+
+	EXPECT(dm + dm, 2 * dm);
+	EXPECT(dm - dm, nytl::DynMat<int>(2, 3));
+	ERROR(dm + t, std::invalid_argument);
+	ERROR(dm * dm, std::invalid_argument);
+	EXPECT((static_cast<nytl::Mat<2, 2, int>>(dm * t)), m * nytl::transpose(m));
+}
+
+TEST(multiply) {
+	auto a = randomMat(70, 300, 1u);
+	auto b = randomMat(300, 270, 2u);
+	auto ref = naiveMul(a, b);
+	EXPECT(maxDiff(a * b, ref) < 1e-10, true);
+
+	nytl::ThreadPool pool(3);
+	EXPECT(maxDiff(nytl::multiply(pool, a, b), ref) < 1e-10, true);
+}
+
+TEST(transpose) {
+	auto check = [](const auto& mat, const auto& t) {
+		EXPECT(t.rows(), mat.cols());
+		EXPECT(t.cols(), mat.rows());
+		for(auto r = 0u; r < mat.rows(); ++r) {
+			for(auto c = 0u; c < mat.cols(); ++c) {
+				EXPECT(t(c, r), mat(r, c));
+			}
+		}
+	};
+
+	// sizes that aren't multiples of the tile and block sizes
+	auto big = randomMat(70, 37, 3u);
+	check(big, nytl::transpose(big));
+	EXPECT(nytl::transpose(nytl::transpose(big)), big);
+
+	auto bigf = nytl::DynMat<float>(randomMat(41, 66, 4u));
+	check(bigf, nytl::transpose(bigf));
+
+	nytl::ThreadPool pool(3);
+	check(bigf, nytl::transpose(pool, bigf));
+}
+
+TEST(echolon) {
+	nytl::Mat<3, 4, double> m {
+		1, 2, -1, -4,
+		2, 3, -1, -11,
+		-2, 0, -3, 22
+	};
+
+	auto dm = nytl::DynMat<double>(m);
+	nytl::reducedRowEcholon(dm);
+	nytl::reducedRowEcholon(m);
+
+	nytl::Mat<3, 4, double> expected {
+		1, 0, 0, -8,
+		0, 1, 0, 1,
+		0, 0, 1, -2
+	};
+
+	EXPECT(static_cast<decltype(m)>(dm), nytl::approx(expected));
+	EXPECT(m, nytl::approx(expected));
+
+	// zero column and rank deficiency
+	nytl::Mat<3, 3, double> s {
+		0, 1, 2,
+		0, 2, 4,
+		0, 1, 1
+	};
+
+	auto ds = nytl::DynMat<double>(s);
+	nytl::rowEcholon(ds);
+	nytl::rowEcholon(s);
+	EXPECT(static_cast<decltype(s)>(ds), nytl::approx(s));
+}
+
+TEST(lu) {
+	nytl::Mat<5, 5, double> small {
+		1, -2, 3, 5, 8,
+		0, -1, -1, 2, 3,
+		2, 4, -1, 3, 1,
+		0, 0, 5, 0, 0,
+		1, 3, 0, 4, -1
+	};
+
+	auto ds = nytl::DynMat<double>(small);
+	EXPECT(nytl::determinant(ds), nytl::approx(-135.0));
+	EXPECT(nytl::determinant(nytl::DynMat<int>(small)), nytl::approx(-135.0));
+	EXPECT(static_cast<decltype(small)>(nytl::inverse(ds)), nytl::approx(nytl::inverse(small)));
+	ERROR(nytl::luDecomp(nytl::DynMat<double>(2, 3)), std::invalid_argument);
+
+	std::vector<double> b {1.0, -2.0, 0.5, 3.0, 4.0};
+	auto x = nytl::luEvaluate(nytl::luDecomp(ds), nytl::span<const double>(b));
+	auto ax = small * nytl::Vec<5, double>{x[0], x[1], x[2], x[3], x[4]};
+	EXPECT(ax, nytl::approx(nytl::Vec<5, double>{1.0, -2.0, 0.5, 3.0, 4.0}));
+
+	// large enough for multiple blocks and column tiles
+	constexpr auto n = 300u;
+	auto a = randomMat(n, n, 42u);
+	auto lu = nytl::luDecomp(a);
+
+	// check PA = LU
+	nytl::DynMat<double> l(n, n), u(n, n), pa(n, n);
+	for(auto r = 0u; r < n; ++r) {
+		std::copy(a[lu.perm[r]].begin(), a[lu.perm[r]].end(), pa[r].begin());
+		for(auto c = 0u; c < n; ++c) {
+			if(c < r) {
+				l(r, c) = lu.lu(r, c);
+			} else {
+				u(r, c) = lu.lu(r, c);
+			}
+		}
+
+		l(r, r) = 1.0;
+	}
+
+	EXPECT(maxDiff(naiveMul(l, u), pa) < 1e-10, true);
+
+	nytl::ThreadPool pool(3);
+	auto plu = nytl::luDecomp(pool, a);
+	EXPECT(plu.perm == lu.perm, true);
+	EXPECT(plu.sign, lu.sign);
+	EXPECT(maxDiff(plu.lu, lu.lu) < 1e-12, true);
+
+	auto id = nytl::DynMat<double>::identity(n);
+	EXPECT(maxDiff(a * nytl::inverse(lu), id) < 1e-8, true);
+	EXPECT(maxDiff(a * nytl::inverse(pool, a), id) < 1e-8, true);
+
+	auto rhs = randomMat(n, 3, 7u);
+	EXPECT(maxDiff(a * nytl::luEvaluate(lu, rhs), rhs) < 1e-8, true);
+	EXPECT(maxDiff(a * nytl::luEvaluate(pool, lu, rhs), rhs) < 1e-8, true);
+	ERROR(nytl::luEvaluate(lu, randomMat(n - 1, 2, 1u)), std::invalid_argument);
+}
@@ -0,0 +1,91 @@
+#include "test.hpp"
+#include <nytl/inplaceFunction.hpp>
+
+#include <memory>
+#include <string>
+
+int twice(int x) { return 2 * x; }
+
+TEST(basic) {
+	nytl::InplaceFunction<int(int)> f;
+	EXPECT(static_cast<bool>(f), false);
+	ERROR(f(1), std::bad_function_call);
+
+	f = [](int x) { return x + 1; };
+	EXPECT(static_cast<bool>(f), true);
+	EXPECT(f(1), 2);
+
+	f = &twice;
+	EXPECT(f(3), 6);
+
+	f = static_cast<int(*)(int)>(nullptr);
+	EXPECT(static_cast<bool>(f), false);
+	f = std::function<int(int)>{};
+	EXPECT(static_cast<bool>(f), false);
+
+	// captures are stored inline
+	int a = 1, b = 2, c = 3;
+	nytl::InplaceFunction<int(), 32> g = [a, b, c]{ return a + b + c; };
+	EXPECT(g(), 6);
+	struct Large { double a, b, c; };
+	static_assert(!nytl::InplaceFunction<int(), 16>::fits<Large>);
+	static_assert(nytl::InplaceFunction<int(), 24>::fits<Large>);
+
+	// return values are converted/discarded as with std::function
+	nytl::InplaceFunction<void(int&)> v = [](int& x) { return ++x; };
+	v(a);
+	EXPECT(a, 2);
+	nytl::InplaceFunction<double()> d = []{ return 1; };
+	EXPECT(d(), 1.0);
+}
+
+TEST(move) {
+	// move-only callable
+	auto ptr = std::make_unique<int>(42);
+	nytl::InplaceFunction<int()> f = [p = std::move(ptr)]{ return *p; };
+	EXPECT(f(), 42);
+
+	auto g = std::move(f);
+	EXPECT(static_cast<bool>(f), false);
+	EXPECT(g(), 42);
+
+	// the stored callable is destroyed exactly once
+	auto shared = std::make_shared<int>(0);
+	{
+		nytl::InplaceFunction<long()> h = [shared]{ return shared.use_count(); };
+		EXPECT(shared.use_count(), 2);
+		auto h2 = std::move(h);
+		EXPECT(h2(), 2);
+		h = std::move(h2);
+		EXPECT(shared.use_count(), 2);
+		h = nullptr;
+		EXPECT(shared.use_count(), 1);
+		h = [shared]{ return 0l; };
+	}
+	EXPECT(shared.use_count(), 1);
+
+	// mutable state is kept between calls
+	nytl::InplaceFunction<int()> counter = [i = 0]() mutable { return ++i; };
+	counter();
+	EXPECT(counter(), 2);
+}
+
+TEST(ref) {
+	auto calls = 0u;
+	auto func = [&](const std::string& str) { ++calls; return str.size(); };
+
+	nytl::FunctionRef<std::size_t(const std::string&)> ref;
+	EXPECT(static_cast<bool>(ref), false);
+	ERROR(ref("a"), std::bad_function_call);
+
+	ref = func;
+	EXPECT(ref("abc"), 3u);
+	EXPECT(calls, 1u);
+
+	auto copy = ref;
+	EXPECT(copy("ab"), 2u);
+	EXPECT(calls, 2u);
+
+	nytl::FunctionRef<int(int)> fn = &twice;
+	EXPECT(fn(4), 8);
+}
@@ -8,6 +8,7 @@
 #include <nytl/vec.hpp>
 
 #include <array>
+#include <vector>
 #include <type_traits>
 #include <limits>
 #include <cfloat>
@@ -60,6 +61,92 @@ TEST(basic) {
 	// 3 - nytl::mat::transpose(x) * x;
 }
 
+TEST(mat4) {
+	constexpr nytl::Mat<4, 4, double> a {
+		1.0, 2.0, -1.0, 0.5,
+		0.0, 3.0, 2.0, -2.0,
+		4.0, -1.0, 0.0, 1.0,
+		2.0, 0.0, 1.0, 3.0
+	};
+	constexpr nytl::Mat<4, 4, double> b {
+		-1.0, 0.0, 2.0, 1.0,
+		3.0, 1.0, -2.0, 0.0,
+		0.5, 2.0, 1.0, -1.0,
+		1.0, -3.0, 0.0, 2.0
+	};
+	constexpr nytl::Vec4d v {1.0, -2.0, 0.5, 3.0};
+
+	// compile-time evaluation uses the scalar path
+	constexpr auto cab = a * b;
+	constexpr auto cav = a * v;
+	EXPECT(cab[1][2], 3.0 * -2.0 + 2.0 * 1.0);
+	EXPECT(cav[3], 2.0 + 0.5 + 9.0);
+
+	// runtime paths (might use simd, see nytl/simd.hpp)
+	EXPECT(a * b, nytl::approx(cab));
+	EXPECT(a * v, nytl::approx(cav));
+
+	auto c = a;
+	c *= b;
+	EXPECT(c, nytl::approx(cab));
+
+	auto af = static_cast<nytl::Mat<4, 4, float>>(a);
+	auto bf = static_cast<nytl::Mat<4, 4, float>>(b);
+	auto vf = static_cast<nytl::Vec4f>(v);
+	EXPECT(af * bf, nytl::approx(static_cast<nytl::Mat<4, 4, float>>(cab)));
+	EXPECT(af * vf, nytl::approx(static_cast<nytl::Vec4f>(cav)));
+
+	af *= bf;
+	EXPECT(af, nytl::approx(static_cast<nytl::Mat<4, 4, float>>(cab)));
+}
+
+TEST(transpose) {
+	nytl::Mat4f m {
+		1, 2, 3, 4,
+		5, 6, 7, 8,
+		9, 10, 11, 12,
+		13, 14, 15, 16
+	};
+
+	nytl::Mat4f t {
+		1, 5, 9, 13,
+		2, 6, 10, 14,
+		3, 7, 11, 15,
+		4, 8, 12, 16
+	};
+
+	EXPECT(nytl::transpose(m), t);
+	constexpr auto ct = nytl::transpose(nytl::Mat<2, 3, int>{1, 2, 3, 4, 5, 6});
+	static_assert(ct[2][1] == 6 && ct[0][1] == 4);
+
+	// multiple 4x4 blocks
+	nytl::Mat<8, 4, double> md {};
+	for(auto r = 0u; r < 8; ++r) {
+		for(auto c = 0u; c < 4; ++c) {
+			md[r][c] = 10.0 * r + c;
+		}
+	}
+
+	auto td = nytl::transpose(md);
+	for(auto r = 0u; r < 8; ++r) {
+		for(auto c = 0u; c < 4; ++c) {
+			EXPECT(td[c][r], md[r][c]);
+		}
+	}
+
+	// batch
+	std::vector<nytl::Mat4f> in(5, m);
+	in[3] = t;
+	std::vector<nytl::Mat4f> out(5);
+	nytl::transpose(nytl::span<const nytl::Mat4f>(in), out);
+	EXPECT(out[0], t);
+	EXPECT(out[3], m);
+	EXPECT(out[4], t);
+
+	std::vector<nytl::Mat4f> small(4);
+	ERROR(nytl::transpose(nytl::span<const nytl::Mat4f>(in), small), std::invalid_argument);
+}
+
 TEST(echolon) {
 	nytl::Mat<3, 5, double> a {
 		2.0, 1.0, -1.0, 8.0, 80.0,
@@ -125,6 +212,157 @@ TEST(lu_decomp_2) {
 	EXPECT(a * x, nytl::approx(p * b));
 }
 
+TEST(lu_decomp_sign) {
+	// partial pivoting swaps the rows once
+	nytl::Mat<2, 2, double> a {1, 2, 3, 4};
+	auto lups = nytl::luDecomp(a);
+	EXPECT(lups.sign, -1);
+	EXPECT(lups.lower * lups.upper, nytl::approx(lups.perm * a));
+	EXPECT(nytl::determinant(lups), nytl::approx(-2.0));
+	EXPECT(nytl::determinant(a), nytl::approx(-2.0));
+
+	// three swaps
+	nytl::Mat<4, 4, double> b {
+		1, 0, 0, 0,
+		2, 1, 0, 0,
+		3, 2, 1, 0,
+		4, 3, 2, 2
+	};
+
+	auto lupsb = nytl::luDecomp(b);
+	EXPECT(lupsb.sign, -1);
+	EXPECT(lupsb.lower * lupsb.upper, nytl::approx(lupsb.perm * b));
+	EXPECT(nytl::determinant(b), nytl::approx(2.0));
+}
+
+TEST(inverse_fast) {
+	nytl::Mat<2, 2, double> a2 {
+		2.0, -1.0,
+		3.0, 4.0
+	};
+	nytl::Mat<3, 3, double> a3 {
+		1.0, 2.0, 0.5,
+		-1.0, 3.0, 2.0,
+		4.0, 0.0, 1.0
+	};
+	nytl::Mat<4, 4, double> a4 {
+		1.0, 2.0, -1.0, 0.5,
+		0.0, 3.0, 2.0, -2.0,
+		4.0, -1.0, 0.0, 1.0,
+		2.0, 0.0, 1.0, 3.0
+	};
+	nytl::Mat<5, 5, double> a5 {
+		1, -2, 3, 5, 8,
+		0, -1, -1, 2, 3,
+		2, 4, -1, 3, 1,
+		0, 0, 5, 0, 0,
+		1, 3, 0, 4, -1
+	};
+
+	EXPECT(nytl::inverseFast(a2), nytl::approx(nytl::inverse(a2)));
+	EXPECT(nytl::inverseFast(a3), nytl::approx(nytl::inverse(a3)));
+	EXPECT(nytl::inverseFast(a4), nytl::approx(nytl::inverse(a4)));
+	EXPECT(nytl::inverseFast(a5), nytl::approx(nytl::inverse(a5)));
+
+	// compile-time evaluation
+	constexpr nytl::Mat<2, 2, double> c2 {4.0, 0.0, 0.0, 2.0};
+	constexpr auto ic2 = nytl::inverseFast(c2);
+	static_assert(ic2[0][0] == 0.25 && ic2[1][1] == 0.5);
+
+	// float, might use simd
+	auto a4f = static_cast<nytl::Mat<4, 4, float>>(a4);
+	auto id4f = nytl::identity<4, float>();
+	auto inv4f = nytl::inverseFast(a4f);
+	EXPECT(inv4f, nytl::approx(static_cast<nytl::Mat<4, 4, float>>(nytl::inverse(a4))));
+	EXPECT(a4f * inv4f, nytl::approx(id4f, 0.0001));
+
+	// affine: scale, rotation (permutation) and translation
+	nytl::Mat<4, 4, double> aff {
+		0.0, 2.0, 0.0, 1.0,
+		-3.0, 0.0, 0.0, -2.0,
+		0.0, 0.0, 0.5, 4.0,
+		0.0, 0.0, 0.0, 1.0
+	};
+	aff[0][2] = 0.25; // some shear
+
+	EXPECT(nytl::inverseAffine(aff), nytl::approx(nytl::inverse(aff)));
+	auto afff = static_cast<nytl::Mat<4, 4, float>>(aff);
+	EXPECT(nytl::inverseAffine(afff),
+		nytl::approx(static_cast<nytl::Mat<4, 4, float>>(nytl::inverse(aff))));
+	EXPECT(afff * nytl::inverseAffine(afff), nytl::approx(id4f, 0.0001));
+
+	nytl::Mat<3, 3, float> aff2 {
+		2.0f, 1.0f, 3.0f,
+		0.0f, 4.0f, -1.0f,
+		0.0f, 0.0f, 1.0f
+	};
+	EXPECT(aff2 * nytl::inverseAffine(aff2),
+		nytl::approx(nytl::identity<3, float>()));
+}
+
+TEST(lu_packed) {
+	nytl::Mat<5, 5, double> a {
+		1, -2, 3, 5, 8,
+		0, -1, -1, 2, 3,
+		2, 4, -1, 3, 1,
+		0, 0, 5, 0, 0,
+		1, 3, 0, 4, -1
+	};
+
+	auto lu = nytl::luDecompPacked(a);
+	static_assert(std::is_same_v<decltype(lu.perm)::value_type, std::uint8_t>);
+
+	// unpack and check PA = LU
+	auto l = nytl::identity<5, double>();
+	nytl::Mat<5, 5, double> u {};
+	nytl::Mat<5, 5, double> pa {};
+	for(auto r = 0u; r < 5; ++r) {
+		pa[r] = a[lu.perm[r]];
+		for(auto c = 0u; c < 5; ++c) {
+			(c < r ? l : u)[r][c] = lu.lu[r][c];
+		}
+	}
+
+	EXPECT(l * u, nytl::approx(pa));
+	EXPECT(nytl::determinant(lu), nytl::approx(-135.0));
+	EXPECT(nytl::inverse(lu), nytl::approx(nytl::inverse(a)));
+
+	nytl::Vec<5, double> b {1.0, -2.0, 0.5, 3.0, 4.0};
+	EXPECT(a * nytl::luEvaluate(lu, b), nytl::approx(b));
+
+	// multiple right-hand sides, enough for multiple blocks
+	std::vector<nytl::Vec<5, double>> bs;
+	for(auto i = 0u; i < 37; ++i) {
+		bs.push_back(double(i) * b - nytl::Vec<5, double>{0.0, 1.0, 2.0, 3.0, 4.0});
+	}
+
+	std::vector<nytl::Vec<5, double>> xs(bs.size());
+	nytl::luEvaluate(lu, bs, xs);
+	for(auto i = 0u; i < bs.size(); ++i) {
+		EXPECT(a * xs[i], nytl::approx(bs[i]));
+	}
+
+	// in place
+	xs = bs;
+	nytl::luEvaluate(lu, xs, xs);
+	for(auto i = 0u; i < bs.size(); ++i) {
+		EXPECT(a * xs[i], nytl::approx(bs[i]));
+	}
+
+	ERROR(nytl::luEvaluate(lu, bs, nytl::span<nytl::Vec<5, double>>(xs).first(3)),
+		std::invalid_argument);
+
+	// keeps float precision, integer matrices use double
+	auto luf = nytl::luDecompPacked(static_cast<nytl::Mat<5, 5, float>>(a));
+	static_assert(std::is_same_v<decltype(luf.lu), nytl::Mat<5, 5, float>>);
+	EXPECT(nytl::determinant(luf), nytl::approx(-135.f, 0.001));
+
+	constexpr nytl::Mat<2, 2, int> ai {0, 1, 2, 3};
+	constexpr auto lui = nytl::luDecompPacked(ai);
+	static_assert(std::is_same_v<decltype(lui.lu), nytl::Mat<2, 2, double>>);
+	static_assert(nytl::determinant(lui) == -2.0);
+}
+
 // tests the inverse and determinant operations
 TEST(inverse) {
 	{
@@ -0,0 +1,53 @@
+#include "test.hpp"
+#include <nytl/parallel.hpp>
+
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+using namespace nytl;
+
+TEST(parallelFor) {
+	ThreadPool pool(3);
+	std::vector<int> vals(1000, 0);
+	parallelFor(pool, vals.size(), 7, [&](std::size_t begin, std::size_t end) {
+		for(auto i = begin; i < end; ++i) {
+			vals[i] += int(i);
+		}
+	});
+
+	for(auto i = 0u; i < vals.size(); ++i) {
+		EXPECT(vals[i], int(i));
+	}
+
+	// empty range and no workers
+	parallelFor(pool, 0, 10, [&](std::size_t, std::size_t) { vals[0] = -1; });
+	EXPECT(vals[0], 0);
+
+	ThreadPool empty(0);
+	std::atomic<std::size_t> sum {0};
+	parallelFor(empty, 100, 8, [&](std::size_t begin, std::size_t end) {
+		sum += end - begin;
+	});
+	EXPECT(sum.load(), 100u);
+}
+
+TEST(nested) {
+	ThreadPool pool(2);
+	std::atomic<std::size_t> sum {0};
+	parallelFor(pool, 8, 1, [&](std::size_t, std::size_t) {
+		parallelFor(pool, 10, 2, [&](std::size_t begin, std::size_t end) {
+			sum += end - begin;
+		});
+	});
+	EXPECT(sum.load(), 80u);
+}
+
+TEST(exception) {
+	ThreadPool pool(3);
+	ERROR(parallelFor(pool, 100, 1, [&](std::size_t begin, std::size_t) {
+		if(begin == 42) {
+			throw std::runtime_error("42");
+		}
+	}), std::runtime_error);
+}
@@ -0,0 +1,93 @@
+#include "test.hpp"
+#include <nytl/parallelCallback.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+TEST(basic) {
+	nytl::ThreadPool pool(3);
+	nytl::Callback<void(const std::string&, int)> cb;
+
+	std::vector<int> called(200);
+	for(auto i = 0u; i < called.size(); ++i) {
+		cb.add([&called, i](const std::string& str, int x) {
+			called[i] += x + int(str.size());
+		});
+	}
+
+	nytl::callParallel(cb, pool, "ab", 1);
+	for(auto val : called) {
+		EXPECT(val, 3);
+	}
+
+	// explicit grain
+	nytl::callParallel(cb, pool, {0u, 7u}, std::string("abc"), 1);
+	for(auto val : called) {
+		EXPECT(val, 7);
+	}
+
+	// serial fallback
+	nytl::callParallel(cb, pool, {1000u, 0u}, "", 1);
+	for(auto val : called) {
+		EXPECT(val, 8);
+	}
+
+	// empty callback, no parameters
+	nytl::Callback<void()> empty;
+	nytl::callParallel(empty, pool);
+
+	nytl::ThreadPool noWorkers(0);
+	std::atomic<unsigned> count {0};
+	nytl::Callback<void()> inc;
+	for(auto i = 0u; i < 100u; ++i) {
+		inc.add([&]{ ++count; });
+	}
+
+	nytl::callParallel(inc, noWorkers);
+	EXPECT(count.load(), 100u);
+	nytl::callParallel(inc, pool);
+	EXPECT(count.load(), 200u);
+}
+
+TEST(exceptions) {
+	// all functions are called, exceptions are aggregated in order
+	nytl::ThreadPool pool(2);
+	nytl::Callback<void(int)> cb;
+	std::atomic<unsigned> count {0};
+	for(auto i = 0; i < 100; ++i) {
+		cb.add([&count, i](int x) {
+			++count;
+			if(i % (10 * x) == 0) {
+				throw std::runtime_error(std::to_string(i));
+			}
+		});
+	}
+
+	for(auto params : {nytl::ParallelCallParams{}, nytl::ParallelCallParams{1000u, 0u}}) {
+		count = 0u;
+		auto caught = false;
+		try {
+			nytl::callParallel(cb, pool, params, 1);
+		} catch(const nytl::ParallelCallError& err) {
+			caught = true;
+			auto& exceptions = err.exceptions();
+			EXPECT(exceptions.size(), 10u);
+			for(auto i = 0u; i < exceptions.size(); ++i) {
+				try {
+					std::rethrow_exception(exceptions[i]);
+				} catch(const std::runtime_error& inner) {
+					EXPECT(std::string(inner.what()), std::to_string(10 * i));
+				}
+			}
+		}
+
+		EXPECT(caught, true);
+		EXPECT(count.load(), 100u);
+	}
+
+	count = 0u;
+	ERROR(nytl::callParallel(cb, pool, 100), nytl::ParallelCallError);
+	EXPECT(count.load(), 100u);
+}
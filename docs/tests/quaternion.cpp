@@ -0,0 +1,187 @@
+#include "test.hpp"
+
+#include <nytl/quaternion.hpp>
+#include <nytl/transform.hpp>
+#include <nytl/approx.hpp>
+#include <nytl/approxVec.hpp>
+#include <nytl/vecOps.hpp>
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+constexpr auto pi = 3.14159265358979323846;
+
+template<typename P>
+bool same(const nytl::QuaternionT<P>& a, const nytl::QuaternionT<P>& b, double eps = 1e-5) {
+	return std::abs(a.x - b.x) < eps && std::abs(a.y - b.y) < eps &&
+		std::abs(a.z - b.z) < eps && std::abs(a.w - b.w) < eps;
+}
+
+TEST(layout) {
+	static_assert(std::is_same_v<nytl::Quaternion, nytl::QuaternionT<double>>);
+	static_assert(sizeof(nytl::Quaternionf) == 16 && alignof(nytl::Quaternionf) == 16);
+	static_assert(sizeof(nytl::Quaternion) == 32 && alignof(nytl::Quaternion) >= 16);
+
+	nytl::Quaternionf q;
+	EXPECT(q.w, 1.f);
+	EXPECT(q.x, 0.f);
+}
+
+TEST(product) {
+	auto a = nytl::Quaternion::yxz(0.3, -1.2, 2.1);
+	auto b = nytl::Quaternion::axisAngle(nytl::Vec3f{0.f, 0.6f, 0.8f}, 0.7);
+	auto af = static_cast<nytl::Quaternionf>(a);
+	auto bf = static_cast<nytl::Quaternionf>(b);
+
+	auto ab = a * b;
+	EXPECT(same(static_cast<nytl::Quaternionf>(ab), af * bf), true);
+	EXPECT(same(bf * af, static_cast<nytl::Quaternionf>(b * a)), true);
+
+	// yxz is the same as the chained axis rotations
+	auto yxz = nytl::Quaternionf::axisAngle(0, 1, 0, 0.3f) *
+		nytl::Quaternionf::axisAngle(1, 0, 0, -1.2f) *
+		nytl::Quaternionf::axisAngle(0, 0, 1, 2.1f);
+	EXPECT(same(yxz, af), true);
+
+	auto c = af;
+	c *= c;
+	EXPECT(same(c, af * af), true);
+
+	EXPECT(same(af * nytl::conjugated(af), nytl::Quaternionf{}), true);
+	EXPECT(2.f * bf == bf + bf, true);
+}
+
+TEST(apply) {
+	auto q = nytl::Quaternion::axisAngle(0, 0, 1, pi / 2);
+	auto qf = static_cast<nytl::Quaternionf>(q);
+
+	EXPECT(nytl::apply(q, nytl::Vec3d{1.0, 0.0, 0.0}), nytl::approx(nytl::Vec3d{0.0, 1.0, 0.0}));
+	EXPECT(nytl::apply(qf, nytl::Vec3f{1.f, 0.f, 0.f}), nytl::approx(nytl::Vec3f{0.f, 1.f, 0.f}, 1e-6));
+	EXPECT(nytl::apply(qf, nytl::Vec3f{0.f, 2.f, 3.f}), nytl::approx(nytl::Vec3f{-2.f, 0.f, 3.f}, 1e-6));
+
+	auto r = nytl::Quaternion::yxz(-0.5, 0.9, 0.1);
+	auto rf = static_cast<nytl::Quaternionf>(r);
+	nytl::Vec3f v {0.3f, -2.f, 1.5f};
+	EXPECT(nytl::apply(rf, v), nytl::approx(nytl::apply(r, v), 1e-5));
+	EXPECT(nytl::apply(rf, v), nytl::approx(nytl::toMat<3>(rf) * v, 1e-5));
+
+	// lookAt works with both precisions
+	auto la = nytl::lookAt(r, nytl::Vec3f{1.f, 2.f, 3.f});
+	auto laf = nytl::lookAt(rf, nytl::Vec3f{1.f, 2.f, 3.f});
+	EXPECT(laf, nytl::approx(la, 1e-5));
+}
+
+TEST(normalize) {
+	nytl::Quaternionf q {1.f, 2.f, -2.f, 4.f};
+	EXPECT(nytl::norm(q), nytl::approx(5.f, 1e-6));
+
+	auto n = nytl::normalized(q);
+	EXPECT(same(n, nytl::Quaternionf{0.2f, 0.4f, -0.4f, 0.8f}), true);
+	EXPECT(nytl::normalized(nytl::Quaternionf{0.f, 0.f, 0.f, 0.f}) == nytl::Quaternionf{}, true);
+	EXPECT(nytl::normalized(nytl::Quaternion{0.0, 0.0, 0.0, 0.0}) == nytl::Quaternion{}, true);
+
+	auto angles = nytl::eulerAngles(nytl::Quaternionf::yxz(0.3f, -0.4f, 0.5f),
+		nytl::RotationSequence::yxz);
+	EXPECT(angles[0], nytl::approx(0.3f, 1e-5));
+	EXPECT(angles[1], nytl::approx(-0.4f, 1e-5));
+	EXPECT(angles[2], nytl::approx(0.5f, 1e-5));
+}
+
+// deterministic pseudo-random unit quaternions
+template<typename P>
+std::vector<nytl::QuaternionT<P>> randomQuats(std::size_t count, std::uint32_t seed) {
+	auto rand = [&]{
+		seed = seed * 1664525u + 1013904223u;
+		return double(seed >> 8) / double(1u << 23) - 1.0;
+	};
+
+	std::vector<nytl::QuaternionT<P>> ret;
+	for(auto i = 0u; i < count; ++i) {
+		ret.push_back(nytl::normalized(nytl::QuaternionT<P>{
+			P(rand()), P(rand()), P(rand()), P(rand())}));
+	}
+
+	return ret;
+}
+
+// angle between the rotations represented by the given unit quaternions
+template<typename P>
+double angle(const nytl::QuaternionT<P>& a, const nytl::QuaternionT<P>& b) {
+	auto d = std::min(1.0, std::abs(double(nytl::dot(a, b))));
+	return 2 * std::acos(d);
+}
+
+TEST(slerp) {
+	nytl::Quaternion a {1.0, 2.0, 3.0, 4.0};
+	EXPECT(nytl::dot(a, a), nytl::approx(30.0));
+
+	auto q0 = nytl::Quaternion::axisAngle(0, 1, 0, 0.2);
+	auto q1 = nytl::Quaternion::axisAngle(0, 1, 0, 1.4);
+	auto half = nytl::Quaternion::axisAngle(0, 1, 0, 0.8);
+	EXPECT(angle(nytl::slerp(q0, q1, 0.5), half) < 1e-6, true);
+
+	// -q1 is the same rotation, slerp must take the shorter path
+	EXPECT(angle(nytl::slerp(q0, -1.0 * q1, 0.5), half) < 1e-6, true);
+	EXPECT(angle(nytl::slerpFast(q0, -1.0 * q1, 0.5), half) < 1e-6, true);
+	EXPECT(angle(nytl::nlerp(q0, -1.0 * q1, 0.5), half) < 1e-6, true);
+	EXPECT(angle(nytl::slerpFast(q0, q1, 0.3), nytl::slerp(q0, q1, 0.3)) < 8e-4, true);
+}
+
+template<typename P>
+void testBatch(double eps) {
+	constexpr auto count = 37u;
+	auto a = randomQuats<P>(count, 1u);
+	auto b = randomQuats<P>(count, 2u);
+	std::vector<P> t(count);
+	for(auto i = 0u; i < count; ++i) {
+		t[i] = P(i) / P(count - 1);
+	}
+
+	nytl::span<const nytl::QuaternionT<P>> sa(a);
+	nytl::span<const nytl::QuaternionT<P>> sb(b);
+	nytl::span<const P> st(t);
+
+	// batched and scalar paths may round differently, e.g. with fma
+	const auto tol = std::is_same_v<P, float> ? 1e-6 : 1e-12;
+
+	std::vector<nytl::QuaternionT<P>> out(count);
+	nytl::slerp(sa, sb, st, out);
+	for(auto i = 0u; i < count; ++i) {
+		EXPECT(same(out[i], nytl::slerp(a[i], b[i], t[i]), tol), true);
+	}
+
+	nytl::nlerp(sa, sb, st, out);
+	for(auto i = 0u; i < count; ++i) {
+		EXPECT(same(out[i], nytl::nlerp(a[i], b[i], t[i]), tol), true);
+	}
+
+	nytl::slerpFast(sa, sb, st, out);
+	for(auto i = 0u; i < count; ++i) {
+		EXPECT(same(out[i], nytl::slerpFast(a[i], b[i], t[i]), tol), true);
+		EXPECT(angle(out[i], nytl::slerp(a[i], b[i], t[i])) < eps, true);
+	}
+
+	nytl::slerpFast(sa, sb, P(0.25), out);
+	for(auto i = 0u; i < count; ++i) {
+		EXPECT(same(out[i], nytl::slerpFast(a[i], b[i], P(0.25)), tol), true);
+	}
+
+	// in place
+	auto c = a;
+	nytl::nlerp(nytl::span<const nytl::QuaternionT<P>>(c), sb, P(0.5), c);
+	for(auto i = 0u; i < count; ++i) {
+		EXPECT(same(c[i], nytl::nlerp(a[i], b[i], P(0.5)), tol), true);
+	}
+
+	std::vector<nytl::QuaternionT<P>> small(count - 1);
+	ERROR(nytl::nlerp(sa, sb, st, small), std::invalid_argument);
+	ERROR(nytl::slerpFast(sa, sb, st.subspan(1), out), std::invalid_argument);
+	ERROR(nytl::slerp(sa, sb, P(0.5), small), std::invalid_argument);
+}
+
+TEST(batch) {
+	testBatch<float>(2e-3);
+	testBatch<double>(8e-4);
+}
@@ -0,0 +1,173 @@
+#include "test.hpp"
+#include <nytl/queuedDispatcher.hpp>
+#include <nytl/recursiveCallback.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+TEST(basic) {
+	nytl::Callback<void(int)> cb;
+	std::vector<int> vals;
+	cb.add([&](int i) { vals.push_back(i); });
+
+	nytl::QueuedDispatcher<decltype(cb)> queue(cb);
+	EXPECT(queue.empty(), true);
+	EXPECT(queue.flush(), 0u);
+
+	queue.enqueue(1);
+	queue(2);
+	queue(3);
+	EXPECT(queue.size(), 3u);
+	EXPECT(vals.size(), 0u);
+
+	EXPECT(queue.flush(), 3u);
+	EXPECT(queue.empty(), true);
+	EXPECT(vals.size(), 3u);
+	EXPECT(vals[0], 1);
+	EXPECT(vals[2], 3);
+
+	// buffers are reused
+	vals.clear();
+	for(auto j = 0; j < 3; ++j) {
+		for(auto i = 0; i < 100; ++i) {
+			queue(i);
+		}
+
+		EXPECT(queue.flush(), 100u);
+	}
+
+	EXPECT(vals.size(), 300u);
+	EXPECT(vals[299], 99);
+
+	queue(1);
+	queue.clear();
+	EXPECT(queue.flush(), 0u);
+
+	// return values are discarded
+	nytl::Callback<int(const std::string&)> rcb;
+	auto length = 0u;
+	rcb.add([&](const std::string& str) { length += str.size(); return 0; });
+	nytl::QueuedDispatcher<decltype(rcb)> rqueue(rcb);
+	rqueue("abc");
+	rqueue(std::string("de"));
+	EXPECT(rqueue.flush(), 2u);
+	EXPECT(length, 5u);
+}
+
+TEST(batched) {
+	nytl::Callback<void(int)> cb;
+	std::vector<int> vals;
+	cb.add([&](int i) { vals.push_back(i); });
+	cb.add([&](int i) { vals.push_back(-i); });
+
+	nytl::QueuedDispatcher<decltype(cb)> queue(cb);
+	queue(1);
+	queue(2);
+	EXPECT(queue.flushBatched(), 2u);
+	EXPECT(vals.size(), 4u);
+	EXPECT(vals[0], 1);
+	EXPECT(vals[1], 2);
+	EXPECT(vals[2], -1);
+	EXPECT(vals[3], -2);
+
+	vals.clear();
+	queue(1);
+	queue(2);
+	EXPECT(queue.flush(), 2u);
+	EXPECT(vals[0], 1);
+	EXPECT(vals[1], -1);
+	EXPECT(vals[2], 2);
+	EXPECT(vals[3], -2);
+}
+
+TEST(coalesce) {
+	nytl::Callback<void(int, int)> cb;
+	auto sum = 0;
+	cb.add([&](int a, int b) { sum += a * b; });
+
+	nytl::QueuedDispatcher<decltype(cb)> last(cb, nytl::Coalesce::last);
+	EXPECT(last(1, 2), true);
+	EXPECT(last(1, 2), false);
+	EXPECT(last(2, 2), true);
+	EXPECT(last(1, 2), true);
+	EXPECT(last.flush(), 3u);
+	EXPECT(sum, 8);
+
+	sum = 0;
+	nytl::QueuedDispatcher<decltype(cb)> any(cb, nytl::Coalesce::any);
+	EXPECT(any(1, 2), true);
+	EXPECT(any(2, 2), true);
+	EXPECT(any(1, 2), false);
+	EXPECT(any.flush(), 2u);
+	EXPECT(sum, 6);
+
+	// after flushing, events are queued again
+	EXPECT(any(1, 2), true);
+
+	// not comparable
+	struct Foo {};
+	nytl::Callback<void(Foo)> fcb;
+	using FQueue = nytl::QueuedDispatcher<decltype(fcb)>;
+	ERROR(FQueue(fcb, nytl::Coalesce::any), std::invalid_argument);
+	EXPECT(FQueue(fcb).coalesce(), nytl::Coalesce::none);
+
+	// move-only arguments
+	auto got = 0;
+	nytl::Callback<void(std::unique_ptr<int>)> ucb;
+	ucb.add([&](std::unique_ptr<int> ptr) { got = *ptr; });
+	nytl::QueuedDispatcher<decltype(ucb)> uqueue(ucb);
+	uqueue(std::make_unique<int>(42));
+	EXPECT(uqueue.flush(), 1u);
+	EXPECT(got, 42);
+}
+
+TEST(recursive) {
+	// events queued while flushing are dispatched in the next flush
+	nytl::RecursiveCallback<void(int)> cb;
+	nytl::QueuedDispatcher<decltype(cb)> queue(cb);
+	std::vector<int> vals;
+	cb.add([&](int i) {
+		vals.push_back(i);
+		if(i > 0) {
+			queue(i - 1);
+		}
+	});
+
+	queue(2);
+	EXPECT(queue.flush(), 1u);
+	EXPECT(queue.size(), 1u);
+	EXPECT(queue.flush(), 1u);
+	EXPECT(queue.flush(), 1u);
+	EXPECT(queue.flush(), 0u);
+	EXPECT(vals.size(), 3u);
+	EXPECT(vals[2], 0);
+}
+
+TEST(exception) {
+	// remaining events are queued again
+	nytl::Callback<void(int)> cb;
+	std::vector<int> vals;
+	cb.add([&](int i) {
+		if(i == 2) {
+			throw std::runtime_error("");
+		}
+
+		vals.push_back(i);
+	});
+
+	nytl::QueuedDispatcher<decltype(cb)> queue(cb);
+	queue(1);
+	queue(2);
+	queue(3);
+	ERROR(queue.flush(), std::runtime_error);
+	EXPECT(vals.size(), 1u);
+	EXPECT(queue.size(), 1u);
+	EXPECT(queue.flush(), 1u);
+	EXPECT(vals.size(), 2u);
+	EXPECT(vals[1], 3);
+
+	queue(2);
+	ERROR(queue.flushBatched(), std::runtime_error);
+	EXPECT(queue.empty(), true);
+}
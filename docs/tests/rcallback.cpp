@@ -1,7 +1,13 @@
 #include "test.hpp"
 #include <nytl/recursiveCallback.hpp>
+#include <nytl/inplaceFunction.hpp>
+#include <nytl/collector.hpp>
 #include <nytl/tmpUtil.hpp>
 
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
 // TODO: simple tests that varify the semantics of mixing/recursing
 // operations. Also test with custom id type
 
@@ -300,3 +306,138 @@ TEST(connection) {
 	cb();
 	EXPECT(called, 7u);
 }
+
+TEST(inplace) {
+	nytl::RecursiveCallback<void(int), nytl::ConnectionID, nytl::InplaceFunction> cb;
+	auto sum = 0;
+	auto ptr = std::make_unique<int>(2);
+	cb.add([&, p = std::move(ptr)](int x) { sum += *p * x; });
+	cb.add([&](nytl::Connection conn, int x) { sum += x; conn.disconnect(); });
+
+	cb(1);
+	EXPECT(sum, 3);
+	cb(1);
+	EXPECT(sum, 5);
+	ERROR(cb.add(nullptr), std::invalid_argument);
+}
+
+// memory resource that counts its allocations
+struct CountingResource : std::pmr::memory_resource {
+	unsigned allocations {};
+	unsigned deallocations {};
+
+	void* do_allocate(std::size_t size, std::size_t align) override {
+		++allocations;
+		return std::pmr::new_delete_resource()->allocate(size, align);
+	}
+
+	void do_deallocate(void* ptr, std::size_t size, std::size_t align) override {
+		++deallocations;
+		std::pmr::new_delete_resource()->deallocate(ptr, size, align);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+TEST(store) {
+	CountingResource mem;
+
+	{
+		// functions added from within a call over multiple chunks,
+		// the running function must not be moved
+		nytl::RecursiveCallback<void()> cb(&mem);
+		std::vector<nytl::Connection> conns;
+		auto called = 0u;
+		auto self = cb.add([&]{
+			for(auto i = 0u; i < 100; ++i) {
+				conns.push_back(cb.add([&]{ ++called; }));
+			}
+			++called;
+		});
+
+		cb();
+		EXPECT(called, 1u);
+		self.disconnect();
+
+		cb();
+		EXPECT(called, 101u);
+		EXPECT(mem.allocations > 0u, true);
+
+		// removal keeps the order and reuses the chunks
+		for(auto i = 0u; i < conns.size(); i += 3) {
+			conns[i].disconnect();
+		}
+
+		std::vector<unsigned> order;
+		for(auto i = 0u; i < 30; ++i) {
+			cb.add([&order, i]{ order.push_back(i); });
+		}
+
+		cb();
+		EXPECT(called, 101u + 66u);
+		EXPECT(order.size(), 30u);
+		for(auto i = 0u; i < order.size(); ++i) {
+			EXPECT(order[i], i);
+		}
+
+		auto allocations = mem.allocations;
+		cb.clear();
+		for(auto i = 0u; i < 50; ++i) {
+			cb.add([]{});
+		}
+		EXPECT(mem.allocations, allocations);
+
+		// disconnecting twice
+		auto conn = cb.add([]{});
+		auto id = conn.id();
+		EXPECT(cb.disconnect(id), true);
+		EXPECT(cb.disconnect(id), false);
+	}
+
+	EXPECT(mem.deallocations, mem.allocations);
+}
+
+TEST(collect) {
+	nytl::RecursiveCallback<bool(int)> cb;
+	auto called = 0u;
+	cb.add([&](nytl::Connection conn, int x) { ++called; conn.disconnect(); return x > 0; });
+	cb.add([&](int x) { ++called; return x > 1; });
+	cb.add([&](int x) { ++called; return x < 0 || cb.collect(nytl::AnyOf{}, -1).value; });
+
+	// the first function disconnects itself, it is still called by the
+	// outer but not the nested call
+	EXPECT(cb.collect(nytl::AllOf{}, 2).value, true);
+	EXPECT(called, 3u + 2u);
+
+	called = 0u;
+	EXPECT(cb.collect(nytl::AllOf{}, 1).value, false);
+	EXPECT(called, 1u);
+	EXPECT(cb.collect(nytl::Fold<int>{}, 2).value, 2);
+}
+
+TEST(removed) {
+	// without active call, the id is notified immediately
+	nytl::RecursiveCallback<void(), nytl::PooledConnectionID> cb;
+	auto conn = cb.add([]{});
+	cb.add([]{});
+	auto id = conn.id();
+	EXPECT(id.valid(), true);
+	conn.disconnect();
+	EXPECT(id.valid(), false);
+	cb();
+
+	// deferred during a call
+	nytl::PooledConnectionID inner;
+	cb.add([&]{
+		if(inner.valid()) {
+			EXPECT(cb.disconnect(inner), true);
+			EXPECT(inner.valid(), true);
+		}
+	});
+
+	inner = cb.add([]{}).id();
+	cb();
+	EXPECT(inner.valid(), false);
+}
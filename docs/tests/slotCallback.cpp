@@ -0,0 +1,150 @@
+#include "test.hpp"
+#include <nytl/slotCallback.hpp>
+#include <nytl/inplaceFunction.hpp>
+
+#include <vector>
+
+// basic connection and callback functionality, same as for Callback
+TEST(basic) {
+	nytl::SlotCallback<void()> cb;
+	auto called = 0u;
+	cb();
+	EXPECT(called, 0u);
+
+	auto inc = [&]{ ++called; };
+	cb += inc;
+	cb.add(inc);
+	cb();
+	EXPECT(called, 2u);
+
+	called = 0u;
+	cb = inc;
+	cb();
+	EXPECT(called, 1u);
+
+	called = 0u;
+	cb.clear();
+	cb();
+	EXPECT(called, 0u);
+	EXPECT(cb.size(), 0u);
+
+	auto conn1 = cb.add(inc);
+	cb();
+	EXPECT(called, 1u);
+	conn1.disconnect();
+	cb();
+	EXPECT(called, 1u);
+
+	ERROR(cb.add(std::function<void()>{}), std::invalid_argument);
+	ERROR(cb += std::function<void()>{}, std::invalid_argument);
+
+	nytl::SlotCallback<int(), nytl::ConnectionID, nytl::InplaceFunction> rcb;
+	rcb.add([]{ return 1; });
+	rcb.add([]{ return 2; });
+	auto vec = rcb();
+	EXPECT(vec.size(), 2u);
+	EXPECT(vec[0], 1);
+	EXPECT(vec[1], 2);
+}
+
+TEST(order) {
+	// registration order is kept through removals and compaction
+	nytl::SlotCallback<void(std::vector<int>&)> cb;
+	std::vector<nytl::Connection> conns;
+	for(auto i = 0; i < 100; ++i) {
+		conns.push_back(cb.add([i](auto& vec) { vec.push_back(i); }));
+	}
+
+	for(auto i = 0; i < 100; ++i) {
+		if(i % 3 != 0) {
+			EXPECT(cb.disconnect(conns[i].id()), true);
+		}
+	}
+
+	// reuses slots
+	for(auto i = 100; i < 110; ++i) {
+		conns.push_back(cb.add([i](auto& vec) { vec.push_back(i); }));
+	}
+
+	std::vector<int> vec;
+	cb(vec);
+	EXPECT(vec.size(), 34u + 10u);
+	EXPECT(cb.size(), vec.size());
+	for(auto i = 1u; i < vec.size(); ++i) {
+		EXPECT(vec[i - 1] < vec[i], true);
+	}
+
+	EXPECT(vec.front(), 0);
+	EXPECT(vec[33], 99);
+	EXPECT(vec.back(), 109);
+}
+
+TEST(stale) {
+	// ids of reused slots do not disconnect the new function
+	nytl::SlotCallback<void()> cb;
+	auto called = 0u;
+	auto conn1 = cb.add([&]{ called += 1; });
+	auto id1 = conn1.id();
+	conn1.disconnect();
+	EXPECT(cb.disconnect(id1), false);
+
+	auto conn2 = cb.add([&]{ called += 2; });
+	EXPECT(cb.disconnect(id1), false);
+	cb();
+	EXPECT(called, 2u);
+
+	auto id2 = conn2.id();
+	cb.clear();
+	cb.add([&]{ called += 4; });
+	EXPECT(cb.disconnect(id2), false);
+	cb();
+	EXPECT(called, 6u);
+
+	EXPECT(cb.disconnect({0}), false);
+	EXPECT(cb.disconnect({(std::int64_t(1) << 32) | 1234}), false);
+}
+
+TEST(tracked) {
+	nytl::TrackedConnection conn;
+
+	{
+		nytl::TrackedSlotCallback<void()> cb;
+		auto c1 = cb.add([]{});
+		EXPECT(c1.connected(), true);
+		auto c2 = c1;
+		c2.disconnect();
+		EXPECT(c1.connected(), false);
+
+		conn = cb.add([]{});
+		EXPECT(conn.connected(), true);
+	}
+
+	EXPECT(conn.connected(), false);
+}
+
+TEST(teardown) {
+	// mass teardown in any order
+	constexpr auto count = 20000u;
+	nytl::SlotCallback<void(unsigned&)> cb;
+	std::vector<nytl::Connection> conns;
+	for(auto i = 0u; i < count; ++i) {
+		conns.push_back(cb.add([](unsigned& c) { ++c; }));
+	}
+
+	for(auto i = 0u; i < count; i += 2) {
+		conns[i].disconnect();
+	}
+
+	auto c = 0u;
+	cb(c);
+	EXPECT(c, count / 2);
+
+	for(auto i = count; i-- > 0;) {
+		conns[i].disconnect();
+	}
+
+	c = 0u;
+	cb(c);
+	EXPECT(c, 0u);
+	EXPECT(cb.size(), 0u);
+}
@@ -0,0 +1,107 @@
+#include "test.hpp"
+#include <nytl/transformParallel.hpp>
+#include <nytl/approx.hpp>
+#include <nytl/approxVec.hpp>
+
+#include <vector>
+
+using namespace nytl;
+
+// The batched paths may round differently than the scalar ones (e.g. with
+// fma) and the perspective divide amplifies this, use a float-sized epsilon
+constexpr auto eps = 1e-5;
+
+// some points that cover the simd blocks as well as the scalar rest
+std::vector<Vec3f> testPoints(unsigned count = 37) {
+	std::vector<Vec3f> ret;
+	for(auto i = 0u; i < count; ++i) {
+		auto f = float(i);
+		ret.push_back({0.5f * f - 3.f, 2.f - f, 0.25f * f * f - 10.f});
+	}
+	return ret;
+}
+
+Mat4f testMat() {
+	auto mat = perspective(1.f, 1.5f, -0.1f, -100.f);
+	translate(mat, Vec3f{1.f, -2.f, 0.5f});
+	rotate(mat, normalized(Vec3f{1.f, 1.f, 0.f}), 0.7f);
+	return mat;
+}
+
+TEST(single) {
+	auto mat = translateMat(Vec3f{1.f, 2.f, 3.f});
+	EXPECT(multPos(mat, Vec3f{1.f, 1.f, 1.f}), nytl::approx(Vec3f{2.f, 3.f, 4.f}));
+	EXPECT(multDir(mat, Vec3f{1.f, 1.f, 1.f}), nytl::approx(Vec3f{1.f, 1.f, 1.f}));
+}
+
+TEST(batch) {
+	auto mat = testMat();
+	auto points = testPoints();
+	span<const Vec3f> in = points;
+	std::vector<Vec3f> out(points.size());
+
+	multPos(mat, in, out);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(out[i], nytl::approx(multPos(mat, points[i]), eps));
+	}
+
+	multDir(mat, in, out);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(out[i], nytl::approx(multDir(mat, points[i]), eps));
+	}
+
+	// vec4 input with custom w
+	std::vector<Vec4f> points4;
+	for(auto& p : points) {
+		points4.push_back({2.f * p.x, 2.f * p.y, 2.f * p.z, 2.f});
+	}
+
+	multPos(mat, span<const Vec4f>(points4), out);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(out[i], nytl::approx(multPos(mat, points[i]), eps));
+	}
+
+	// in place
+	out = points;
+	multPos(mat, span<const Vec3f>(out), out);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(out[i], nytl::approx(multPos(mat, points[i]), eps));
+	}
+
+	// soa
+	VecSoA<3, float> soa(points);
+	VecSoA<3, float> soaOut(points.size());
+	multPos(mat, soa, soaOut);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(soaOut.get(i), nytl::approx(multPos(mat, points[i]), eps));
+	}
+
+	multDir(mat, soa, soaOut);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(soaOut.get(i), nytl::approx(multDir(mat, points[i]), eps));
+	}
+
+	// errors
+	std::vector<Vec3f> small(3);
+	ERROR(multPos(mat, in, small), std::invalid_argument);
+}
+
+TEST(parallel) {
+	ThreadPool pool(3);
+	auto mat = testMat();
+	auto points = testPoints(1000);
+	span<const Vec3f> in = points;
+	std::vector<Vec3f> out(points.size());
+
+	multPos(pool, mat, in, out, 64);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(out[i], nytl::approx(multPos(mat, points[i]), eps));
+	}
+
+	VecSoA<3, float> soa(points);
+	VecSoA<3, float> soaOut(points.size());
+	multDir(pool, mat, soa, soaOut, 50);
+	for(auto i = 0u; i < points.size(); ++i) {
+		EXPECT(soaOut.get(i), nytl::approx(multDir(mat, points[i]), eps));
+	}
+}
@@ -45,3 +45,122 @@ TEST(nth) {
 	ERROR(nytl::nth(utf8a, 10, size), std::out_of_range);
 	EXPECT(std::string(nytl::nth(utf8a, 0).data()), std::string(u8"ä"));
 }
+
+TEST(valid) {
+	EXPECT(nytl::validUtf8(""), true);
+	EXPECT(nytl::validUtf8(utf8a), true);
+	EXPECT(nytl::validUtf8(utf8b), true);
+	EXPECT(nytl::validUtf8("\xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf \xed\x9f\xbf"), true);
+
+	EXPECT(nytl::validUtf8("\x80"), false); // continuation
+	EXPECT(nytl::validUtf8("\xc0\xaf"), false); // overlong
+	EXPECT(nytl::validUtf8("\xe0\x80\xaf"), false); // overlong
+	EXPECT(nytl::validUtf8("\xf0\x80\x80\xaf"), false); // overlong
+	EXPECT(nytl::validUtf8("\xed\xa0\x80"), false); // surrogate
+	EXPECT(nytl::validUtf8("\xf4\x90\x80\x80"), false); // > U+10FFFF
+	EXPECT(nytl::validUtf8("\xf8\x88\x80\x80\x80"), false); // 5 bytes
+	EXPECT(nytl::validUtf8("\xe7\x99"), false); // truncated
+	EXPECT(nytl::validUtf8("a\xe7\x99" "b"), false); // too short
+
+	// errors at every position of longer strings, covering the
+	// vectorized paths and their block boundaries
+	std::string text;
+	while(text.size() < 200) {
+		text += utf8a;
+		text += "ascii only text ";
+		text += utf8b;
+	}
+
+	EXPECT(nytl::validUtf8(text), true);
+	for(auto i = 0u; i < text.size(); ++i) {
+		auto copy = text;
+		copy[i] = char(0xFF);
+		EXPECT(nytl::validUtf8(copy), false);
+
+		// truncated
+		auto sub = std::string_view(text).substr(0, i);
+		auto complete = (i == text.size() || (text[i] & 0xC0) != 0x80);
+		EXPECT(nytl::validUtf8(sub), complete);
+	}
+}
+
+TEST(count) {
+	std::string text;
+	auto count = 0u;
+	while(text.size() < 10000) {
+		text += utf8a;
+		text += utf8b;
+		text += "abc";
+		count += 9 + 5 + 3;
+	}
+
+	EXPECT(nytl::charCount(text), count);
+
+	// truncated or malformed input never reads past the end
+	EXPECT(nytl::charCount("\xe7"), 1u);
+	EXPECT(nytl::charCount("a\xf0\x9f"), 2u);
+	EXPECT(nytl::charCount("\x80\x80"), 0u);
+	EXPECT(std::string(nytl::nth("a\xe7\x99", 1).data()), "\xe7\x99");
+	ERROR(nytl::nth("a\xe7\x99", 2), std::out_of_range);
+}
+
+TEST(transcode) {
+	// all directions, including surrogate pairs and block sized ascii runs
+	std::string utf8 = u8"äöüßabêéè\U0001F600" + std::string(40, 'x') + u8"百川生犬虫";
+	std::u16string utf16 = u"äöüßabêéè\U0001F600" + std::u16string(40, u'x') + u"百川生犬虫";
+	std::u32string utf32 = U"äöüßabêéè\U0001F600" + std::u32string(40, U'x') + U"百川生犬虫";
+
+	EXPECT(nytl::toUtf8(utf16), utf8);
+	EXPECT(nytl::toUtf8(utf32), utf8);
+	EXPECT(nytl::toUtf16(utf8), utf16);
+	EXPECT(nytl::toUtf16(utf32), utf16);
+	EXPECT(nytl::toUtf32(utf8), utf32);
+	EXPECT(nytl::toUtf32(utf16), utf32);
+
+	ERROR(nytl::toUtf16("\xc0\xaf"), std::range_error);
+	ERROR(nytl::toUtf32("ab\xe7\x99"), std::range_error);
+	ERROR(nytl::toUtf8(std::u16string(1, char16_t(0xDC00))), std::range_error);
+	ERROR(nytl::toUtf8(std::u32string(1, char32_t(0x110000))), std::range_error);
+	ERROR(nytl::toUtf16(std::u32string(1, char32_t(0xD800))), std::range_error);
+
+	// caller-provided buffers
+	char16_t buf16[8];
+	auto res = nytl::toUtf16(utf8, buf16);
+	EXPECT(res.status, nytl::UtfStatus::outputFull);
+	EXPECT(res.written, 8u);
+	EXPECT(res.read, 2 * 4u + 2u + 2 * 2u);
+	EXPECT(std::u16string(buf16, 8), utf16.substr(0, 8));
+
+	// surrogate pairs are never split
+	char16_t buf10[10];
+	res = nytl::toUtf16(utf32, buf10);
+	EXPECT(res.status, nytl::UtfStatus::outputFull);
+	EXPECT(res.read, 9u);
+	EXPECT(res.written, 9u);
+
+	char32_t buf32[4];
+	res = nytl::toUtf32("a\xe7\x99\xbe" "b\xe7\x99", buf32);
+	EXPECT(res.status, nytl::UtfStatus::incomplete);
+	EXPECT(res.read, 5u);
+	EXPECT(res.written, 3u);
+	EXPECT(buf32[1], U'百');
+
+	res = nytl::toUtf32("ab\xff" "c", buf32);
+	EXPECT(res.status, nytl::UtfStatus::invalid);
+	EXPECT(res.read, 2u);
+
+	char buf8[64];
+	res = nytl::toUtf8(utf32, buf8);
+	EXPECT(res.status, nytl::UtfStatus::outputFull);
+	EXPECT(std::string(buf8, res.written), utf8.substr(0, res.written));
+	res = nytl::toUtf8(std::u16string_view(u"\U0001F600"), nytl::span<char>(buf8, 3));
+	EXPECT(res.status, nytl::UtfStatus::outputFull);
+	EXPECT(res.written, 0u);
+
+	res = nytl::toUtf32(std::u16string_view(u"a\xD83D"), buf32);
+	EXPECT(res.status, nytl::UtfStatus::incomplete);
+	EXPECT(res.read, 1u);
+	res = nytl::toUtf16(std::string_view(), buf16);
+	EXPECT(res.status, nytl::UtfStatus::ok);
+	EXPECT(res.written, 0u);
+}
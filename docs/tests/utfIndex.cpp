@@ -0,0 +1,153 @@
+#include "test.hpp"
+#include <nytl/utfIndex.hpp>
+
+#include <string>
+#include <random>
+
+// Random utf8 string with characters of all lengths.
+std::string randomUtf8(std::mt19937& rng, std::size_t count) {
+	const char* chars[] = {"a", "z", " ", "\n", "ä", "ß", "ℝ", "€", "𝔠", "😀"};
+	std::uniform_int_distribution<std::size_t> dist(0u, std::size(chars) - 1);
+	std::string ret;
+	for(auto i = 0u; i < count; ++i) {
+		ret += chars[dist(rng)];
+	}
+
+	return ret;
+}
+
+// Compares all queries of the index against the linear functions.
+void check(const nytl::Utf8Index& index, std::string_view str) {
+	auto count = nytl::charCount(str);
+	EXPECT(index.charCount(), count);
+	EXPECT(index.string().data(), str.data());
+
+	for(auto i = 0u; i < count; ++i) {
+		std::uint8_t size;
+		auto& c = nytl::nth(str, i, size);
+		auto off = std::size_t(&c - str.data());
+		EXPECT(index.nth(i), str.substr(off, size));
+		EXPECT(index.offset(i), off);
+		EXPECT(index.charIndex(off), i);
+	}
+
+	EXPECT(index.offset(count), str.size());
+	EXPECT(index.charIndex(str.size()), count);
+	ERROR(index.nth(count), std::out_of_range);
+	ERROR(index.offset(count + 1), std::out_of_range);
+	ERROR(index.charIndex(str.size() + 1), std::out_of_range);
+}
+
+TEST(basic) {
+	std::string str = u8"äß€𝔠a";
+	nytl::Utf8Index index(str, 4u);
+	EXPECT(index.charCount(), 5u);
+	EXPECT(index.blockCount(), 3u);
+	EXPECT(index.nth(3), u8"𝔠");
+	EXPECT(index.offset(4), 11u);
+	EXPECT(index.charIndex(7), 3u);
+	EXPECT(index.charIndex(8), 4u); // inside 𝔠
+	check(index, str);
+
+	nytl::Utf8Index empty;
+	EXPECT(empty.charCount(), 0u);
+	EXPECT(empty.offset(0), 0u);
+	check(empty, {});
+
+	ERROR(nytl::Utf8Index(str, 0u), std::invalid_argument);
+}
+
+TEST(large) {
+	std::mt19937 rng(42);
+	auto str = randomUtf8(rng, 5000);
+	for(auto blockSize : {1u, 3u, 64u, 256u, 100000u}) {
+		nytl::Utf8Index index(str, blockSize);
+		check(index, str);
+	}
+}
+
+TEST(update) {
+	std::mt19937 rng(7);
+	auto str = randomUtf8(rng, 1000);
+	for(auto blockSize : {1u, 5u, 64u}) {
+		auto text = str;
+		nytl::Utf8Index index(text, blockSize);
+		for(auto i = 0u; i < 100; ++i) {
+			// replace a random range of characters
+			auto count = nytl::charCount(text);
+			auto first = std::uniform_int_distribution<std::size_t>(0u, count)(rng);
+			auto last = std::uniform_int_distribution<std::size_t>(first,
+				std::min(first + 200u, count))(rng);
+			auto insert = randomUtf8(rng, std::uniform_int_distribution(0, 150)(rng));
+
+			auto offset = index.offset(first);
+			auto removed = index.offset(last) - offset;
+			text.replace(offset, removed, insert);
+			index.update(text, offset, removed, insert.size());
+			check(index, text);
+		}
+
+		// remove everything
+		auto size = text.size();
+		text.clear();
+		index.update(text, 0u, size, 0u);
+		check(index, text);
+
+		text = "abc";
+		index.update(text, 0u, 0u, 3u);
+		check(index, text);
+	}
+
+	std::string text = "abc";
+	nytl::Utf8Index index(text);
+	ERROR(index.update(text, 4u, 0u, 0u), std::out_of_range);
+	ERROR(index.update(text, 1u, 3u, 3u), std::out_of_range);
+	ERROR(index.update(text, 1u, 1u, 2u), std::out_of_range);
+}
+
+TEST(blocks) {
+	// updates merge small blocks, blocks stay between
+	// blockSize / 2 and blockSize bytes large
+	std::string text(4096, 'a');
+	nytl::Utf8Index index(text, 128u);
+	EXPECT(index.blockCount(), 32u);
+
+	for(auto i = 0u; i < 5000; ++i) {
+		text.insert(100, u8"ä");
+		index.update(text, 100u, 0u, 2u);
+	}
+
+	EXPECT(index.blockCount() <= text.size() / 64u + 1u, true);
+	check(index, text);
+
+	// removing whole blocks
+	text.assign(4096, 'a');
+	index.rebuild(text);
+	while(text.size() > 192u) {
+		text.erase(128, 128u);
+		index.update(text, 128u, 128u, 0u);
+	}
+
+	EXPECT(index.blockCount(), 1u);
+	check(index, text);
+
+	auto size = text.size();
+	text.clear();
+	index.update(text, 0u, size, 0u);
+	EXPECT(index.blockCount(), 1u);
+	check(index, text);
+}
+
+TEST(edits) {
+	// edits in the middle of characters only change the counts
+	std::string text = u8"aäb";
+	nytl::Utf8Index index(text, 2u);
+	text.erase(1, 1); // remove the first byte of ä
+	index.update(text, 1u, 1u, 0u);
+	EXPECT(index.charCount(), 2u); // the continuation byte is not counted
+	EXPECT(index.offset(1), 2u);
+
+	text.insert(1, "\xC3"); // restore it
+	index.update(text, 1u, 0u, 1u);
+	check(index, text);
+}
@@ -0,0 +1,181 @@
+#include "test.hpp"
+#include <nytl/utfStream.hpp>
+
+#include <string>
+#include <random>
+
+// Converts the given input in chunks of the given size using an output
+// buffer of the given size.
+template<typename From, typename To>
+std::basic_string<To> convert(nytl::UtfTranscoder<From, To>& tc,
+		std::basic_string_view<From> in, std::size_t chunkSize, std::size_t bufSize) {
+	std::basic_string<To> ret;
+	To buf[16];
+	auto outSpan = nytl::span<To>(buf, bufSize);
+	for(auto i = 0u; i < in.size(); i += chunkSize) {
+		auto chunk = in.substr(i, chunkSize);
+		while(true) {
+			auto res = tc.convert(chunk, outSpan);
+			ret.append(buf, res.written);
+			chunk = chunk.substr(res.read);
+			if(res.status == nytl::UtfStatus::invalid) {
+				return ret;
+			} else if(res.status == nytl::UtfStatus::ok) {
+				EXPECT(chunk.size(), 0u);
+				break;
+			}
+
+			// the buffer must be large enough for at least one character
+			EXPECT(res.status, nytl::UtfStatus::outputFull);
+			EXPECT(res.read + res.written > 0u, true);
+			if(res.read + res.written == 0u) {
+				return ret;
+			}
+		}
+	}
+
+	while(true) {
+		auto res = tc.finish(outSpan);
+		ret.append(buf, res.written);
+		if(res.status != nytl::UtfStatus::outputFull || res.written == 0u) {
+			break;
+		}
+	}
+
+	return ret;
+}
+
+TEST(decoder) {
+	std::string utf8 = u8"äöüßabêéè\U0001F600百川生犬虫 some ascii text";
+	std::u32string utf32 = U"äöüßabêéè\U0001F600百川生犬虫 some ascii text";
+
+	nytl::Utf8Decoder<> dec;
+	for(auto chunk = 1u; chunk < 10u; ++chunk) {
+		for(auto buf = 1u; buf < 5u; ++buf) {
+			EXPECT(convert(dec, std::string_view(utf8), chunk, buf), utf32);
+			EXPECT(dec.pending(), false);
+		}
+	}
+
+	// partial characters are carried over
+	char32_t out[8];
+	auto res = dec.convert("a\xf0\x9f", out);
+	EXPECT(res.status, nytl::UtfStatus::ok);
+	EXPECT(res.read, 3u);
+	EXPECT(res.written, 1u);
+	EXPECT(dec.pending(), true);
+	res = dec.convert("\x98", out);
+	EXPECT(res.read, 1u);
+	EXPECT(res.written, 0u);
+	res = dec.convert("\x80" "b", out);
+	EXPECT(res.read, 2u);
+	EXPECT(res.written, 2u);
+	EXPECT(out[0], U'\U0001F600');
+	EXPECT(out[1], U'b');
+	EXPECT(dec.pending(), false);
+
+	// no space for the completed character
+	dec.convert("\xe7\x99", out);
+	res = dec.convert("\xbe", nytl::span<char32_t>(out, std::size_t(0u)));
+	EXPECT(res.status, nytl::UtfStatus::outputFull);
+	EXPECT(res.read, 0u);
+	res = dec.convert("\xbe", out);
+	EXPECT(res.status, nytl::UtfStatus::ok);
+	EXPECT(out[0], U'百');
+
+	// utf16 output
+	nytl::Utf8Decoder<char16_t> dec16;
+	EXPECT(convert(dec16, std::string_view(utf8), 3u, 2u), nytl::toUtf16(utf8));
+}
+
+TEST(replace) {
+	nytl::Utf8Decoder<> dec;
+	auto check = [&](std::string_view in, std::u32string_view expected) {
+		for(auto chunk = 1u; chunk <= in.size(); ++chunk) {
+			EXPECT(convert(dec, in, chunk, 3u), expected);
+		}
+	};
+
+	// maximal subparts are replaced
+	check("a\xf0\x9f\x98" "b", U"a�b");
+	check("\xc0\xaf", U"��");
+	check("\xe0\x80\xaf", U"���");
+	check("\xed\xa0\x80", U"���");
+	check("\xf4\x90\x80\x80", U"����");
+	check("\xe7\x99" "\xe7\x99\xbe", U"�百");
+	check("x\xe7\x99", U"x�");
+	check("\xff\xfe", U"��");
+
+	// utf16 input with split and unpaired surrogates
+	nytl::Utf8Encoder<char16_t> enc;
+	std::u16string utf16 = u"a\U0001F600b\U0001F601";
+	for(auto chunk = 1u; chunk < 5u; ++chunk) {
+		EXPECT(convert(enc, std::u16string_view(utf16), chunk, 5u), nytl::toUtf8(utf16));
+	}
+
+	std::u16string broken = u"a";
+	broken += char16_t(0xD83D);
+	broken += u"b";
+	broken += char16_t(0xDE00);
+	broken += char16_t(0xD83D);
+	EXPECT(convert(enc, std::u16string_view(broken), 1u, 3u), u8"a�b��");
+
+	nytl::Utf8Encoder<> enc32;
+	std::u32string utf32 = U"a";
+	utf32 += char32_t(0x110000);
+	EXPECT(convert(enc32, std::u32string_view(utf32), 1u, 3u), u8"a�");
+}
+
+TEST(strict) {
+	nytl::Utf8Decoder<> dec(nytl::UtfErrorMode::strict);
+	EXPECT(dec.mode(), nytl::UtfErrorMode::strict);
+
+	char32_t out[8];
+	auto res = dec.convert("ab\xff" "c", out);
+	EXPECT(res.status, nytl::UtfStatus::invalid);
+	EXPECT(res.read, 2u);
+	EXPECT(res.written, 2u);
+	EXPECT(dec.failed(), true);
+	EXPECT(dec.convert("c", out).status, nytl::UtfStatus::invalid);
+	EXPECT(dec.finish(out).status, nytl::UtfStatus::invalid);
+
+	dec.reset();
+	EXPECT(dec.failed(), false);
+	EXPECT(dec.convert("c\xe7", out).status, nytl::UtfStatus::ok);
+	res = dec.convert("d", out);
+	EXPECT(res.status, nytl::UtfStatus::invalid);
+	EXPECT(res.read, 0u);
+
+	// truncated input at the end
+	dec.reset();
+	EXPECT(dec.convert("c\xe7", out).status, nytl::UtfStatus::ok);
+	EXPECT(dec.finish(out).status, nytl::UtfStatus::invalid);
+
+	dec.reset();
+	EXPECT(dec.convert("\xe7\x99", out).status, nytl::UtfStatus::ok);
+	EXPECT(dec.convert("\xbe", out).status, nytl::UtfStatus::ok);
+	EXPECT(out[0], U'百');
+	EXPECT(dec.finish(out).status, nytl::UtfStatus::ok);
+}
+
+TEST(chunking) {
+	// the result does not depend on the chunk and buffer sizes
+	std::mt19937 rng(3);
+	const char* pieces[] = {"a", "\xc3\xa4", "\xe7\x99\xbe", "\xf0\x9f\x98\x80",
+		"\xff", "\x80", "\xe7\x99", "\xf0\x9f"};
+
+	nytl::Utf8Decoder<char16_t> dec;
+	for(auto i = 0u; i < 2000u; ++i) {
+		std::string in;
+		for(auto j = rng() % 20; j > 0; --j) {
+			in += pieces[rng() % 8];
+		}
+
+		auto whole = convert(dec, std::string_view(in), in.size() + 1, 16u);
+		auto chunked = convert(dec, std::string_view(in), 1 + rng() % 5, 2 + rng() % 3);
+		EXPECT(chunked, whole);
+		if(nytl::validUtf8(in)) {
+			EXPECT(whole, nytl::toUtf16(in));
+		}
+	}
+}
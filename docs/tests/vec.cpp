@@ -229,6 +229,44 @@ TEST(cross_product) {
 	// nytl::cross(Vec4d{1.0, 2.0, 3.0, 4.0}, d3b);
 }
 
+TEST(vec4) {
+	// specialization members
+	auto a = Vec4f{1.f, 2.f, 3.f, 4.f};
+	EXPECT(a.x, 1.f);
+	EXPECT(a.w, 4.f);
+	EXPECT(a[2], 3.f);
+	EXPECT(a.size(), 4u);
+	ERROR(a[4], std::out_of_range);
+	static_assert(sizeof(Vec4f) == sizeof(std::array<float, 4>));
+
+	// compile-time evaluation uses the scalar path
+	constexpr auto cd = nytl::dot(d4a, d4b);
+	constexpr auto cs = d4a + d4b - 2.0 * d4c;
+	EXPECT(nytl::dot(d4a, d4b), nytl::approx(cd));
+	EXPECT(d4a + d4b - 2.0 * d4c, nytl::approx(cs));
+
+	// runtime paths (might use simd, see nytl/simd.hpp)
+	auto b = Vec4f{-2.f, 0.5f, 8.f, -1.f};
+	auto c = a;
+	c += b;
+	EXPECT(c, (Vec4f{-1.f, 2.5f, 11.f, 3.f}));
+	c -= a;
+	EXPECT(c, b);
+	c *= 2.f;
+	EXPECT(c, (Vec4f{-4.f, 1.f, 16.f, -2.f}));
+	EXPECT(a - b, (Vec4f{3.f, 1.5f, -5.f, 5.f}));
+	EXPECT(nytl::dot(a, b), nytl::approx(19.f));
+	EXPECT(nytl::length(a), nytl::approx(std::sqrt(30.f)));
+	EXPECT(nytl::normalized(b), nytl::approx((1 / nytl::length(b)) * b));
+
+	using namespace nytl::vec::cw;
+	EXPECT(max(a, b), (Vec4f{1.f, 2.f, 8.f, 4.f}));
+	EXPECT(min(a, b), (Vec4f{-2.f, 0.5f, 3.f, -1.f}));
+	EXPECT(clamp(b, -1.f, 1.f), (Vec4f{-1.f, 0.5f, 1.f, -1.f}));
+	EXPECT(clamp(d4b, d4b, d4a), d4b);
+	EXPECT(clamp(d4b, 0.0, 1.0), (Vec4d{0.0, 0.0, 0.0, 0.0}));
+}
+
 TEST(component_wise) {
 	using namespace nytl::vec::cw;
 
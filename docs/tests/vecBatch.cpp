@@ -0,0 +1,133 @@
+#include "test.hpp"
+#include <nytl/vecBatch.hpp>
+#include <nytl/vecOps.hpp>
+#include <nytl/approx.hpp>
+#include <nytl/approxVec.hpp>
+
+#include <vector>
+
+using namespace nytl;
+
+// enough vectors to cover the widest simd blocks as well as the scalar rest
+template<size_t D, typename T>
+std::vector<Vec<D, T>> testVecs() {
+	std::vector<Vec<D, T>> ret;
+	for(auto i = 0u; i < 37; ++i) {
+		Vec<D, T> v {};
+		for(auto c = 0u; c < D; ++c) {
+			v[c] = T(1 + i) * T(c % 2 ? -1 : 1) + T(c * i % 5);
+		}
+		ret.push_back(v);
+	}
+	return ret;
+}
+
+TEST(ops) {
+	auto vecs = testVecs<3, float>();
+	auto others = vecs;
+	for(auto& v : others) {
+		v = Vec3f{v.y, 0.5f * v.x, v.z - 3.f};
+	}
+
+	span<const Vec3f> a = vecs;
+	std::vector<float> res(vecs.size());
+	dot(a, others, res);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(res[i], nytl::approx(dot(vecs[i], others[i])));
+	}
+
+	length(a, res);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(res[i], nytl::approx(length(vecs[i])));
+	}
+
+	distance(a, others, res);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(res[i], nytl::approx(distance(vecs[i], others[i])));
+	}
+
+	std::vector<Vec3f> out(vecs.size());
+	normalized(a, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], nytl::approx(normalized(vecs[i])));
+	}
+
+	cross(a, others, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], nytl::approx(cross(vecs[i], others[i])));
+	}
+
+	mix(a, others, 0.25f, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], nytl::approx(mix(vecs[i], others[i], 0.25f)));
+	}
+
+	// in place, output aliasing the input
+	out = vecs;
+	normalize(span<Vec3f>(out));
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], nytl::approx(normalized(vecs[i])));
+	}
+
+	out = others;
+	mix(a, out, 0.75f, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], nytl::approx(mix(vecs[i], others[i], 0.75f)));
+	}
+
+	// errors
+	std::vector<float> small(3);
+	ERROR(dot(a, others, small), std::invalid_argument);
+	ERROR(normalized(a, span<Vec3f>(out).first(2)), std::invalid_argument);
+}
+
+TEST(cw) {
+	auto vecs = testVecs<4, double>();
+	span<const Vec4d> a = vecs;
+	std::vector<Vec4d> out(vecs.size());
+
+	vec::cw::clamp(a, -2.0, 3.0, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], vec::cw::clamp(vecs[i], -2.0, 3.0));
+	}
+
+	auto low = Vec4d{0.0, -5.0, 0.0, 1.0};
+	auto high = Vec4d{2.0, 5.0, 1.0, 10.0};
+	vec::cw::clamp(a, low, high, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], vec::cw::clamp(vecs[i], low, high));
+	}
+
+	vec::cw::abs(a, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], vec::cw::abs(vecs[i]));
+	}
+
+	span<const Vec4d> absed = out;
+	vec::cw::sqrt(absed, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], nytl::approx(vec::cw::sqrt(vec::cw::abs(vecs[i]))));
+	}
+
+	vec::cw::sin(a, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], nytl::approx(vec::cw::sin(vecs[i])));
+	}
+}
+
+TEST(scalar) {
+	// types without simd path
+	auto vecs = testVecs<2, int>();
+	span<const Vec2i> a = vecs;
+	std::vector<int> res(vecs.size());
+	dot(a, a, res);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(res[i], dot(vecs[i], vecs[i]));
+	}
+
+	std::vector<Vec2i> out(vecs.size());
+	vec::cw::clamp(a, -3, 4, out);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(out[i], vec::cw::clamp(vecs[i], -3, 4));
+	}
+}
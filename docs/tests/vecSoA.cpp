@@ -0,0 +1,118 @@
+#include "test.hpp"
+#include <nytl/vecSoA.hpp>
+#include <nytl/vecOps.hpp>
+#include <nytl/approx.hpp>
+#include <nytl/approxVec.hpp>
+
+#include <vector>
+
+using namespace nytl;
+
+// some vectors that cover the simd blocks as well as the scalar rest
+std::vector<Vec3f> testVecs() {
+	std::vector<Vec3f> ret;
+	for(auto i = 0u; i < 11; ++i) {
+		auto f = float(i);
+		ret.push_back({1.f + f, -2.f * f + 3.f, 0.5f * f * f - 4.f});
+	}
+	return ret;
+}
+
+TEST(basic) {
+	auto vecs = testVecs();
+	VecSoA<3, float> soa(vecs);
+	EXPECT(soa.size(), vecs.size());
+	EXPECT(soa.empty(), false);
+
+	EXPECT(Vec3f(soa[2]), vecs[2]);
+	EXPECT(soa.get(5), vecs[5]);
+	EXPECT(soa[3][1], vecs[3][1]);
+	EXPECT(soa.lane(2)[7], vecs[7].z);
+
+	soa[1] = Vec3f{1.f, 2.f, 3.f};
+	EXPECT(soa.get(1), (Vec3f{1.f, 2.f, 3.f}));
+	soa[2] = soa[1];
+	EXPECT(soa.get(2), (Vec3f{1.f, 2.f, 3.f}));
+	soa[2][0] = 42.f;
+	EXPECT(soa.get(2).x, 42.f);
+	EXPECT(soa.get(1).x, 1.f);
+
+	soa.push_back({-1.f, -1.f, -1.f});
+	EXPECT(soa.size(), vecs.size() + 1);
+	EXPECT(soa.get(vecs.size()), (Vec3f{-1.f, -1.f, -1.f}));
+	soa.pop_back();
+
+	std::vector<Vec3f> out(soa.size());
+	soa.copyTo(out);
+	EXPECT(out[4], vecs[4]);
+	out.pop_back();
+	ERROR(soa.copyTo(out), std::invalid_argument);
+
+	soa.clear();
+	EXPECT(soa.empty(), true);
+
+	soa.resize(3, {1.f, 2.f, 3.f});
+	EXPECT(soa.get(2), (Vec3f{1.f, 2.f, 3.f}));
+}
+
+TEST(ops) {
+	auto vecs = testVecs();
+	VecSoA<3, float> a(vecs);
+	VecSoA<3, float> b(vecs.size(), Vec3f{1.f, -1.f, 2.f});
+
+	std::vector<float> res(vecs.size());
+	soa::dot(a, b, res);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(res[i], nytl::approx(dot(vecs[i], b.get(i))));
+	}
+
+	soa::length(a, res);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(res[i], nytl::approx(length(vecs[i])));
+	}
+
+	auto c = a;
+	soa::add(c, b);
+	soa::scale(c, 2.f);
+	soa::sub(c, b);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(c.get(i), nytl::approx(2.f * (vecs[i] + b.get(i)) - b.get(i)));
+	}
+
+	c = a;
+	soa::normalize(c);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(c.get(i), nytl::approx(normalized(vecs[i])));
+	}
+
+	c = a;
+	soa::max(c, b);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(c.get(i), vec::cw::max(vecs[i], b.get(i)));
+	}
+
+	c = a;
+	soa::min(c, b);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(c.get(i), vec::cw::min(vecs[i], b.get(i)));
+	}
+
+	c = a;
+	soa::clamp(c, -1.f, 1.f);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(c.get(i), vec::cw::clamp(vecs[i], -1.f, 1.f));
+	}
+
+	auto low = Vec3f{0.f, -5.f, 0.f};
+	auto high = Vec3f{2.f, 5.f, 1.f};
+	c = a;
+	soa::clamp(c, low, high);
+	for(auto i = 0u; i < vecs.size(); ++i) {
+		EXPECT(c.get(i), vec::cw::clamp(vecs[i], low, high));
+	}
+
+	// errors
+	VecSoA<3, float> small(2u);
+	ERROR(soa::add(c, small), std::invalid_argument);
+	ERROR(soa::dot(c, small, res), std::invalid_argument);
+}
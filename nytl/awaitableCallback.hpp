@@ -0,0 +1,230 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the AwaitableCallback class, a Callback that can be awaited
+/// in C++20 coroutines. Requires C++20.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_AWAITABLE_CALLBACK
+#define NYTL_INCLUDE_AWAITABLE_CALLBACK
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+	#error "nytl/awaitableCallback.hpp requires C++20 coroutines"
+#endif
+
+#include <nytl/callback.hpp> // nytl::Callback
+
+#include <coroutine> // std::coroutine_handle
+#include <functional> // std::function
+#include <optional> // std::optional
+#include <tuple> // std::tuple
+#include <type_traits> // std::decay_t
+#include <utility> // std::move
+#include <cstdint> // std::uint64_t
+
+namespace nytl {
+
+/// Callback whose calls can additionally be awaited from coroutines,
+/// e.g. `auto [x, y] = co_await callback.next();`.
+/// The awaiting coroutines are kept in an intrusive list in the
+/// awaiters (i.e. in the coroutine frames), awaiting and resuming therefore
+/// does not allocate.
+/// On call, all registered functions are called first. Afterwards, all
+/// coroutines that were awaiting at the moment of calling are resumed with
+/// copies of the arguments, in the order they started awaiting.
+/// Coroutines awaiting again after being resumed will be resumed by
+/// the next call.
+/// By default, coroutines are resumed inline from call. An executor
+/// can be set to schedule them instead, e.g. onto a nytl::ThreadPool.
+/// Destroying a suspended coroutine removes it from the waiting list.
+/// Destroying the callback while coroutines are awaiting it leaves them
+/// suspended forever, they must be destroyed by their owner.
+/// Like nytl::Callback, the class is not thread-safe in any way.
+/// \tparam Signature The signature of the registered functions. Must not
+/// have rvalue reference parameters since the arguments are passed on.
+template<typename Signature, typename ID = ConnectionID,
+	template<typename> typename Function = std::function>
+class AwaitableCallback;
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+class AwaitableCallback<Ret(Args...), ID, Function>
+		: public Callback<Ret(Args...), ID, Function> {
+public:
+	static_assert((true && ... && !std::is_rvalue_reference_v<Args>),
+		"nytl::AwaitableCallback: rvalue reference parameters not supported");
+
+	using Base = Callback<Ret(Args...), ID, Function>;
+	using Executor = Function<void(std::coroutine_handle<>)>;
+
+	/// The result of awaiting the callback: void for no parameters, the
+	/// decayed parameter for a single one, a tuple for multiple ones.
+	using Result = std::conditional_t<sizeof...(Args) == 0, void,
+		std::conditional_t<sizeof...(Args) == 1,
+			std::decay_t<std::tuple_element_t<0, std::tuple<Args..., void>>>,
+			std::tuple<std::decay_t<Args>...>>>;
+
+	class Awaiter;
+
+public:
+	AwaitableCallback() = default;
+	~AwaitableCallback();
+
+	/// Returns an awaiter that resumes the awaiting coroutine on the
+	/// next call. The awaiter must be awaited at most once.
+	Awaiter next() noexcept { return Awaiter(*this); }
+
+	/// Calls all registered functions, see nytl::Callback::call.
+	/// Afterwards resumes all coroutines awaiting the callback, or passes
+	/// them to the executor if there is one.
+	/// If a registered function throws, the exception is propagated and
+	/// the awaiting coroutines will be resumed on the next call.
+	/// Exceptions from resumed coroutines or the executor are propagated,
+	/// the remaining coroutines will be resumed on the next call.
+	auto call(Args...);
+
+	/// Operator version of call.
+	auto operator() (Args... a) {
+		return call(std::forward<Args>(a)...);
+	}
+
+	/// Sets the executor used to resume awaiting coroutines.
+	/// It will be called with the coroutine handle and must make sure
+	/// it is resumed exactly once. An empty executor resumes coroutines inline.
+	void executor(Executor exec) { executor_ = std::move(exec); }
+	const Executor& executor() const noexcept { return executor_; }
+
+	/// Returns whether there are coroutines awaiting the callback.
+	bool awaited() const noexcept { return head_; }
+
+protected:
+	void link(Awaiter& awaiter) noexcept;
+	void unlink(Awaiter& awaiter) noexcept;
+
+	Awaiter* head_ {};
+	Awaiter* tail_ {};
+	std::uint64_t callCount_ {}; // used to not resume awaiters added during call
+	Executor executor_ {};
+};
+
+/// Awaiter returned by AwaitableCallback::next.
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+class AwaitableCallback<Ret(Args...), ID, Function>::Awaiter {
+public:
+	Awaiter(Awaiter&&) = delete;
+	Awaiter& operator=(Awaiter&&) = delete;
+
+	~Awaiter() {
+		if(callback_ && linked_) {
+			callback_->unlink(*this);
+		}
+	}
+
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> handle) noexcept {
+		handle_ = handle;
+		callback_->link(*this);
+	}
+
+	Result await_resume() {
+		if constexpr(!std::is_void_v<Result>) {
+			if constexpr(sizeof...(Args) == 1) {
+				return std::get<0>(std::move(*value_));
+			} else {
+				return std::move(*value_);
+			}
+		}
+	}
+
+protected:
+	friend class AwaitableCallback;
+	explicit Awaiter(AwaitableCallback& cb) noexcept : callback_(&cb) {}
+
+	AwaitableCallback* callback_ {};
+	std::coroutine_handle<> handle_ {};
+	Awaiter* prev_ {};
+	Awaiter* next_ {};
+	std::uint64_t callCount_ {}; // the callCount_ of the callback when linked
+	bool linked_ {};
+	std::optional<std::tuple<std::decay_t<Args>...>> value_ {};
+};
+
+// - implementation -
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+AwaitableCallback<Ret(Args...), ID, Function>::~AwaitableCallback()
+{
+	for(auto it = head_; it;) {
+		auto next = it->next_;
+		it->callback_ = nullptr;
+		it->linked_ = false;
+		it = next;
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+auto AwaitableCallback<Ret(Args...), ID, Function>::call(Args... a)
+{
+	// only resume the awaiters that were awaiting when call started, not
+	// the ones that start awaiting from a registered function
+	auto count = callCount_++;
+	auto resume = [&]{
+		// Awaiters are unlinked one by one since resuming a coroutine
+		// might destroy others
+		while(head_ && head_->callCount_ <= count) {
+			auto& awaiter = *head_;
+			unlink(awaiter);
+			awaiter.value_.emplace(a...);
+			if(executor_) {
+				executor_(awaiter.handle_);
+			} else {
+				awaiter.handle_.resume();
+			}
+		}
+	};
+
+	if constexpr(std::is_void_v<Ret>) {
+		Base::call(a...);
+		resume();
+	} else {
+		auto ret = Base::call(a...);
+		resume();
+		return ret;
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void AwaitableCallback<Ret(Args...), ID, Function>::link(Awaiter& awaiter) noexcept
+{
+	awaiter.callCount_ = callCount_;
+	awaiter.linked_ = true;
+	awaiter.prev_ = tail_;
+	awaiter.next_ = nullptr;
+	if(tail_) {
+		tail_->next_ = &awaiter;
+	} else {
+		head_ = &awaiter;
+	}
+
+	tail_ = &awaiter;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void AwaitableCallback<Ret(Args...), ID, Function>::unlink(Awaiter& awaiter) noexcept
+{
+	(awaiter.prev_ ? awaiter.prev_->next_ : head_) = awaiter.next_;
+	(awaiter.next_ ? awaiter.next_->prev_ : tail_) = awaiter.prev_;
+	awaiter.prev_ = awaiter.next_ = nullptr;
+	awaiter.linked_ = false;
+}
+
+} // namespace nytl
+
+#endif // header guard
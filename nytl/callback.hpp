@@ -11,6 +11,7 @@
 
 #include <nytl/connection.hpp> // nytl::BasicConnection
 #include <nytl/nonCopyable.hpp> // nytl::NonCopyable
+#include <nytl/collector.hpp> // nytl::detail::collect
 #include <nytl/scope.hpp> // nytl::ScopeGuard
 
 #include <functional> // std::function
@@ -20,6 +21,7 @@
 #include <type_traits> // std::is_same
 #include <vector> // std::vector
 #include <limits> // std::numeric_limits
+#include <algorithm> // std::upper_bound, std::find_if
 #include <iostream> // std::cerr
 #include <stdexcept> // std::logic_error
 
@@ -39,12 +41,24 @@ namespace nytl {
 /// The class is not thread-safe in any way.
 /// All exceptions from calls are just propagated.
 /// The class can not be copied or moved.
+/// ! Not present in RecursiveCallback:
+/// Functions can be registered with a priority, functions with higher
+/// priority are called first, functions with the same priority in registration
+/// order. Functions can additionally be registered with a filter mask, allowing
+/// to call only the functions whose mask matches via callFiltered, e.g.
+/// to dispatch topics (one bit per topic) or nytl::Flags without calling
+/// functions that are not interested in it.
 ///
 /// \tparam Signature The signature of the registered functions.
 /// Uses the same syntax and semantics as std::function.
 /// \tparam ID A connectionID class, see nytl/connection.hpp for examples.
 /// See docs/callback.md for specification.
-template<typename Signature, typename ID = ConnectionID>
+/// \tparam Function The type used to store the registered functions, will be
+/// instantiated with the signature. Must be default- and move-constructible,
+/// callable and convertible to bool. Defaults to std::function, use e.g.
+/// nytl::InplaceFunction (nytl/inplaceFunction.hpp) to avoid allocations.
+template<typename Signature, typename ID = ConnectionID,
+	template<typename> typename Function = std::function>
 class Callback;
 
 /// Callback class typedef using TrackedConnectionID. Enables connections
@@ -53,9 +67,15 @@ class Callback;
 template<typename Signature> using TrackedCallback =
 	Callback<Signature, TrackedConnectionID>;
 
+/// Callback class typedef using PooledConnectionID. Same as the tracked
+/// version but does not allocate per connection.
+template<typename Signature> using PooledCallback =
+	Callback<Signature, PooledConnectionID>;
+
 // Callback specialization to enable the Ret(Args...) Signature format.
-template<typename Ret, typename... Args, typename ID>
-class Callback<Ret(Args...), ID>
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+class Callback<Ret(Args...), ID, Function>
 	: public ConnectableT<ID>, public NonCopyable {
 public:
 	/// ! Definition not present in RecursiveCallback
@@ -65,13 +85,19 @@ public:
 	/// remove subscriptions from the outside without actively
 	/// calling disconnect.
 	struct Subscription {
-		std::function<Ret(Args...)> func;
+		Function<Ret(Args...)> func;
 		ID id;
+		int priority {};
+		std::uint64_t filter {anyFilter};
 	};
 
 	using Signature = Ret(Args...);
+	using FunctionType = Function<Ret(Args...)>;
 	using Connection = ConnectionT<ConnectableT<ID>, ID>;
 
+	/// Filter mask matching everything, the default filter of a function.
+	static constexpr auto anyFilter = std::numeric_limits<std::uint64_t>::max();
+
 public:
 	Callback() = default;
 	~Callback();
@@ -79,8 +105,10 @@ public:
 	/// \brief Registers a new Callback function.
 	/// \returns A connection id for the registered function which can be used to
 	/// unregister it.
+	/// \param priority Functions with a higher priority are called first.
+	/// \param filter The filter mask of the function, see callFiltered.
 	/// \throws std::invalid_argument If an empty function target is registered.
-	Connection add(std::function<Ret(Args...)>);
+	Connection add(FunctionType, int priority = 0, std::uint64_t filter = anyFilter);
 
 	/// Calls all registered functions and returns a vector with the returned objects,
 	/// or void when this is a void callback.
@@ -90,6 +118,27 @@ public:
 	/// handlers will not be called.
 	auto call(Args...);
 
+	/// Calls all registered functions like call but passes the returned values
+	/// to the given collector instead of returning them in a vector, i.e. does
+	/// not allocate. If the collector returns a bool, false stops the iteration
+	/// and the following functions will not be called.
+	/// Returns the collector. See nytl/collector.hpp for predefined collectors.
+	/// Only available for non-void callbacks.
+	template<typename C>
+	C collect(C collector, Args...);
+
+	/// ! Not present in RecursiveCallback
+	/// Like call but only calls the functions whose filter has at least one
+	/// bit in common with the given mask. Functions that don't match are
+	/// skipped without being called.
+	auto callFiltered(std::uint64_t mask, Args...);
+
+	/// ! Not present in RecursiveCallback
+	/// Like collect but only calls the functions matching the given mask,
+	/// see callFiltered.
+	template<typename C>
+	C collectFiltered(C collector, std::uint64_t mask, Args...);
+
 	/// Clears all registered functions.
 	void clear() noexcept;
 
@@ -129,22 +178,26 @@ public:
 	}
 
 protected:
-	std::vector<Subscription> subs_ {}; // all subscriptions, ordered by id
+	// all subscriptions, ordered by priority (descending) and id
+	std::vector<Subscription> subs_ {};
 	std::int64_t subID_ {}; // the highest subscription id given
+	std::size_t prioritized_ {}; // number of subscriptions with priority != 0
 };
 
 // - implementation
-template<typename Ret, typename... Args, typename ID>
-Callback<Ret(Args...), ID>::~Callback()
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+Callback<Ret(Args...), ID, Function>::~Callback()
 {
 	for(auto& sub : subs_) {
 		sub.id.removed();
 	}
 }
 
-template<typename Ret, typename... Args, typename ID>
-ConnectionT<ConnectableT<ID>, ID> Callback<Ret(Args...), ID>::
-add(std::function<Ret(Args...)> func) {
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+ConnectionT<ConnectableT<ID>, ID> Callback<Ret(Args...), ID, Function>::
+add(FunctionType func, int priority, std::uint64_t filter) {
 	if(!func) {
 		throw std::invalid_argument("nytl::Callback::add: empty function");
 	}
@@ -160,15 +213,27 @@ add(std::function<Ret(Args...)> func) {
 	// our own state in any bad way
 	ID id = {subID_ + 1};
 
+	// insert after all subscriptions with a higher or equal priority.
+	// Usually this is the end
+	auto it = subs_.end();
+	if(!subs_.empty() && subs_.back().priority < priority) {
+		it = std::upper_bound(subs_.begin(), subs_.end(), priority,
+			[](int prio, const auto& sub) { return prio > sub.priority; });
+	}
+
 	++subID_;
-	subs_.emplace_back();
-	subs_.back().id = id;
-	subs_.back().func = std::move(func);
+	it = subs_.emplace(it);
+	it->id = id;
+	it->func = std::move(func);
+	it->priority = priority;
+	it->filter = filter;
+	prioritized_ += (priority != 0);
 	return {*this, id};
 }
 
-template<typename Ret, typename... Args, typename ID>
-auto Callback<Ret(Args...), ID>::call(Args... a)
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+auto Callback<Ret(Args...), ID, Function>::call(Args... a)
 {
 	// the first continue check is needed to not call functions that were
 	// removed before this call started but call functions that were removed
@@ -188,33 +253,103 @@ auto Callback<Ret(Args...), ID>::call(Args... a)
 	}
 }
 
-template<typename Ret, typename... Args, typename ID>
-void Callback<Ret(Args...), ID>::clear() noexcept
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+template<typename C>
+C Callback<Ret(Args...), ID, Function>::collect(C collector, Args... a)
+{
+	static_assert(!std::is_void_v<Ret>, "nytl::Callback::collect: void callback");
+	for(auto& sub : subs_) {
+		if(!detail::collect(collector, sub.func(std::forward<Args>(a)...))) {
+			break;
+		}
+	}
+
+	return collector;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+auto Callback<Ret(Args...), ID, Function>::callFiltered(std::uint64_t mask, Args... a)
+{
+	if constexpr(std::is_same<Ret, void>::value) {
+		for(auto& sub : subs_) {
+			if(sub.filter & mask) {
+				sub.func(std::forward<Args>(a)...);
+			}
+		}
+	} else {
+		std::vector<Ret> ret;
+		for(auto& sub : subs_) {
+			if(sub.filter & mask) {
+				ret.push_back(sub.func(std::forward<Args>(a)...));
+			}
+		}
+
+		return ret;
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+template<typename C>
+C Callback<Ret(Args...), ID, Function>::collectFiltered(C collector,
+		std::uint64_t mask, Args... a)
+{
+	static_assert(!std::is_void_v<Ret>, "nytl::Callback::collectFiltered: void callback");
+	for(auto& sub : subs_) {
+		if((sub.filter & mask) &&
+				!detail::collect(collector, sub.func(std::forward<Args>(a)...))) {
+			break;
+		}
+	}
+
+	return collector;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void Callback<Ret(Args...), ID, Function>::clear() noexcept
 {
 	// notify the ids of removal
 	for(auto& sub : subs_) {
 		sub.id.removed();
 	}
 	subs_.clear();
+	prioritized_ = 0u;
 }
 
-template<typename Ret, typename... Args, typename ID>
-bool Callback<Ret(Args...), ID>::disconnect(const ID& id) noexcept
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+bool Callback<Ret(Args...), ID, Function>::disconnect(const ID& id) noexcept
 {
 	constexpr auto pred = [](const auto& s1, const auto& s2) {
 		return s1.id.get() < s2.id.get();
 	};
 
-	// we know that id's are ordered
-	auto ds = Subscription{{}, id}; // dummy
-	auto range = std::equal_range(subs_.begin(), subs_.end(), ds, pred);
-	if(range.first == range.second) {
+	// when there are no prioritized subscriptions, the ids are ordered.
+	// Otherwise we have to search linearly, still O(n) like the erase
+	auto it = subs_.end();
+	if(prioritized_ == 0u) {
+		auto ds = Subscription{{}, id}; // dummy
+		auto range = std::equal_range(subs_.begin(), subs_.end(), ds, pred);
+		if(range.first != range.second) {
+			it = range.first;
+		}
+	} else {
+		auto value = id.get();
+		it = std::find_if(subs_.begin(), subs_.end(),
+			[&](const auto& sub) { return sub.id.get() == value; });
+	}
+
+	if(it == subs_.end()) {
 		return false;
 	}
 
-	// we can assume that there is only one item in the range
-	range.first->id.removed();
-	subs_.erase(range.first);
+	// we can assume that there is only one matching subscription
+	prioritized_ -= (it->priority != 0);
+	it->id.removed();
+	subs_.erase(it);
 	return true;
 }
 
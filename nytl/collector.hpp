@@ -0,0 +1,131 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines collectors for the return values of callback calls.
+/// A collector is a functor that is called with the return value of
+/// each called function, see e.g. nytl::Callback::collect.
+/// If it returns a bool, false signals that no further functions
+/// should be called. Collecting does not allocate.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_COLLECTOR
+#define NYTL_INCLUDE_COLLECTOR
+
+#include <type_traits> // std::invoke_result_t
+#include <functional> // std::plus
+#include <optional> // std::optional
+#include <utility> // std::forward
+
+namespace nytl {
+namespace detail {
+	/// Passes the given value to the collector.
+	/// Returns whether the next value should be collected.
+	template<typename C, typename T>
+	bool collect(C& collector, T&& value) {
+		if constexpr(std::is_same_v<std::invoke_result_t<C&, T&&>, bool>) {
+			return collector(std::forward<T>(value));
+		} else {
+			collector(std::forward<T>(value));
+			return true;
+		}
+	}
+} // namespace detail
+
+/// Writes all values to the given output iterator.
+template<typename It>
+struct OutputCollector {
+	It it;
+
+	template<typename T>
+	void operator()(T&& val) {
+		*it = std::forward<T>(val);
+		++it;
+	}
+};
+
+/// Returns a collector writing all values to the given output iterator.
+template<typename It>
+OutputCollector<It> collectInto(It it) {
+	return {std::move(it)};
+}
+
+/// Stores the first value, stops after it.
+template<typename T>
+struct FirstValue {
+	std::optional<T> value {};
+
+	bool operator()(T val) {
+		value = std::move(val);
+		return false;
+	}
+};
+
+/// Stores the last value.
+template<typename T>
+struct LastValue {
+	std::optional<T> value {};
+
+	void operator()(T val) {
+		value = std::move(val);
+	}
+};
+
+/// Stores the first value that is not empty (i.e. that converts to true,
+/// e.g. a non-null pointer or a non-empty std::optional), stops after it.
+/// Otherwise value will remain default-initialized.
+template<typename T>
+struct FirstNonEmpty {
+	T value {};
+
+	bool operator()(T val) {
+		if(!static_cast<bool>(val)) {
+			return true;
+		}
+
+		value = std::move(val);
+		return false;
+	}
+};
+
+/// Checks whether all values convert to true, stops at the first that doesn't.
+/// Is true if there are no values.
+struct AllOf {
+	bool value {true};
+
+	template<typename T>
+	bool operator()(const T& val) {
+		value = static_cast<bool>(val);
+		return value;
+	}
+};
+
+/// Checks whether any value converts to true, stops at the first that does.
+/// Is false if there are no values.
+struct AnyOf {
+	bool value {false};
+
+	template<typename T>
+	bool operator()(const T& val) {
+		value = static_cast<bool>(val);
+		return !value;
+	}
+};
+
+/// Combines all values using the given operation, starting with
+/// the initial value, e.g. `nytl::Fold<int>{0}` sums up all values.
+template<typename T, typename Op = std::plus<>>
+struct Fold {
+	T value {};
+	Op op {};
+
+	template<typename V>
+	void operator()(V&& val) {
+		value = op(std::move(value), std::forward<V>(val));
+	}
+};
+
+} // namespace nytl
+
+#endif // header guard
@@ -0,0 +1,418 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the thread-safe ConcurrentCallback template class.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_CONCURRENT_CALLBACK
+#define NYTL_INCLUDE_CONCURRENT_CALLBACK
+
+#include <nytl/connection.hpp> // nytl::BasicConnection
+#include <nytl/nonCopyable.hpp> // nytl::NonCopyable
+#include <nytl/collector.hpp> // nytl::detail::collect
+#include <nytl/scope.hpp> // nytl::ScopeGuard
+
+#include <functional> // std::function
+#include <utility> // std::move
+#include <cstdint> // std::uint64_t
+#include <cstddef> // std::size_t
+#include <type_traits> // std::is_same
+#include <vector> // std::vector
+#include <memory> // std::unique_ptr
+#include <atomic> // std::atomic
+#include <mutex> // std::mutex
+#include <algorithm> // std::lower_bound
+#include <limits> // std::numeric_limits
+#include <iostream> // std::cerr
+#include <stdexcept> // std::invalid_argument
+
+namespace nytl {
+
+/// A thread-safe Callback. Functions can be added, disconnected and called
+/// from any thread, including from within a registered function.
+/// The public interface is mostly identical with nytl::Callback.
+///
+/// Calling is wait-free: a call only registers itself as active and then
+/// iterates over an immutable snapshot of the registered functions.
+/// add, disconnect and clear are serialized with a mutex. They publish a new
+/// snapshot and retire the old one, which is destroyed as soon as there is a
+/// moment without any active call (either from the next modification or from
+/// the last active call).
+/// This means that modifications are O(n) but never block or slow down calls,
+/// making this suitable for callbacks that are called much more often than
+/// they are modified.
+///
+/// A call will call the functions registered at the moment the call started.
+/// After disconnect returns the function will not be called by calls started
+/// later on, but calls that are in progress on other threads (or the current
+/// one, when disconnecting from within a registered function) might still
+/// call it. Registered functions must therefore be safe to call concurrently.
+/// The ID is not synchronized, ID::removed() is called from the thread that
+/// disconnected the function, see docs/callback.md.
+/// All exceptions from calls are just propagated.
+/// The callback must not be destroyed while it is called or modified.
+///
+/// \tparam Signature The signature of the registered functions.
+/// \tparam ID A connectionID class, see nytl/connection.hpp for examples.
+/// \tparam Function The type used to store the registered functions,
+/// see nytl::Callback.
+template<typename Signature, typename ID = ConnectionID,
+	template<typename> typename Function = std::function>
+class ConcurrentCallback;
+
+/// ConcurrentCallback class typedef using TrackedConnectionID.
+template<typename Signature> using TrackedConcurrentCallback =
+	ConcurrentCallback<Signature, TrackedConnectionID>;
+
+// ConcurrentCallback specialization to enable the Ret(Args...) Signature format.
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+class ConcurrentCallback<Ret(Args...), ID, Function>
+	: public ConnectableT<ID>, public NonCopyable {
+public:
+	using Signature = Ret(Args...);
+	using FunctionType = Function<Ret(Args...)>;
+	using Connection = ConnectionT<ConnectableT<ID>, ID>;
+
+public:
+	ConcurrentCallback() = default;
+	~ConcurrentCallback();
+
+	/// \brief Registers a new Callback function.
+	/// \returns A connection id for the registered function which can be used to
+	/// unregister it.
+	/// \throws std::invalid_argument If an empty function target is registered.
+	Connection add(FunctionType);
+
+	/// Calls all registered functions and returns a vector with the returned objects,
+	/// or void when this is a void callback.
+	/// Will call all the functions registered at the moment of calling, i.e.
+	/// additional functions added from within or from other threads are not called.
+	/// If a registered function throws, the exception is not caught, i.e. the following
+	/// handlers will not be called.
+	auto call(Args...);
+
+	/// Calls all registered functions like call but passes the returned values
+	/// to the given collector instead of returning them in a vector, i.e. does
+	/// not allocate. If the collector returns a bool, false stops the iteration
+	/// and the following functions will not be called.
+	/// Returns the collector. See nytl/collector.hpp for predefined collectors.
+	/// Only available for non-void callbacks.
+	template<typename C>
+	C collect(C collector, Args...);
+
+	/// Clears all registered functions.
+	void clear() noexcept;
+
+	/// Removes the callback function registered with the given id.
+	/// Returns whether the function could be found. If the id is invalid or the
+	/// associated function was already removed, returns false.
+	/// Passing an invalid id or an id that was not returned from this
+	/// callback is undefined behvaiour.
+	bool disconnect(const ID&) noexcept override;
+
+	/// Operator version of add
+	template<typename F>
+	Connection operator+=(F&& func) {
+		return add(std::forward<F>(func));
+	}
+
+	/// Operator version of add that previously calls clear.
+	/// Note that this is not atomic, i.e. functions added from other
+	/// threads between clear and add are kept.
+	template<typename F>
+	Connection operator=(F&& func) {
+		clear();
+		return add(std::forward<F>(func));
+	}
+
+	/// Operator version of call.
+	auto operator() (Args... a) {
+		return call(std::forward<Args>(a)...);
+	}
+
+	/// Returns the number of registered functions.
+	/// Just a snapshot, might be outdated when it returns.
+	std::size_t size() const noexcept;
+
+protected:
+	struct Subscription {
+		FunctionType func;
+		ID id;
+		Subscription* nextRetired {}; // intrusive retired/pending list
+	};
+
+	// Immutable list of subscriptions as seen by calls.
+	struct Snapshot {
+		std::vector<Subscription*> subs;
+		mutable const Snapshot* nextRetired {}; // intrusive retired list
+	};
+
+	// Publishes a new snapshot of subs_ and retires the old one.
+	// Only throws when the new snapshot can't be allocated, in which
+	// case nothing is changed.
+	// Must be called with mutex_ locked.
+	void publish();
+
+	// Adds the given snapshot to the retired list.
+	// Must be called with mutex_ locked.
+	void retire(const Snapshot*) noexcept;
+
+	// Destroys all retired snapshots and subscriptions if there is no active call.
+	// Must be called with mutex_ locked.
+	void reclaim() noexcept;
+
+	// Unregisters an active call.
+	void finishCall() noexcept {
+		// the last active call reclaims if possible. Never blocks
+		// since it only tries to lock the mutex
+		if(--active_ == 0 && retired_.load(std::memory_order_relaxed)) {
+			std::unique_lock lock(mutex_, std::try_to_lock);
+			if(lock.owns_lock()) {
+				reclaim();
+			}
+		}
+	}
+
+	std::atomic<const Snapshot*> snapshot_ {}; // current snapshot, null if empty
+	std::atomic<unsigned> active_ {}; // the number of active calls
+	std::atomic<bool> retired_ {}; // whether there is anything to reclaim
+
+	mutable std::mutex mutex_; // guards all members below
+	std::vector<std::unique_ptr<Subscription>> subs_ {}; // ordered by id
+	const Snapshot* retiredSnapshots_ {}; // no longer published
+	Subscription* retiredSubs_ {}; // no longer in the published snapshot
+	Subscription* pendingSubs_ {}; // removed but maybe still published
+	std::int64_t subID_ {}; // the highest subscription id given
+};
+
+// - implementation -
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+ConcurrentCallback<Ret(Args...), ID, Function>::~ConcurrentCallback()
+{
+	if(active_.load()) {
+		std::cerr << "nytl::~ConcurrentCallback: active calls: " << active_.load() << "\n";
+	}
+
+	for(auto& sub : subs_) {
+		sub->id.removed();
+	}
+
+	retire(snapshot_.exchange(nullptr));
+	active_.store(0);
+	reclaim();
+	for(auto* sub = pendingSubs_; sub;) {
+		delete std::exchange(sub, sub->nextRetired);
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+ConnectionT<ConnectableT<ID>, ID> ConcurrentCallback<Ret(Args...), ID, Function>::
+add(FunctionType func) {
+	if(!func) {
+		throw std::invalid_argument("nytl::ConcurrentCallback::add: empty function");
+	}
+
+	auto sub = std::make_unique<Subscription>();
+	sub->func = std::move(func);
+
+	std::lock_guard lock(mutex_);
+
+	// output at least a warning when subID_ has to be wrapped
+	// Usually this should not happen. Bad things can happen then.
+	if(subID_ == std::numeric_limits<std::int64_t>::max()) {
+		std::cerr << "nytl::ConcurrentCallback::add: <warning> wrapping subID_\n";
+		subID_ = 0;
+	}
+
+	// this expression might throw. In this case we have not changed
+	// our own state in any bad way
+	sub->id = ID{subID_ + 1};
+	subs_.push_back(std::move(sub));
+
+	try {
+		publish();
+	} catch(...) {
+		subs_.pop_back();
+		throw;
+	}
+
+	++subID_;
+	return {*this, subs_.back()->id};
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+auto ConcurrentCallback<Ret(Args...), ID, Function>::call(Args... a)
+{
+	// Registering as active before loading the snapshot guarantees
+	// that it won't be destroyed until we are finished, see reclaim.
+	++active_;
+	auto guard = ScopeGuard([&]{ finishCall(); });
+
+	auto snapshot = snapshot_.load();
+	if constexpr(std::is_same<Ret, void>::value) {
+		if(snapshot) {
+			for(auto* sub : snapshot->subs) {
+				sub->func(std::forward<Args>(a)...);
+			}
+		}
+	} else {
+		std::vector<Ret> ret;
+		if(snapshot) {
+			ret.reserve(snapshot->subs.size());
+			for(auto* sub : snapshot->subs) {
+				ret.push_back(sub->func(std::forward<Args>(a)...));
+			}
+		}
+
+		return ret;
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+template<typename C>
+C ConcurrentCallback<Ret(Args...), ID, Function>::collect(C collector, Args... a)
+{
+	static_assert(!std::is_void_v<Ret>, "nytl::ConcurrentCallback::collect: void callback");
+	++active_;
+	auto guard = ScopeGuard([&]{ finishCall(); });
+
+	auto snapshot = snapshot_.load();
+	if(snapshot) {
+		for(auto* sub : snapshot->subs) {
+			if(!detail::collect(collector, sub->func(std::forward<Args>(a)...))) {
+				break;
+			}
+		}
+	}
+
+	return collector;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void ConcurrentCallback<Ret(Args...), ID, Function>::clear() noexcept
+{
+	std::lock_guard lock(mutex_);
+
+	// publishing an empty snapshot does not allocate
+	retire(snapshot_.exchange(nullptr));
+	for(auto& sub : subs_) {
+		sub->id.removed();
+		sub->nextRetired = retiredSubs_;
+		retiredSubs_ = sub.release();
+	}
+
+	subs_.clear();
+	reclaim();
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+bool ConcurrentCallback<Ret(Args...), ID, Function>::disconnect(const ID& id) noexcept
+{
+	std::lock_guard lock(mutex_);
+
+	// we know that ids are ordered
+	auto it = std::lower_bound(subs_.begin(), subs_.end(), id.get(),
+		[](const auto& sub, std::int64_t val) { return sub->id.get() < val; });
+	if(it == subs_.end() || (*it)->id.get() != id.get()) {
+		return false;
+	}
+
+	(*it)->id.removed();
+	auto sub = it->release();
+	subs_.erase(it);
+
+	// the subscription is retired with the next successfully published snapshot
+	sub->nextRetired = pendingSubs_;
+	pendingSubs_ = sub;
+
+	try {
+		publish();
+	} catch(const std::exception& err) {
+		// The function will still be called until the next successful
+		// modification. Not much else we can do here.
+		std::cerr << "nytl::ConcurrentCallback::disconnect: " << err.what() << "\n";
+	}
+
+	reclaim();
+	return true;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+std::size_t ConcurrentCallback<Ret(Args...), ID, Function>::size() const noexcept
+{
+	std::lock_guard lock(mutex_);
+	return subs_.size();
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void ConcurrentCallback<Ret(Args...), ID, Function>::publish()
+{
+	std::unique_ptr<Snapshot> next;
+	if(!subs_.empty()) {
+		next = std::make_unique<Snapshot>();
+		next->subs.reserve(subs_.size());
+		for(auto& sub : subs_) {
+			next->subs.push_back(sub.get());
+		}
+	}
+
+	retire(snapshot_.exchange(next.release()));
+
+	// pending subscriptions are not referenced by the new snapshot
+	while(pendingSubs_) {
+		auto* sub = std::exchange(pendingSubs_, pendingSubs_->nextRetired);
+		sub->nextRetired = retiredSubs_;
+		retiredSubs_ = sub;
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void ConcurrentCallback<Ret(Args...), ID, Function>::retire(const Snapshot* snapshot) noexcept
+{
+	if(snapshot) {
+		snapshot->nextRetired = retiredSnapshots_;
+		retiredSnapshots_ = snapshot;
+		retired_.store(true, std::memory_order_relaxed);
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void ConcurrentCallback<Ret(Args...), ID, Function>::reclaim() noexcept
+{
+	// All retired objects were unpublished before they were retired.
+	// Every call that might have loaded them registered as active before
+	// doing so. So if there are no active calls (after they were retired),
+	// no one can still access them.
+	if(active_.load() != 0) {
+		return;
+	}
+
+	for(auto* snapshot = retiredSnapshots_; snapshot;) {
+		delete std::exchange(snapshot, snapshot->nextRetired);
+	}
+
+	for(auto* sub = retiredSubs_; sub;) {
+		delete std::exchange(sub, sub->nextRetired);
+	}
+
+	retiredSnapshots_ = nullptr;
+	retiredSubs_ = nullptr;
+	retired_.store(pendingSubs_, std::memory_order_relaxed);
+}
+
+} // namespace nytl
+
+#endif // header guard
@@ -12,6 +12,10 @@
 #include <iostream> // std::cerr
 #include <exception> // std::exception
 #include <memory> // std::shared_ptr
+#include <vector> // std::vector
+#include <mutex> // std::mutex
+#include <cstdint> // std::int64_t
+#include <cstddef> // std::size_t
 
 namespace nytl {
 
@@ -182,6 +186,102 @@ struct TrackedConnectionID {
 	void removed() noexcept { if(value) *value = 0; value.reset(); }
 };
 
+namespace detail {
+
+/// Entry in the generation table used by PooledConnectionID.
+struct PooledIDEntry {
+	std::int64_t value;
+	std::uint64_t generation;
+	PooledIDEntry* nextFree;
+};
+
+/// Per-thread pool of PooledIDEntry objects.
+/// Entries are allocated in chunks that are never freed, i.e. entries
+/// stay valid for the lifetime of the program and can be released
+/// on any thread.
+class PooledIDPool {
+public:
+	static constexpr std::size_t chunkSize = 256u;
+
+	static PooledIDPool& get() noexcept {
+		thread_local PooledIDPool pool;
+		return pool;
+	}
+
+	PooledIDEntry& alloc() {
+		if(!free_) {
+			grow();
+		}
+
+		auto& entry = *free_;
+		free_ = entry.nextFree;
+		return entry;
+	}
+
+	void release(PooledIDEntry& entry) noexcept {
+		entry.nextFree = free_;
+		free_ = &entry;
+	}
+
+protected:
+	void grow() {
+		// the chunks are kept reachable (and never destroyed) since ids
+		// might be used during static destruction or after the thread exited
+		static std::mutex mutex;
+		static auto* chunks = new std::vector<std::unique_ptr<PooledIDEntry[]>>();
+
+		auto chunk = std::make_unique<PooledIDEntry[]>(chunkSize);
+		for(auto i = 0u; i < chunkSize; ++i) {
+			chunk[i].nextFree = (i + 1 < chunkSize) ? &chunk[i + 1] : free_;
+		}
+
+		auto* first = chunk.get();
+		{
+			std::lock_guard lock(mutex);
+			chunks->push_back(std::move(chunk));
+		}
+
+		free_ = first;
+	}
+
+	PooledIDEntry* free_ {};
+};
+
+} // namespace detail
+
+/// Alternative to TrackedConnectionID that does not allocate per connection.
+/// The id value is stored in an entry of a pooled generation table, copies
+/// store a pointer to the entry and the generation they were created for.
+/// When the connection is removed, the generation of the entry is increased
+/// (which invalidates all copies) and the entry is reused for a new connection.
+/// Copying is trivial, i.e. there is no reference counting.
+/// Not synchronized in any way, all copies of one id must not be accessed
+/// from multiple threads at the same time.
+struct PooledConnectionID {
+	detail::PooledIDEntry* entry {};
+	std::uint64_t generation {};
+
+	PooledConnectionID() = default;
+	PooledConnectionID(std::int64_t val) :
+			entry(&detail::PooledIDPool::get().alloc()) {
+		entry->value = val;
+		generation = entry->generation;
+	}
+
+	bool valid() const noexcept { return entry && entry->generation == generation; }
+	void set(std::int64_t val) noexcept { if(valid()) entry->value = val; }
+	auto get() const noexcept { return valid() ? entry->value : std::int64_t(0); }
+	void removed() noexcept {
+		if(valid()) {
+			entry->value = 0;
+			++entry->generation;
+			detail::PooledIDPool::get().release(*entry);
+		}
+
+		entry = nullptr;
+	}
+};
+
 using Connectable = ConnectableT<ConnectionID>;
 using Connection = ConnectionT<Connectable, ConnectionID>;
 using UniqueConnection = UniqueConnectionT<Connectable, ConnectionID>;
@@ -190,6 +290,10 @@ using TrackedConnectable = ConnectableT<TrackedConnectionID>;
 using TrackedConnection = ConnectionT<TrackedConnectable, TrackedConnectionID>;
 using TrackedUniqueConnection = UniqueConnectionT<TrackedConnectable, TrackedConnectionID>;
 
+using PooledConnectable = ConnectableT<PooledConnectionID>;
+using PooledConnection = ConnectionT<PooledConnectable, PooledConnectionID>;
+using PooledUniqueConnection = UniqueConnectionT<PooledConnectable, PooledConnectionID>;
+
 // TODO: remove
 /*
 constexpr inline bool operator==(ConnectionID a, ConnectionID b)
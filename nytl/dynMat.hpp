@@ -0,0 +1,252 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the nytl::DynMat dynamically sized matrix class.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_DYN_MAT
+#define NYTL_INCLUDE_DYN_MAT
+
+#include <nytl/mat.hpp> // nytl::Mat
+#include <nytl/span.hpp> // nytl::span
+#include <nytl/simd.hpp> // nytl::detail::simd
+
+#include <vector> // std::vector
+#include <new> // std::align_val_t
+#include <stdexcept> // std::out_of_range
+#include <algorithm> // std::equal
+
+namespace nytl {
+namespace detail {
+	/// Allocator that aligns all allocations to Align bytes.
+	template<typename T, size_t Align>
+	struct AlignedAllocator {
+		using value_type = T;
+		template<typename O> struct rebind { using other = AlignedAllocator<O, Align>; };
+
+		AlignedAllocator() noexcept = default;
+		template<typename O>
+		AlignedAllocator(const AlignedAllocator<O, Align>&) noexcept {}
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+		}
+
+		void deallocate(T* ptr, size_t) noexcept {
+			::operator delete(ptr, std::align_val_t(Align));
+		}
+
+		template<typename O>
+		bool operator==(const AlignedAllocator<O, Align>&) const noexcept { return true; }
+		template<typename O>
+		bool operator!=(const AlignedAllocator<O, Align>&) const noexcept { return false; }
+	};
+} // namespace detail
+
+/// \brief Matrix with a size that is only known at runtime.
+/// The values are stored contiguously with row-major semantics, i.e.
+/// row r starts at data() + r * cols(). The storage is aligned to
+/// a cache line (64 bytes).
+/// Operations (with the same names as for nytl::Mat in matOps.hpp) are
+/// implemented in nytl/dynMatOps.hpp.
+template<typename T>
+class DynMat {
+public:
+	static constexpr auto alignment = 64u;
+	using Value = T;
+	using Storage = std::vector<T, detail::AlignedAllocator<T, alignment>>;
+
+	/// Returns the identity matrix with the given size.
+	static DynMat identity(size_t size) {
+		DynMat ret(size, size);
+		for(auto i = 0u; i < size; ++i) {
+			ret(i, i) = T{1};
+		}
+
+		return ret;
+	}
+
+public:
+	DynMat() = default;
+	DynMat(size_t rows, size_t cols, const T& value = {}) :
+		rows_(rows), cols_(cols), data_(rows * cols, value) {}
+
+	/// Converts the values of another DynMat.
+	template<typename OT>
+	explicit DynMat(const DynMat<OT>& other) : DynMat(other.rows(), other.cols()) {
+		std::copy(other.data(), other.data() + other.size(), data());
+	}
+
+	/// Creates a DynMat with the same size and values as the given Mat.
+	template<size_t R, size_t C, typename OT>
+	explicit DynMat(const Mat<R, C, OT>& mat) : DynMat(R, C) {
+		for(auto r = 0u; r < R; ++r) {
+			for(auto c = 0u; c < C; ++c) {
+				(*this)(r, c) = mat[r][c];
+			}
+		}
+	}
+
+	size_t rows() const { return rows_; }
+	size_t cols() const { return cols_; }
+	size_t size() const { return data_.size(); }
+	bool empty() const { return data_.empty(); }
+
+	T* data() { return data_.data(); }
+	const T* data() const { return data_.data(); }
+
+	/// Returns the row with index r.
+	span<T> operator[](size_t r) { return {data() + r * cols_, cols_}; }
+	span<const T> operator[](size_t r) const { return {data() + r * cols_, cols_}; }
+
+	T& operator()(size_t r, size_t c) { return data_[r * cols_ + c]; }
+	const T& operator()(size_t r, size_t c) const { return data_[r * cols_ + c]; }
+
+	/// Returns the value at position (r, c).
+	/// If this position exceeds the size of the matrix, throws std::out_of_range.
+	T& at(size_t r, size_t c) { check(r, c); return (*this)(r, c); }
+	const T& at(size_t r, size_t c) const { check(r, c); return (*this)(r, c); }
+
+	/// Changes the size of the matrix. Since rows are stored contiguously,
+	/// the values are only preserved if the number of columns stays the same.
+	void resize(size_t rows, size_t cols, const T& value = {}) {
+		rows_ = rows;
+		cols_ = cols;
+		data_.resize(rows * cols, value);
+	}
+
+	/// Explicitly converts to a Mat, the sizes must match
+	/// (otherwise throws std::invalid_argument).
+	template<size_t R, size_t C, typename OT>
+	explicit operator Mat<R, C, OT>() const {
+		if(R != rows_ || C != cols_) {
+			throw std::invalid_argument("nytl::DynMat: invalid Mat conversion");
+		}
+
+		Mat<R, C, OT> ret {};
+		for(auto r = 0u; r < R; ++r) {
+			for(auto c = 0u; c < C; ++c) {
+				ret[r][c] = (*this)(r, c);
+			}
+		}
+
+		return ret;
+	}
+
+protected:
+	void check(size_t r, size_t c) const {
+		if(r >= rows_ || c >= cols_) {
+			throw std::out_of_range("nytl::DynMat::at");
+		}
+	}
+
+	size_t rows_ {};
+	size_t cols_ {};
+	Storage data_ {};
+};
+
+namespace detail {
+	inline void checkSameSize(size_t r1, size_t c1, size_t r2, size_t c2) {
+		if(r1 != r2 || c1 != c2) {
+			throw std::invalid_argument("nytl::DynMat: size mismatch");
+		}
+	}
+
+	/// Computes the rows [rbegin, rend) of out += a * b.
+	/// Tiled so that the used part of b stays in cache while it is
+	/// applied to all rows. The innermost loop is a contiguous
+	/// (SIMD) axpy on row slices.
+	template<typename T>
+	void mulRows(DynMat<T>& out, const DynMat<T>& a, const DynMat<T>& b,
+			size_t rbegin, size_t rend) {
+		constexpr auto tileK = 64u;
+		constexpr auto tileC = 256u;
+		for(auto kb = 0u; kb < a.cols(); kb += tileK) {
+			auto ke = std::min<size_t>(kb + tileK, a.cols());
+			for(auto cb = 0u; cb < b.cols(); cb += tileC) {
+				auto cw = std::min<size_t>(tileC, b.cols() - cb);
+				for(auto r = rbegin; r < rend; ++r) {
+					for(auto k = kb; k < ke; ++k) {
+						simd::axpyN(&out(r, cb), a(r, k), &b(k, cb), cw);
+					}
+				}
+			}
+		}
+	}
+} // namespace detail
+
+/// Matrix multiplication, throws std::invalid_argument if a.cols() != b.rows().
+/// See nytl::multiply in dynMatOps.hpp for a multi-threaded version.
+template<typename T>
+DynMat<T> operator*(const DynMat<T>& a, const DynMat<T>& b) {
+	if(a.cols() != b.rows()) {
+		throw std::invalid_argument("nytl::DynMat: invalid multiplication sizes");
+	}
+
+	DynMat<T> ret(a.rows(), b.cols());
+	detail::mulRows(ret, a, b, 0, a.rows());
+	return ret;
+}
+
+template<typename T>
+DynMat<T>& operator+=(DynMat<T>& a, const DynMat<T>& b) {
+	detail::checkSameSize(a.rows(), a.cols(), b.rows(), b.cols());
+	detail::simd::addN(a.data(), b.data(), a.size());
+	return a;
+}
+
+template<typename T>
+DynMat<T>& operator-=(DynMat<T>& a, const DynMat<T>& b) {
+	detail::checkSameSize(a.rows(), a.cols(), b.rows(), b.cols());
+	detail::simd::subN(a.data(), b.data(), a.size());
+	return a;
+}
+
+template<typename T>
+DynMat<T>& operator*=(DynMat<T>& a, const T& fac) {
+	detail::simd::scaleN(a.data(), fac, a.size());
+	return a;
+}
+
+// return the parameter itself (not the reference returned by the compound
+// operators) so that it is moved instead of copied
+template<typename T>
+DynMat<T> operator+(DynMat<T> a, const DynMat<T>& b) {
+	a += b;
+	return a;
+}
+
+template<typename T>
+DynMat<T> operator-(DynMat<T> a, const DynMat<T>& b) {
+	a -= b;
+	return a;
+}
+
+template<typename T>
+DynMat<T> operator*(DynMat<T> a, const T& fac) {
+	a *= fac;
+	return a;
+}
+
+template<typename T>
+DynMat<T> operator*(const T& fac, DynMat<T> a) {
+	a *= fac;
+	return a;
+}
+
+template<typename T1, typename T2>
+bool operator==(const DynMat<T1>& a, const DynMat<T2>& b) {
+	return a.rows() == b.rows() && a.cols() == b.cols() &&
+		std::equal(a.data(), a.data() + a.size(), b.data());
+}
+
+template<typename T1, typename T2>
+bool operator!=(const DynMat<T1>& a, const DynMat<T2>& b) {
+	return !(a == b);
+}
+
+} // namespace nytl
+
+#endif // header guard
@@ -0,0 +1,451 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Matrix operations for nytl::DynMat.
+/// Uses the same names as the operations for nytl::Mat in matOps.hpp but
+/// the algorithms are blocked for large matrices: they work on contiguous
+/// row slices (using the SIMD kernels from simd.hpp) and on tiles that
+/// fit into the cache. The overloads taking a ThreadPool additionally
+/// distribute the work to its threads.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_DYN_MAT_OPS
+#define NYTL_INCLUDE_DYN_MAT_OPS
+
+#include <nytl/dynMat.hpp> // nytl::DynMat
+#include <nytl/parallel.hpp> // nytl::ThreadPool
+#include <nytl/simd.hpp> // nytl::detail::simd
+#include <nytl/span.hpp> // nytl::span
+
+#include <vector> // std::vector
+#include <stdexcept> // std::invalid_argument
+#include <type_traits> // std::conditional_t
+#include <algorithm> // std::swap_ranges
+#include <utility> // std::swap
+#include <cmath> // std::abs
+
+namespace nytl {
+
+/// Packed LU decomposition of a DynMat, see luDecomp.
+/// Like PackedLUDecomposition: the upper matrix is stored in and above the
+/// diagonal, the lower matrix (without its diagonal of ones) below it.
+/// Row i of PA is row perm[i] of A.
+template<typename T>
+struct DynLUDecomposition {
+	DynMat<T> lu;
+	std::vector<size_t> perm;
+	int sign = 1;
+};
+
+namespace detail {
+	/// Calls func(begin, end) for [0, count), on the given pool if not null.
+	template<typename F>
+	void dynMatFor(ThreadPool* pool, size_t count, size_t grain, F&& func) {
+		if(pool) {
+			parallelFor(*pool, count, grain, func);
+		} else if(count) {
+			func(size_t(0), count);
+		}
+	}
+
+	inline void checkSquare(size_t rows, size_t cols, const char* msg) {
+		if(rows != cols) {
+			throw std::invalid_argument(msg);
+		}
+	}
+
+	template<typename T>
+	using DynPrecision = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+	template<typename T>
+	DynMat<T> transpose(ThreadPool* pool, const DynMat<T>& mat) {
+		constexpr auto tile = 16u;
+
+		auto rows = mat.rows();
+		auto cols = mat.cols();
+		DynMat<T> ret(cols, rows);
+		auto tiles = (rows + tile - 1) / tile;
+		dynMatFor(pool, tiles, 4u, [&](size_t begin, size_t end) {
+			for(auto rb = begin * tile; rb < std::min<size_t>(end * tile, rows); rb += tile) {
+				auto re = std::min<size_t>(rb + tile, rows);
+				for(auto cb = size_t(0); cb < cols; cb += tile) {
+					auto ce = std::min<size_t>(cb + tile, cols);
+					auto r = rb;
+					if constexpr(simd::has4<T>) {
+						for(; r + 4 <= re; r += 4) {
+							auto c = cb;
+							for(; c + 4 <= ce; c += 4) {
+								simd::transpose4(&ret(c, r), rows, &mat(r, c), cols);
+							}
+
+							for(; c < ce; ++c) {
+								for(auto i = r; i < r + 4; ++i) {
+									ret(c, i) = mat(i, c);
+								}
+							}
+						}
+					}
+
+					for(; r < re; ++r) {
+						for(auto c = cb; c < ce; ++c) {
+							ret(c, r) = mat(r, c);
+						}
+					}
+				}
+			}
+		});
+
+		return ret;
+	}
+
+	template<typename T>
+	DynMat<T> multiply(ThreadPool* pool, const DynMat<T>& a, const DynMat<T>& b) {
+		if(a.cols() != b.rows()) {
+			throw std::invalid_argument("nytl::multiply: invalid DynMat sizes");
+		}
+
+		DynMat<T> ret(a.rows(), b.cols());
+		dynMatFor(pool, a.rows(), 32u, [&](size_t begin, size_t end) {
+			mulRows(ret, a, b, begin, end);
+		});
+
+		return ret;
+	}
+
+	/// Right-looking blocked LU decomposition with partial pivoting.
+	/// For every panel of 'block' columns, the panel is decomposed
+	/// first, then the rows right of it (U12) are solved and
+	/// finally the remaining matrix is updated with a matrix product,
+	/// which does the bulk of the work and is tiled and parallelized.
+	template<typename T>
+	void luDecompInPlace(ThreadPool* pool, DynLUDecomposition<T>& ret) {
+		constexpr auto block = 32u;
+		constexpr auto tileC = 256u;
+
+		auto& a = ret.lu;
+		auto n = a.rows();
+		ret.perm.resize(n);
+		for(auto i = 0u; i < n; ++i) {
+			ret.perm[i] = i;
+		}
+
+		for(auto k = size_t(0); k < n; k += block) {
+			auto kend = std::min<size_t>(k + block, n);
+
+			// panel, only columns [k, kend) are updated
+			for(auto j = k; j < kend; ++j) {
+				auto maxRow = j;
+				for(auto r = j + 1; r < n; ++r) {
+					if(std::abs(a(r, j)) > std::abs(a(maxRow, j))) {
+						maxRow = r;
+					}
+				}
+
+				if(maxRow != j) {
+					std::swap_ranges(&a(j, 0), &a(j, 0) + n, &a(maxRow, 0));
+					std::swap(ret.perm[j], ret.perm[maxRow]);
+					ret.sign = -ret.sign;
+				}
+
+				// singular matrix, nothing left to eliminate in this column
+				auto piv = a(j, j);
+				if(piv == T{0}) {
+					continue;
+				}
+
+				for(auto r = j + 1; r < n; ++r) {
+					auto fac = a(r, j) / piv;
+					a(r, j) = fac;
+					simd::axpyN(&a(r, j + 1), -fac, &a(j, j + 1), kend - j - 1);
+				}
+			}
+
+			if(kend == n) {
+				break;
+			}
+
+			// U12 = L11^-1 * A12
+			auto width = n - kend;
+			for(auto j = k; j < kend; ++j) {
+				for(auto i = j + 1; i < kend; ++i) {
+					simd::axpyN(&a(i, kend), -a(i, j), &a(j, kend), width);
+				}
+			}
+
+			// A22 -= L21 * U12
+			dynMatFor(pool, n - kend, 16u, [&](size_t begin, size_t end) {
+				for(auto cb = kend; cb < n; cb += tileC) {
+					auto cw = std::min<size_t>(tileC, n - cb);
+					for(auto r = kend + begin; r < kend + end; ++r) {
+						for(auto j = k; j < kend; ++j) {
+							simd::axpyN(&a(r, cb), -a(r, j), &a(j, cb), cw);
+						}
+					}
+				}
+			});
+		}
+	}
+
+	/// Solves AX = B for all columns of B at once. Since the rows of X are
+	/// contiguous, forward and back substitution are axpys on whole rows.
+	/// Independent column tiles are distributed to the pool.
+	template<typename T>
+	void luSolveInPlace(ThreadPool* pool, const DynLUDecomposition<T>& lu, DynMat<T>& x) {
+		constexpr auto tileC = 256u;
+
+		auto n = lu.lu.rows();
+		auto m = x.cols();
+		auto tiles = (m + tileC - 1) / tileC;
+		dynMatFor(pool, tiles, 1u, [&](size_t begin, size_t end) {
+			for(auto t = begin; t < end; ++t) {
+				auto cb = t * tileC;
+				auto cw = std::min<size_t>(tileC, m - cb);
+				for(auto i = 0u; i < n; ++i) {
+					for(auto j = 0u; j < i; ++j) {
+						simd::axpyN(&x(i, cb), -lu.lu(i, j), &x(j, cb), cw);
+					}
+				}
+
+				for(auto i = n; i-- > 0; ) {
+					for(auto j = i + 1; j < n; ++j) {
+						simd::axpyN(&x(i, cb), -lu.lu(i, j), &x(j, cb), cw);
+					}
+
+					simd::scaleN(&x(i, cb), T{1} / lu.lu(i, i), cw);
+				}
+			}
+		});
+	}
+
+	template<typename T1, typename T2>
+	DynMat<T1> luEvaluate(ThreadPool* pool, const DynLUDecomposition<T1>& lu,
+			const DynMat<T2>& b) {
+		if(b.rows() != lu.lu.rows()) {
+			throw std::invalid_argument("nytl::luEvaluate: invalid DynMat sizes");
+		}
+
+		DynMat<T1> x(b.rows(), b.cols());
+		for(auto i = 0u; i < b.rows(); ++i) {
+			std::copy(b[lu.perm[i]].begin(), b[lu.perm[i]].end(), x[i].begin());
+		}
+
+		luSolveInPlace(pool, lu, x);
+		return x;
+	}
+
+	template<typename T>
+	auto luDecomp(ThreadPool* pool, const DynMat<T>& mat) {
+		checkSquare(mat.rows(), mat.cols(), "nytl::luDecomp: DynMat is not square");
+		DynLUDecomposition<DynPrecision<T>> ret;
+		ret.lu = DynMat<DynPrecision<T>>(mat);
+		luDecompInPlace(pool, ret);
+		return ret;
+	}
+
+	template<typename T>
+	DynMat<T> inverse(ThreadPool* pool, const DynLUDecomposition<T>& lu) {
+		auto ret = DynMat<T>::identity(lu.lu.rows());
+		return luEvaluate(pool, lu, ret);
+	}
+} // namespace detail
+
+/// \brief Returns the transpose of the given matrix.
+/// Works on square tiles so that both reading and writing stays
+/// within a few cache lines. Inside the tiles, 4x4 blocks of float and
+/// double matrices are transposed in SIMD registers (if enabled).
+template<typename T>
+DynMat<T> transpose(const DynMat<T>& mat) {
+	return detail::transpose(nullptr, mat);
+}
+
+/// \brief Multi-threaded version of transpose.
+template<typename T>
+DynMat<T> transpose(ThreadPool& pool, const DynMat<T>& mat) {
+	return detail::transpose(&pool, mat);
+}
+
+/// \brief Multi-threaded version of DynMat multiplication (a * b).
+/// Throws std::invalid_argument if a.cols() != b.rows().
+template<typename T>
+DynMat<T> multiply(ThreadPool& pool, const DynMat<T>& a, const DynMat<T>& b) {
+	return detail::multiply(&pool, a, b);
+}
+
+/// \brief Brings the given matrix into the row echolon form (ref).
+/// Same algorithm as rowEcholon for nytl::Mat, the row operations
+/// are done on contiguous row slices.
+/// \note This operation divides by values from the matrix so it must have a type does
+/// correctly implement division over the desired field.
+template<typename T>
+void rowEcholon(DynMat<T>& mat) {
+	auto rows = mat.rows();
+	auto cols = mat.cols();
+	for(auto r = size_t(0), c = size_t(0); r < rows && c < cols; ++c) {
+		auto maxRow = r;
+		for(auto i = r + 1; i < rows; ++i) {
+			if(std::abs(mat(i, c)) > std::abs(mat(maxRow, c))) {
+				maxRow = i;
+			}
+		}
+
+		if(maxRow != r) {
+			std::swap_ranges(&mat(r, 0), &mat(r, 0) + cols, &mat(maxRow, 0));
+		}
+
+		// go to the next column if the pivot is zero
+		if(mat(r, c) == T{0}) {
+			continue;
+		}
+
+		auto len = cols - c;
+		detail::simd::scaleN(&mat(r, c), T{1} / mat(r, c), len);
+		mat(r, c) = T{1};
+
+		for(auto i = r + 1; i < rows; ++i) {
+			auto fac = mat(i, c);
+			detail::simd::axpyN(&mat(i, c), -fac, &mat(r, c), len);
+		}
+
+		++r;
+	}
+}
+
+/// \brief Brings the given matrix into the reduced row echolon form (rref).
+/// \note This operation divides by values from the matrix so it must have a type does
+/// correctly implement division over the desired field.
+template<typename T>
+void reducedRowEcholon(DynMat<T>& mat) {
+	rowEcholon(mat);
+
+	auto cols = mat.cols();
+	for(auto r = mat.rows(); r-- > 0; ) {
+		// find the pivot, skip zero rows
+		auto c = size_t(0);
+		while(c < cols && mat(r, c) == T{0}) {
+			++c;
+		}
+
+		if(c == cols) {
+			continue;
+		}
+
+		auto len = cols - c;
+		for(auto p = size_t(0); p < r; ++p) {
+			auto fac = mat(p, c) / mat(r, c);
+			detail::simd::axpyN(&mat(p, c), -fac, &mat(r, c), len);
+		}
+	}
+}
+
+/// \brief Computes the packed LU decomposition (PA = LU) of the given square matrix.
+/// Uses partial pivoting and a blocked algorithm that performs most of
+/// its work as cache-tiled matrix multiplication.
+/// Floating point matrices keep their precision, others are decomposed using double.
+/// Works for every square matrix, even singular ones.
+/// Throws std::invalid_argument if the given matrix is not square.
+/// Complexity Lies within O(n^3) where n is the number of rows/cols of the given matrix.
+template<typename T>
+auto luDecomp(const DynMat<T>& mat) {
+	return detail::luDecomp(nullptr, mat);
+}
+
+/// \brief Multi-threaded version of luDecomp.
+template<typename T>
+auto luDecomp(ThreadPool& pool, const DynMat<T>& mat) {
+	return detail::luDecomp(&pool, mat);
+}
+
+/// \brief Returns the vector x so that Ax = b for the matrix A represented
+/// by the given decomposition.
+/// Throws std::invalid_argument if the size of b does not match.
+/// Undefined behaviour if A is singular.
+template<typename T1, typename T2>
+std::vector<T1> luEvaluate(const DynLUDecomposition<T1>& lu, span<const T2> b) {
+	auto n = lu.lu.rows();
+	if(b.size() != n) {
+		throw std::invalid_argument("nytl::luEvaluate: invalid vector size");
+	}
+
+	std::vector<T1> x(n);
+	for(auto i = 0u; i < n; ++i) {
+		x[i] = b[lu.perm[i]];
+		for(auto j = 0u; j < i; ++j)
+			x[i] -= lu.lu(i, j) * x[j];
+	}
+
+	for(auto i = n; i-- > 0; ) {
+		for(auto j = i + 1; j < n; ++j)
+			x[i] -= lu.lu(i, j) * x[j];
+
+		x[i] /= lu.lu(i, i);
+	}
+
+	return x;
+}
+
+/// \brief Returns X so that AX = B, i.e. solves the equation for every
+/// column of b, for the matrix A represented by the given decomposition.
+/// Throws std::invalid_argument if b.rows() does not match.
+/// Undefined behaviour if A is singular.
+template<typename T1, typename T2>
+DynMat<T1> luEvaluate(const DynLUDecomposition<T1>& lu, const DynMat<T2>& b) {
+	return detail::luEvaluate(nullptr, lu, b);
+}
+
+/// \brief Multi-threaded version of luEvaluate for multiple right-hand sides.
+template<typename T1, typename T2>
+DynMat<T1> luEvaluate(ThreadPool& pool, const DynLUDecomposition<T1>& lu,
+		const DynMat<T2>& b) {
+	return detail::luEvaluate(&pool, lu, b);
+}
+
+/// \brief Returns the determinant for the lu decomposition of a matrix.
+template<typename T>
+T determinant(const DynLUDecomposition<T>& lu) {
+	auto ret = T(lu.sign);
+	for(auto i = 0u; i < lu.lu.rows(); ++i) {
+		ret *= lu.lu(i, i);
+	}
+
+	return ret;
+}
+
+/// \brief Returns the determinant of the given square matrix.
+/// Throws std::invalid_argument if the given matrix is not square.
+template<typename T>
+auto determinant(const DynMat<T>& mat) {
+	return determinant(luDecomp(mat));
+}
+
+/// \brief Returns the inverse of the matrix represented by the given decomposition.
+/// Undefined behaviour if the matrix is not invertible.
+template<typename T>
+DynMat<T> inverse(const DynLUDecomposition<T>& lu) {
+	return detail::inverse(nullptr, lu);
+}
+
+/// \brief Multi-threaded version of inverse.
+template<typename T>
+DynMat<T> inverse(ThreadPool& pool, const DynLUDecomposition<T>& lu) {
+	return detail::inverse(&pool, lu);
+}
+
+/// \brief Returns the inverse of the given square matrix.
+/// Throws std::invalid_argument if the given matrix is not square.
+/// Undefined behaviour if the given matrix is not invertible.
+template<typename T>
+auto inverse(const DynMat<T>& mat) {
+	return inverse(luDecomp(mat));
+}
+
+/// \brief Multi-threaded version of inverse.
+template<typename T>
+auto inverse(ThreadPool& pool, const DynMat<T>& mat) {
+	return inverse(pool, luDecomp(pool, mat));
+}
+
+} // namespace nytl
+
+#endif // header guard
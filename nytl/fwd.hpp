@@ -27,6 +27,7 @@ template <typename C, typename ID> class UniqueConnectionT;
 
 struct ConnectionID;
 struct TrackedConnectionID;
+struct PooledConnectionID;
 
 using Connectable = ConnectableT<ConnectionID>;
 using Connection = ConnectionT<Connectable, ConnectionID>;
@@ -36,6 +37,10 @@ using TrackedConnectable = ConnectableT<TrackedConnectionID>;
 using TrackedConnection = ConnectionT<TrackedConnectable, TrackedConnectionID>;
 using TrackedUniqueConnection = UniqueConnectionT<TrackedConnectable, TrackedConnectionID>;
 
+using PooledConnectable = ConnectableT<PooledConnectionID>;
+using PooledConnection = ConnectionT<PooledConnectable, PooledConnectionID>;
+using PooledUniqueConnection = UniqueConnectionT<PooledConnectable, PooledConnectionID>;
+
 } // namespace nytl
 
 #endif // header guad
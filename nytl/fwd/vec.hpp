@@ -18,6 +18,7 @@ template<size_t D, typename T> class Vec;
 
 template<typename T> class Vec<2, T>; // nytl/vec2.hpp
 template<typename T> class Vec<3, T>; // nytl/vec3.hpp
+template<typename T> class Vec<4, T>; // nytl/vec4.hpp
 
 template<typename T> using Vec2 = Vec<2, T>;
 template<typename T> using Vec3 = Vec<3, T>;
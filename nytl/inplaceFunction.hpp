@@ -0,0 +1,244 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the InplaceFunction and FunctionRef callable wrappers.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_INPLACE_FUNCTION
+#define NYTL_INCLUDE_INPLACE_FUNCTION
+
+#include <functional> // std::invoke, std::bad_function_call
+#include <type_traits> // std::enable_if_t, std::is_invocable_r_v
+#include <utility> // std::forward, std::move
+#include <cstddef> // std::size_t, std::max_align_t
+#include <new> // placement new
+
+namespace nytl {
+
+/// Type-erased, move-only callable wrapper that stores its target inline
+/// and therefore never allocates.
+/// Storing a callable that does not fit into Size bytes (or needs a larger
+/// alignment than Align) is a compile-time error.
+/// Semantics are otherwise the same as for std::function, i.e. calling an
+/// empty InplaceFunction throws std::bad_function_call.
+/// Can be used as function type for nytl::Callback and nytl::RecursiveCallback,
+/// e.g. via `template<typename S> using Func = nytl::InplaceFunction<S, 64>`.
+/// \tparam Signature The function signature, Ret(Args...)
+/// \tparam Size The size of the inline storage in bytes.
+/// \tparam Align The alignment of the inline storage.
+template<typename Signature,
+	std::size_t Size = 4 * sizeof(void*),
+	std::size_t Align = alignof(std::max_align_t)>
+class InplaceFunction;
+
+/// Non-owning reference to a callable object, i.e. just a pointer
+/// to the object and a pointer to a function calling it.
+/// The referenced object must outlive the FunctionRef, it should therefore
+/// only be used as parameter type or with callables whose lifetime
+/// is explicitly managed.
+template<typename Signature>
+class FunctionRef;
+
+namespace detail {
+	template<typename T> struct IsInplaceFunction : std::false_type {};
+	template<typename S, std::size_t Size, std::size_t Align>
+	struct IsInplaceFunction<InplaceFunction<S, Size, Align>> : std::true_type {};
+
+	template<typename T> struct IsFunctionRef : std::false_type {};
+	template<typename S> struct IsFunctionRef<FunctionRef<S>> : std::true_type {};
+} // namespace detail
+
+template<typename Ret, typename... Args, std::size_t Size, std::size_t Align>
+class InplaceFunction<Ret(Args...), Size, Align> {
+public:
+	using Signature = Ret(Args...);
+	static constexpr auto size = Size;
+	static constexpr auto align = Align;
+
+	/// Returns whether a callable of type F can be stored.
+	template<typename F>
+	static constexpr bool fits = sizeof(F) <= Size && alignof(F) <= Align &&
+		Align % alignof(F) == 0;
+
+public:
+	InplaceFunction() noexcept = default;
+	InplaceFunction(std::nullptr_t) noexcept {}
+
+	/// Stores the given callable.
+	/// Does not participate in overload resolution if F can't be
+	/// called with the given signature.
+	template<typename F, typename D = std::decay_t<F>, typename = std::enable_if_t<
+		!detail::IsInplaceFunction<D>::value &&
+		std::is_invocable_r_v<Ret, D&, Args...>>>
+	InplaceFunction(F&& func) {
+		static_assert(fits<D>, "nytl::InplaceFunction: callable too large, increase Size");
+		static_assert(std::is_nothrow_move_constructible_v<D>,
+			"nytl::InplaceFunction: callable must be nothrow move constructible");
+
+		// null function pointers, empty std::functions result in an empty object
+		if constexpr(std::is_pointer_v<D> || std::is_member_pointer_v<D>) {
+			if(!func) {
+				return;
+			}
+		} else if constexpr(std::is_same_v<D, std::function<Signature>>) {
+			if(!func) {
+				return;
+			}
+		}
+
+		new(storage_) D(std::forward<F>(func));
+		vtable_ = &vtableFor<D>;
+	}
+
+	InplaceFunction(InplaceFunction&& rhs) noexcept : vtable_(rhs.vtable_) {
+		if(vtable_) {
+			vtable_->move(storage_, rhs.storage_);
+			rhs.vtable_ = nullptr;
+		}
+	}
+
+	InplaceFunction& operator=(InplaceFunction&& rhs) noexcept {
+		if(&rhs != this) {
+			reset();
+			if(rhs.vtable_) {
+				rhs.vtable_->move(storage_, rhs.storage_);
+				vtable_ = rhs.vtable_;
+				rhs.vtable_ = nullptr;
+			}
+		}
+
+		return *this;
+	}
+
+	InplaceFunction& operator=(std::nullptr_t) noexcept {
+		reset();
+		return *this;
+	}
+
+	~InplaceFunction() {
+		reset();
+	}
+
+	/// Destroys the stored callable, if there is any.
+	void reset() noexcept {
+		if(vtable_) {
+			vtable_->destroy(storage_);
+			vtable_ = nullptr;
+		}
+	}
+
+	/// Calls the stored callable.
+	/// \throws std::bad_function_call if this object is empty.
+	Ret operator()(Args... args) const {
+		if(!vtable_) {
+			throw std::bad_function_call();
+		}
+
+		return vtable_->call(storage_, std::forward<Args>(args)...);
+	}
+
+	/// Returns whether a callable is stored.
+	explicit operator bool() const noexcept { return vtable_; }
+
+protected:
+	struct VTable {
+		Ret (*call)(void*, Args&&...);
+		void (*move)(void* dst, void* src) noexcept;
+		void (*destroy)(void*) noexcept;
+	};
+
+	template<typename F>
+	static Ret callImpl(void* obj, Args&&... args) {
+		if constexpr(std::is_void_v<Ret>) {
+			std::invoke(*static_cast<F*>(obj), std::forward<Args>(args)...);
+		} else {
+			return std::invoke(*static_cast<F*>(obj), std::forward<Args>(args)...);
+		}
+	}
+
+	template<typename F>
+	static void moveImpl(void* dst, void* src) noexcept {
+		auto& f = *static_cast<F*>(src);
+		new(dst) F(std::move(f));
+		f.~F();
+	}
+
+	template<typename F>
+	static void destroyImpl(void* obj) noexcept {
+		static_cast<F*>(obj)->~F();
+	}
+
+	template<typename F>
+	static constexpr VTable vtableFor = {callImpl<F>, moveImpl<F>, destroyImpl<F>};
+
+	const VTable* vtable_ {};
+	alignas(Align) mutable unsigned char storage_[Size];
+};
+
+template<typename Ret, typename... Args>
+class FunctionRef<Ret(Args...)> {
+public:
+	using Signature = Ret(Args...);
+
+public:
+	FunctionRef() noexcept = default;
+	FunctionRef(std::nullptr_t) noexcept {}
+
+	/// References the given callable object.
+	/// Note that this does not copy the object and therefore binding
+	/// to a temporary will result in a dangling reference.
+	template<typename F, typename = std::enable_if_t<
+		!detail::IsFunctionRef<std::decay_t<F>>::value &&
+		!std::is_pointer_v<std::decay_t<F>> &&
+		std::is_invocable_r_v<Ret, F&, Args...>>>
+	FunctionRef(F&& func) noexcept :
+		obj_(const_cast<void*>(static_cast<const void*>(std::addressof(func)))),
+		call_(&callImpl<std::remove_reference_t<F>>) {}
+
+	/// Stores the given function pointer directly.
+	FunctionRef(Ret (*func)(Args...)) noexcept : fn_(func) {
+		if(func) {
+			call_ = &callFn;
+		}
+	}
+
+	/// Calls the referenced callable.
+	/// \throws std::bad_function_call if this object is empty.
+	Ret operator()(Args... args) const {
+		if(!call_) {
+			throw std::bad_function_call();
+		}
+
+		return call_(*this, std::forward<Args>(args)...);
+	}
+
+	/// Returns whether a callable is referenced.
+	explicit operator bool() const noexcept { return call_; }
+
+protected:
+	template<typename F>
+	static Ret callImpl(const FunctionRef& ref, Args&&... args) {
+		if constexpr(std::is_void_v<Ret>) {
+			std::invoke(*static_cast<F*>(ref.obj_), std::forward<Args>(args)...);
+		} else {
+			return std::invoke(*static_cast<F*>(ref.obj_), std::forward<Args>(args)...);
+		}
+	}
+
+	static Ret callFn(const FunctionRef& ref, Args&&... args) {
+		return ref.fn_(std::forward<Args>(args)...);
+	}
+
+	union {
+		void* obj_ {};
+		Ret (*fn_)(Args...);
+	};
+
+	Ret (*call_)(const FunctionRef&, Args&&...) {};
+};
+
+} // namespace nytl
+
+#endif // header guard
@@ -12,6 +12,7 @@
 #include <nytl/fwd/mat.hpp> // nytl::Mat forward declaration
 #include <nytl/vec.hpp> // nytl::Vec
 #include <nytl/vecOps.hpp> // nytl::dot
+#include <nytl/simd.hpp> // nytl::detail::simd
 
 namespace nytl {
 
@@ -20,6 +21,8 @@ namespace nytl {
 /// - T: The value type of the matrix.
 /// - R: The rows of the matrix.
 /// - C: The columns of the matrix.
+/// For Mat4f and Mat4d, the multiplication operators can use SIMD
+/// instructions, see nytl/simd.hpp.
 template<size_t R, size_t C, typename T>
 struct Mat {
 	/// The (static/fixed) dimensions of the matrix
@@ -76,6 +79,13 @@ constexpr Mat<R, C, T>::operator Mat<OR, OC, OT>() const {
 template<typename T1, typename T2, size_t R, size_t M, size_t C>
 constexpr auto operator*(const Mat<R, M, T1>& a, const Mat<M, C, T2>& b) {
 	Mat<R, C, decltype(a[0][0] * b[0][0] + a[0][0] * b[0][0])> ret {};
+	if constexpr(R == 4 && M == 4 && detail::simd::vec4<C, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::mulMat4(ret[0].data(), a[0].data(), b[0].data());
+			return ret;
+		}
+	}
+
 	for(auto r = 0u; r < R; ++r) // ret: rows
 		for(auto c = 0u; c < C; ++c) // ret: cols
 			for(auto i = 0u; i < M; ++i) // row + col dot
@@ -87,6 +97,13 @@ constexpr auto operator*(const Mat<R, M, T1>& a, const Mat<M, C, T2>& b) {
 template<typename T1, typename T2, size_t R, size_t C>
 constexpr auto operator*(const Mat<R, C, T1>& a, const Vec<C, T2>& b) {
 	Vec<R, decltype(a[0][0] * b[0] + a[0][0] * b[0])> ret {};
+	if constexpr(R == 4 && detail::simd::vec4<C, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::mulMat4Vec4(ret.data(), a[0].data(), b.data());
+			return ret;
+		}
+	}
+
 	for(auto r = 0u; r < R; ++r)
 		ret[r] = dot(a[r], b);
 	return ret;
@@ -95,6 +112,13 @@ constexpr auto operator*(const Mat<R, C, T1>& a, const Vec<C, T2>& b) {
 // mat *= mat (quadratic)
 template<typename T1, typename T2, size_t D>
 constexpr auto& operator*=(Mat<D, D, T1>& a, const Mat<D, D, T2>& b) {
+	if constexpr(detail::simd::vec4<D, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::mulMat4(a[0].data(), a[0].data(), b[0].data());
+			return a;
+		}
+	}
+
 	auto tmp = a; // needed since we write to a
 	a = {};
 	for(auto r = 0u; r < D; ++r) // ret: rows
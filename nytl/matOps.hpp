@@ -12,12 +12,18 @@
 #include <nytl/tmpUtil.hpp> // nytl::templatize
 #include <nytl/mat.hpp> // nytl::Mat
 #include <nytl/vecOps.hpp> // nytl::dot
+#include <nytl/simd.hpp> // nytl::detail::simd
+#include <nytl/span.hpp> // nytl::span
 
 #include <utility> // std::swap
 #include <stdexcept> // std::invalid_argument
 #include <tuple> // std::tuple
 #include <iosfwd> // std::ostream
-#include <cmath> // std::fma
+#include <cmath> // std::fma, std::abs
+#include <type_traits> // std::is_same_v
+#include <array> // std::array
+#include <cstdint> // std::uint8_t
+#include <algorithm> // std::min
 
 namespace nytl {
 
@@ -30,7 +36,21 @@ struct LUDecomposition {
 	nytl::Mat<D, D, T> lower;
 	nytl::Mat<D, D, T> upper;
 	nytl::Mat<D, D, bool> perm; // permutation
-	unsigned int sign = 1;
+	int sign = 1;
+};
+
+/// Compact version of LUDecomposition, see luDecompPacked.
+/// The lower and upper matrix are stored in one matrix: the upper
+/// matrix in and above the diagonal and the lower matrix (without its
+/// diagonal, which is always one) below it. The permutation is stored
+/// as array of row indices: row i of PA is row perm[i] of A.
+template<size_t D, typename T>
+struct PackedLUDecomposition {
+	using Index = std::conditional_t<(D <= 256), std::uint8_t, size_t>;
+
+	nytl::Mat<D, D, T> lu;
+	std::array<Index, D> perm;
+	int sign = 1;
 };
 
 /// \brief Prints the given matrix with numerical values to the given ostream.
@@ -169,18 +189,56 @@ constexpr auto identity() {
 	return ret;
 }
 
+namespace detail {
+	/// Writes the transpose of mat into out. For float and double matrices
+	/// with dimensions that are a multiple of 4, the matrix is transposed
+	/// in 4x4 blocks in SIMD registers (if enabled).
+	template<size_t R, size_t C, typename T>
+	constexpr void transposeInto(const Mat<R, C, T>& mat, Mat<C, R, T>& out) {
+		if constexpr(R % 4 == 0 && C % 4 == 0 && simd::has4<T>) {
+			if(!constantEvaluated()) {
+				auto dst = out[0].data();
+				auto src = mat[0].data();
+				for(auto r = 0u; r < R; r += 4) {
+					for(auto c = 0u; c < C; c += 4) {
+						simd::transpose4(dst + c * R + r, R, src + r * C + c, C);
+					}
+				}
+				return;
+			}
+		}
+
+		for(auto r = 0u; r < R; ++r) {
+			for(auto c = 0u; c < C; ++c) {
+				out[c][r] = mat[r][c];
+			}
+		}
+	}
+} // namespace detail
+
 /// \brief Transposes the given matrix.
 /// \returns A rebound matrix of the same implementation with C rows and R rows.
 template<size_t R, size_t C, typename T>
 constexpr auto transpose(const nytl::Mat<R, C, T>& mat) {
 	nytl::Mat<C, R, T> ret {};
-	for(auto r = 0u; r < R; ++r) {
-		for(auto c = 0u; c < C; ++c) {
-			ret[c][r] = mat[r][c];
-		}
+	detail::transposeInto(mat, ret);
+	return ret;
+}
+
+/// \brief Writes the transpose of in[i] into out[i] for all matrices.
+/// Useful e.g. to convert many row-major matrices to column-major for
+/// uploading them. The transposed matrices are written directly into out.
+/// Throws std::invalid_argument if in and out don't have the same size.
+/// The spans must not overlap.
+template<size_t R, size_t C, typename T>
+void transpose(span<const Mat<R, C, T>> in, span<NonDeduced<Mat<C, R, T>>> out) {
+	if(in.size() != out.size()) {
+		throw std::invalid_argument("nytl::transpose: size mismatch");
 	}
 
-	return ret;
+	for(auto i = 0u; i < in.size(); ++i) {
+		detail::transposeInto(in[i], out[i]);
+	}
 }
 
 /// \brief Performs partial pivoting for the given matrix for given position.
@@ -325,27 +383,31 @@ constexpr LUDecomposition<D, double> luDecomp(const nytl::Mat<D, D, T>& mat) {
 
 	for(auto n = 0u; n < D; ++n) {
 
-		// since we divide by upper[n][n] later on we should try to make it non-zero by
-		// swapping the current row with another row. If we do so, we have to pretend we
-		// swapped the matrix in the beginning and therefore also change the lower matrix and
-		// remember the swap in the permutation matrix
-		if(ret.upper[n][n] == 0.0) {
-			for(auto r = n + 1; r < D; ++r) {
-				if(ret.upper[r][n] != 0.0) {
-					swapRow(ret.perm, r, n);
-					swapRow(ret.upper, r, n);
-					swapRow(ret.lower, r, n);
-					ret.sign *= -1;
-					break;
-				}
+		// since we divide by upper[n][n] later on we swap the row with the largest
+		// coefficient in the current column into the current row (partial pivoting).
+		// Otherwise we might divide by values that should be zero but aren't due to
+		// rounding. If we swap, we have to pretend we swapped the matrix in the beginning
+		// and therefore also change the lower matrix and remember the swap in the
+		// permutation matrix
+		auto maxRow = n;
+		for(auto r = n + 1; r < D; ++r) {
+			if(std::abs(ret.upper[r][n]) > std::abs(ret.upper[maxRow][n])) {
+				maxRow = r;
 			}
+		}
 
-			// If all coefficients in the column are zero (e.g. a zero matrix), its ok since
-			// we don't have any more coefficients to eliminate.
-			if(ret.upper[n][n] == 0.0) {
-				ret.lower[n][n] = 1.0;
-				continue;
-			}
+		if(maxRow != n) {
+			swapRow(ret.perm, maxRow, n);
+			swapRow(ret.upper, maxRow, n);
+			swapRow(ret.lower, maxRow, n);
+			ret.sign *= -1;
+		}
+
+		// If all coefficients in the column are zero (e.g. a zero matrix), its ok since
+		// we don't have any more coefficients to eliminate.
+		if(ret.upper[n][n] == 0.0) {
+			ret.lower[n][n] = 1.0;
+			continue;
 		}
 
 		ret.lower[n][n] = 1.0;
@@ -413,6 +475,139 @@ constexpr auto luEvaluate(const LUDecomposition<D, T1>& lu, const Vec<D, T2>& b)
 	return luEvaluate(lu.lower, lu.upper, transpose(lu.perm) * b);
 }
 
+/// \brief Computes a compact LU decomposition of the given square matrix.
+/// Same as luDecomp (i.e. PA = LU) but returns the decomposition in
+/// packed form (see PackedLUDecomposition), which needs way less memory
+/// and makes solving with it (luEvaluate) faster. Uses partial pivoting
+/// (i.e. the largest value in a column) which is numerically more stable.
+/// Floating point matrices keep their precision, others are decomposed
+/// using double.
+/// Works for every square matrix, even singular ones.
+/// Complexity Lies within O(n^3) where n is the number of rows/cols of the given matrix.
+template<size_t D, typename T>
+constexpr auto luDecompPacked(const nytl::Mat<D, D, T>& mat) {
+	using P = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+	PackedLUDecomposition<D, P> ret {};
+	ret.lu = static_cast<Mat<D, D, P>>(mat);
+	for(auto i = 0u; i < D; ++i) {
+		ret.perm[i] = i;
+	}
+
+	auto& lu = ret.lu;
+	for(auto n = 0u; n < D; ++n) {
+		auto maxRow = n;
+		for(auto r = n + 1; r < D; ++r) {
+			if(std::abs(lu[r][n]) > std::abs(lu[maxRow][n])) {
+				maxRow = r;
+			}
+		}
+
+		// manual swaps since std::swap isn't constexpr in C++17
+		if(maxRow != n) {
+			for(auto c = 0u; c < D; ++c) {
+				auto tmp = lu[n][c];
+				lu[n][c] = lu[maxRow][c];
+				lu[maxRow][c] = tmp;
+			}
+
+			auto tmp = ret.perm[n];
+			ret.perm[n] = ret.perm[maxRow];
+			ret.perm[maxRow] = tmp;
+			ret.sign = -ret.sign;
+		}
+
+		// singular matrix, nothing left to eliminate in this column
+		if(lu[n][n] == P{0}) {
+			continue;
+		}
+
+		for(auto r = n + 1; r < D; ++r) {
+			auto fac = lu[r][n] / lu[n][n];
+			lu[r][n] = fac;
+			for(auto c = n + 1; c < D; ++c) {
+				lu[r][c] -= fac * lu[n][c];
+			}
+		}
+	}
+
+	return ret;
+}
+
+/// \brief Returns the vector x so that Ax = b for the matrix A represented
+/// by the given packed decomposition. Already applies the permutation.
+/// Undefined behaviour if A is singular.
+/// Complexity Lies within O(n^2) where n is the number of rows/cols of the given matrices.
+template<size_t D, typename T1, typename T2>
+constexpr auto luEvaluate(const PackedLUDecomposition<D, T1>& lu, const Vec<D, T2>& b) {
+	Vec<D, T1> x {};
+	for(auto i = 0u; i < D; ++i) {
+		x[i] = b[lu.perm[i]];
+		for(auto j = 0u; j < i; ++j)
+			x[i] -= lu.lu[i][j] * x[j];
+	}
+
+	for(auto i = D; i-- > 0; ) {
+		for(auto j = i + 1; j < D; ++j)
+			x[i] -= lu.lu[i][j] * x[j];
+
+		x[i] /= lu.lu[i][i];
+	}
+
+	return x;
+}
+
+/// \brief Solves Ax = b for all given right-hand sides b[i], writing
+/// the solutions into x[i]. Processes blocks of right-hand sides at once,
+/// so that every row of the decomposition is only loaded once per block.
+/// x and b must have the same size, otherwise std::invalid_argument
+/// is thrown. They may be the same.
+/// Undefined behaviour if A is singular.
+template<size_t D, typename T>
+void luEvaluate(const PackedLUDecomposition<D, T>& lu,
+		span<const NonDeduced<Vec<D, T>>> b, span<NonDeduced<Vec<D, T>>> x) {
+	if(b.size() != x.size()) {
+		throw std::invalid_argument("nytl::luEvaluate: size mismatch");
+	}
+
+	constexpr auto blockSize = 16u;
+	Vec<D, T> block[blockSize];
+	for(auto off = 0u; off < b.size(); off += blockSize) {
+		auto count = std::min<size_t>(blockSize, b.size() - off);
+		for(auto k = 0u; k < count; ++k) {
+			for(auto i = 0u; i < D; ++i) {
+				block[k][i] = b[off + k][lu.perm[i]];
+			}
+		}
+
+		// forward substitution
+		for(auto i = 0u; i < D; ++i) {
+			for(auto j = 0u; j < i; ++j) {
+				auto l = lu.lu[i][j];
+				for(auto k = 0u; k < count; ++k) {
+					block[k][i] -= l * block[k][j];
+				}
+			}
+		}
+
+		// back substitution
+		for(auto i = D; i-- > 0; ) {
+			for(auto j = i + 1; j < D; ++j) {
+				auto u = lu.lu[i][j];
+				for(auto k = 0u; k < count; ++k) {
+					block[k][i] -= u * block[k][j];
+				}
+			}
+
+			auto inv = T{1} / lu.lu[i][i];
+			for(auto k = 0u; k < count; ++k) {
+				block[k][i] *= inv;
+			}
+		}
+
+		std::copy(block, block + count, x.begin() + off);
+	}
+}
+
 /// \brief Returns the determinant of the given square matrix.
 /// Complexity Lies within O(n^3) where n is the number of rows/cols of the given matrix.
 /// If you already have a lu-decomposition, see the next overload of this function.
@@ -430,6 +625,12 @@ constexpr auto determinant(const LUDecomposition<D, T>& lu) {
 	return lu.sign * multiplyDiagonal(lu.upper) * multiplyDiagonal(lu.lower);
 }
 
+/// \brief Returns the determinant for the packed lu decomposition of a matrix.
+template<size_t D, typename T>
+constexpr auto determinant(const PackedLUDecomposition<D, T>& lu) {
+	return T(lu.sign) * multiplyDiagonal(lu.lu);
+}
+
 /// \brief Returns whether the given square matrix can be inverted.
 /// Complexity Lies within O(n^3) where n is the number of rows/cols of the given matrix.
 /// If you already know the lu decomposition of this matrix it is much more efficient
@@ -462,6 +663,141 @@ constexpr auto inverse(const LUDecomposition<D, T>& lu) {
 	return ret;
 }
 
+/// \brief Returns the inverse of the matrix that is represented by the
+/// given packed lu decomposition.
+/// Undefined behvaiour if the matrix is not invertible.
+template<size_t D, typename T>
+constexpr auto inverse(const PackedLUDecomposition<D, T>& lu) {
+	Mat<D, D, T> ret {};
+	for(auto i = 0u; i < D; ++i) {
+		Vec<D, T> e {};
+		e[i] = T{1};
+		col(ret, i, luEvaluate(lu, e));
+	}
+
+	return ret;
+}
+
+/// \brief Returns the inverse of the given matrix using closed-form cofactor
+/// expansion for 2x2, 3x3 and 4x4 matrices. This is significantly faster
+/// than inverse() but can be less accurate for ill-conditioned matrices.
+/// Unlike inverse(), the computation is done with precision T (which
+/// should therefore be a floating point type). For Mat4f (with NYTL_SIMD
+/// enabled), SSE instructions are used.
+/// For larger matrices, just returns the (converted) result of inverse().
+/// Undefined behaviour if the given matrix is not invertible.
+template<size_t D, typename T>
+constexpr Mat<D, D, T> inverseFast(const Mat<D, D, T>& m) {
+	Mat<D, D, T> ret {};
+	if constexpr(D == 1) {
+		ret[0][0] = T{1} / m[0][0];
+	} else if constexpr(D == 2) {
+		auto inv = T{1} / (m[0][0] * m[1][1] - m[0][1] * m[1][0]);
+		ret[0][0] = m[1][1] * inv;
+		ret[0][1] = -m[0][1] * inv;
+		ret[1][0] = -m[1][0] * inv;
+		ret[1][1] = m[0][0] * inv;
+	} else if constexpr(D == 3) {
+		ret[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		ret[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+		ret[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+		ret[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		ret[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+		ret[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+		ret[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		ret[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+		ret[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+		auto det = m[0][0] * ret[0][0] + m[0][1] * ret[1][0] + m[0][2] * ret[2][0];
+		ret *= T{1} / det;
+	} else if constexpr(D == 4) {
+		if constexpr(std::is_same_v<T, float> && detail::simd::hasInverse4) {
+			if(!detail::constantEvaluated()) {
+				detail::simd::inverse4(ret[0].data(), m[0].data());
+				return ret;
+			}
+		}
+
+		// 2x2 sub determinants of the upper and lower two rows
+		auto s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+		auto s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+		auto s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+		auto s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+		auto s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+		auto s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+		auto c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+		auto c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+		auto c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+		auto c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+		auto c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+		auto c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+		auto det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		auto inv = T{1} / det;
+
+		ret[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv;
+		ret[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv;
+		ret[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv;
+		ret[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv;
+
+		ret[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv;
+		ret[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv;
+		ret[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv;
+		ret[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv;
+
+		ret[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv;
+		ret[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv;
+		ret[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv;
+		ret[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv;
+
+		ret[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv;
+		ret[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv;
+		ret[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv;
+		ret[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv;
+	} else {
+		ret = static_cast<Mat<D, D, T>>(inverse(m));
+	}
+
+	return ret;
+}
+
+/// \brief Returns the inverse of the given affine transformation matrix.
+/// The last row of the given matrix must be (0, ..., 0, 1), as is the case
+/// for all combinations of translation, rotation, scale (and shear)
+/// matrices, e.g. the ones created by the functions in nytl/transform.hpp.
+/// Only the linear part (the upper-left (D - 1)x(D - 1) matrix) has to
+/// be inverted, which is done with inverseFast. Therefore this is
+/// even faster than inverseFast for the full matrix.
+/// For Mat4f (with NYTL_SIMD enabled), SSE instructions are used.
+/// Undefined behaviour if the given matrix is not invertible.
+template<size_t D, typename T>
+constexpr Mat<D, D, T> inverseAffine(const Mat<D, D, T>& m) {
+	static_assert(D >= 2, "Affine matrices have at least 2 dimensions");
+
+	Mat<D, D, T> ret {};
+	if constexpr(D == 4 && std::is_same_v<T, float> && detail::simd::hasInverse4) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::inverseAffine4(ret[0].data(), m[0].data());
+			return ret;
+		}
+	}
+
+	auto linear = inverseFast(static_cast<Mat<D - 1, D - 1, T>>(m));
+	for(auto r = 0u; r < D - 1; ++r) {
+		T t {0};
+		for(auto c = 0u; c < D - 1; ++c) {
+			ret[r][c] = linear[r][c];
+			t -= linear[r][c] * m[c][D - 1];
+		}
+
+		ret[r][D - 1] = t;
+	}
+
+	ret[D - 1][D - 1] = T{1};
+	return ret;
+}
+
 /// \brief Returns whether the given quadratic matrix is symmetric.
 template<size_t D, typename T>
 constexpr bool symmetric(const nytl::Mat<D, D, T>& mat) {
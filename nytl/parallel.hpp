@@ -0,0 +1,188 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines a simple persistent ThreadPool and parallelFor on top of it.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_PARALLEL
+#define NYTL_INCLUDE_PARALLEL
+
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <functional> // std::function
+#include <deque> // std::deque
+#include <vector> // std::vector
+#include <memory> // std::shared_ptr
+#include <atomic> // std::atomic
+#include <exception> // std::exception_ptr
+#include <algorithm> // std::min
+
+namespace nytl {
+
+/// \brief Fixed set of worker threads that execute enqueued tasks.
+/// The threads are started on construction and live until the pool
+/// is destroyed, so it can be used for many small jobs without
+/// creating threads every time. Destruction waits for all enqueued
+/// tasks to be finished. Tasks must not throw.
+class ThreadPool {
+public:
+	/// The default number of workers: one less than the number of hardware
+	/// threads since the thread using the pool usually participates as well.
+	static unsigned defaultWorkerCount() {
+		auto count = std::thread::hardware_concurrency();
+		return count > 1 ? count - 1 : 0;
+	}
+
+public:
+	explicit ThreadPool(unsigned workers = defaultWorkerCount()) {
+		threads_.reserve(workers);
+		for(auto i = 0u; i < workers; ++i) {
+			threads_.emplace_back([this]{ work(); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard lock(mutex_);
+			exit_ = true;
+		}
+
+		cv_.notify_all();
+		for(auto& thread : threads_) {
+			thread.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// Enqueues the given task, will be executed by one of the workers.
+	void enqueue(std::function<void()> task) {
+		{
+			std::lock_guard lock(mutex_);
+			tasks_.push_back(std::move(task));
+		}
+
+		cv_.notify_one();
+	}
+
+	/// The number of worker threads. Might be zero.
+	unsigned workerCount() const { return unsigned(threads_.size()); }
+
+protected:
+	void work() {
+		while(true) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock(mutex_);
+				cv_.wait(lock, [&]{ return exit_ || !tasks_.empty(); });
+				if(tasks_.empty()) {
+					return;
+				}
+
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	std::vector<std::thread> threads_;
+	std::deque<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool exit_ {false};
+};
+
+/// Returns a lazily created ThreadPool with the default number of workers.
+inline ThreadPool& defaultThreadPool() {
+	static ThreadPool pool;
+	return pool;
+}
+
+/// \brief Calls func(begin, end) for disjoint subranges covering [0, count).
+/// The ranges have (at most) 'grain' elements and are distributed
+/// dynamically to the workers of the given pool and the calling thread.
+/// Returns when all ranges were processed. If func throws, no new ranges
+/// are started and the first exception is rethrown in the calling thread.
+/// Can safely be called from tasks running on the same pool.
+template<typename F>
+void parallelFor(ThreadPool& pool, std::size_t count, std::size_t grain, F&& func) {
+	grain = grain ? grain : 1u;
+	auto chunks = (count + grain - 1) / grain;
+	auto helpers = std::min<std::size_t>(pool.workerCount(), chunks ? chunks - 1 : 0);
+	if(helpers == 0u) {
+		for(auto begin = std::size_t(0); begin < count; begin += grain) {
+			func(begin, std::min(begin + grain, count));
+		}
+		return;
+	}
+
+	// Helper tasks that start after the calling thread finished don't
+	// touch func anymore. Since we only wait for helpers that actually
+	// started, this can't deadlock when all workers are blocked.
+	struct State {
+		std::atomic<std::size_t> next {0};
+		std::atomic<bool> failed {false};
+		std::exception_ptr exception;
+		std::mutex mutex;
+		std::condition_variable cv;
+		unsigned active {0};
+		bool closed {false};
+	};
+
+	auto state = std::make_shared<State>();
+	auto run = [&func, count, grain](State& state) {
+		try {
+			while(!state.failed.load(std::memory_order_relaxed)) {
+				auto begin = state.next.fetch_add(grain, std::memory_order_relaxed);
+				if(begin >= count) {
+					break;
+				}
+
+				func(begin, std::min(begin + grain, count));
+			}
+		} catch(...) {
+			std::lock_guard lock(state.mutex);
+			if(!state.failed.exchange(true)) {
+				state.exception = std::current_exception();
+			}
+		}
+	};
+
+	for(auto i = 0u; i < helpers; ++i) {
+		pool.enqueue([state, &run]{
+			{
+				std::lock_guard lock(state->mutex);
+				if(state->closed) {
+					return;
+				}
+				++state->active;
+			}
+
+			run(*state);
+
+			std::lock_guard lock(state->mutex);
+			if(--state->active == 0) {
+				state->cv.notify_all();
+			}
+		});
+	}
+
+	run(*state);
+
+	std::unique_lock lock(state->mutex);
+	state->closed = true;
+	state->cv.wait(lock, [&]{ return state->active == 0; });
+	if(state->exception) {
+		std::rethrow_exception(state->exception);
+	}
+}
+
+} // namespace nytl
+
+#endif // header guard
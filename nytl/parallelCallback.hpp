@@ -0,0 +1,128 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines callParallel, calling the functions of a Callback in parallel.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_PARALLEL_CALLBACK
+#define NYTL_INCLUDE_PARALLEL_CALLBACK
+
+#include <nytl/callback.hpp> // nytl::Callback
+#include <nytl/parallel.hpp> // nytl::ThreadPool, nytl::parallelFor
+
+#include <vector> // std::vector
+#include <utility> // std::pair
+#include <mutex> // std::mutex
+#include <exception> // std::exception_ptr
+#include <stdexcept> // std::runtime_error
+#include <algorithm> // std::sort
+#include <type_traits> // std::decay_t
+#include <cstddef> // std::size_t
+
+namespace nytl {
+
+/// Thrown by callParallel when registered functions threw.
+/// Holds the exceptions of all functions that threw, in the order the
+/// functions were registered in the callback.
+class ParallelCallError : public std::runtime_error {
+public:
+	ParallelCallError(std::vector<std::exception_ptr> exceptions) :
+		std::runtime_error("nytl::callParallel: registered functions threw"),
+		exceptions_(std::move(exceptions)) {}
+
+	const std::vector<std::exception_ptr>& exceptions() const noexcept {
+		return exceptions_;
+	}
+
+protected:
+	std::vector<std::exception_ptr> exceptions_;
+};
+
+/// Parameters for callParallel.
+struct ParallelCallParams {
+	/// Below this number of registered functions, they are called serially
+	/// on the calling thread.
+	std::size_t minCount {32};
+
+	/// The number of functions called in one task. Zero chooses
+	/// it automatically depending on the number of workers.
+	std::size_t grain {0};
+};
+
+/// \brief Calls all registered functions of the given void callback in parallel,
+/// distributed dynamically over the workers of the given pool and the calling
+/// thread. Returns when all functions have returned.
+/// Only useful for many independent, expensive functions: there is no
+/// guarantee about the order in which the functions are called (priorities
+/// are ignored) and functions may be called concurrently.
+/// All functions receive the same arguments as const references and must
+/// therefore only read them. Parameters of the signature must be values
+/// or const references.
+/// Unlike Callback::call, all functions are called even if some throw.
+/// The exceptions are collected and thrown as a ParallelCallError, also
+/// when the functions were called serially.
+/// Like all other operations on the callback, the callback must not be changed
+/// (or called) from a registered function or concurrently.
+template<typename ID, template<typename> typename Function, typename... Args>
+void callParallel(const Callback<void(Args...), ID, Function>& cb, ThreadPool& pool,
+		const ParallelCallParams& params, const std::decay_t<Args>&... args) {
+	static_assert((true && ... && (!std::is_reference_v<Args> ||
+		std::is_const_v<std::remove_reference_t<Args>>)),
+		"nytl::callParallel: parameters must be values or const references");
+
+	using Error = std::pair<std::size_t, std::exception_ptr>;
+	std::vector<Error> errors;
+	std::mutex mutex;
+
+	const auto& subs = cb.subscriptions();
+	auto callRange = [&](std::size_t begin, std::size_t end) {
+		for(auto i = begin; i < end; ++i) {
+			try {
+				subs[i].func(args...);
+			} catch(...) {
+				std::lock_guard lock(mutex);
+				errors.emplace_back(i, std::current_exception());
+			}
+		}
+	};
+
+	auto count = subs.size();
+	if(count < params.minCount || pool.workerCount() == 0u) {
+		callRange(0u, count);
+	} else {
+		// about four tasks per thread, to balance differently expensive functions
+		auto grain = params.grain;
+		if(grain == 0u) {
+			auto tasks = 4u * (std::size_t(pool.workerCount()) + 1u);
+			grain = std::max<std::size_t>((count + tasks - 1) / tasks, 1u);
+		}
+
+		parallelFor(pool, count, grain, callRange);
+	}
+
+	if(!errors.empty()) {
+		std::sort(errors.begin(), errors.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
+
+		std::vector<std::exception_ptr> exceptions;
+		exceptions.reserve(errors.size());
+		for(auto& error : errors) {
+			exceptions.push_back(std::move(error.second));
+		}
+
+		throw ParallelCallError(std::move(exceptions));
+	}
+}
+
+/// Overload of callParallel that uses default parameters.
+template<typename ID, template<typename> typename Function, typename... Args>
+void callParallel(const Callback<void(Args...), ID, Function>& cb, ThreadPool& pool,
+		const std::decay_t<Args>&... args) {
+	callParallel(cb, pool, ParallelCallParams {}, args...);
+}
+
+} // namespace nytl
+
+#endif // header guard
@@ -2,10 +2,17 @@
 
 #include <cmath> // std::sin
 #include <cassert>
+#include <array> // std::array
+#include <type_traits> // std::is_same_v
 
 #include <nytl/vec.hpp>
 #include <nytl/vecOps.hpp>
 #include <nytl/mat.hpp>
+#include <nytl/simd.hpp>
+#include <nytl/tmpUtil.hpp>
+#include <nytl/span.hpp>
+
+#include <stdexcept> // std::invalid_argument
 
 // Simple, lightweight and independent Quaternion implementation.
 // Mostly put together from snippets and implementation notes on the internet.
@@ -46,31 +53,39 @@
 
 namespace nytl {
 
-// fwd
-class Quaternion;
-[[nodiscard]] inline Quaternion conjugated(const Quaternion& q);
-[[nodiscard]] inline Quaternion normalized(const Quaternion& q);
+template<typename P> class QuaternionT;
+
+using Quaternion = QuaternionT<double>;
+using Quaternionf = QuaternionT<float>;
+using Quaterniond = QuaternionT<double>;
 
 // Represents a mathematical quaternion, useful for representing 3D rotations.
-class Quaternion {
+// P is the precision of the components, Quaternionf (i.e. float precision)
+// takes half the memory of the default (double) Quaternion. The components
+// are stored 16-byte aligned in x, y, z, w order, so that (with NYTL_SIMD
+// enabled) operations on Quaternionf can use SIMD instructions.
+template<typename P>
+class alignas(16) QuaternionT {
 public:
-	double x {0.f};
-	double y {0.f};
-	double z {0.f};
-	double w {1.f};
+	using Precision = P;
+
+	P x {0.f};
+	P y {0.f};
+	P z {0.f};
+	P w {1.f};
 
 public:
 	// Constructs a Quaternion from an axis (given by x,y,z) and an angle (in radians)
 	// to rotate around the axis.
 	[[nodiscard]] static
-	Quaternion axisAngle(double ax, double ay, double az, double angle) {
+	QuaternionT axisAngle(P ax, P ay, P az, P angle) {
 		auto ha = std::sin(angle / 2);
 		return {ax * ha, ay * ha, az * ha, std::cos(angle / 2)};
 	}
 
-	[[nodiscard]] static
-	Quaternion axisAngle(const Vec3f& axis, double angle) {
-		return axisAngle(axis.x, axis.y, axis.z, angle);
+	template<typename T> [[nodiscard]] static
+	QuaternionT axisAngle(const Vec3<T>& axis, P angle) {
+		return axisAngle(P(axis.x), P(axis.y), P(axis.z), angle);
 	}
 
 	// Creates a quaternion from a yxz rotation sequence, where
@@ -86,13 +101,13 @@ public:
 	// rotations as seen above (or by looking up the optimized
 	// formula, as done here).
 	[[nodiscard]] static
-	Quaternion yxz(double yaw, double pitch, double roll) {
-		double cy = std::cos(yaw * 0.5);
-		double sy = std::sin(yaw * 0.5);
-		double cp = std::cos(pitch * 0.5);
-		double sp = std::sin(pitch * 0.5);
-		double cr = std::cos(roll * 0.5);
-		double sr = std::sin(roll * 0.5);
+	QuaternionT yxz(P yaw, P pitch, P roll) {
+		P cy = std::cos(yaw * P(0.5));
+		P sy = std::sin(yaw * P(0.5));
+		P cp = std::cos(pitch * P(0.5));
+		P sp = std::sin(pitch * P(0.5));
+		P cr = std::cos(roll * P(0.5));
+		P sr = std::sin(roll * P(0.5));
 
 		return {
 			cy * sp * cr + sy * cp * sr,
@@ -107,34 +122,34 @@ public:
 	// Can be used to create a quaternion that transforms the standard
 	// base from/to a given (orthogonal) vector base by setting the new
 	// base vectors as rows/columns.
-	template<typename P> static
-	Quaternion fromMat(const Mat3<P>& m) {
+	template<typename T> static
+	QuaternionT fromMat(const Mat3<T>& m) {
 		assert(std::abs(dot(m[0], m[1])) < 0.05);
 		assert(std::abs(dot(m[0], m[2])) < 0.05);
 		assert(std::abs(dot(m[1], m[2])) < 0.05);
 
 		// d3cw3dd2w32x2b.cloudfront.net/wp-content/uploads/2015/01/matrix-to-quat.pdf
-		double t;
-		Quaternion q;
+		P t;
+		QuaternionT q;
 		if(m[2][2] < 0) {
 			if(m[0][0] > m[1][1]){
 				t = 1.0 + m[0][0] - m[1][1] - m[2][2];
-				q = {t, m[1][0] + m[0][1], m[0][2] + m[2][0], m[2][1] - m[1][2]};
+				q = {t, P(m[1][0] + m[0][1]), P(m[0][2] + m[2][0]), P(m[2][1] - m[1][2])};
 			} else{
 				t= 1.0 - m[0][0] + m[1][1] - m[2][2];
-				q = {m[1][0] + m[0][1], t, m[2][1] + m[1][2], m[0][2] - m[2][0]};
+				q = {P(m[1][0] + m[0][1]), t, P(m[2][1] + m[1][2]), P(m[0][2] - m[2][0])};
 			}
 		} else {
 			if(m[0][0] < -m[1][1]){
 				t = 1.0 - m[0][0] - m[1][1] + m[2][2];
-				q = {m[0][2] + m[2][0], m[2][1] + m[1][2], t, m[1][0] - m[0][1]};
+				q = {P(m[0][2] + m[2][0]), P(m[2][1] + m[1][2]), t, P(m[1][0] - m[0][1])};
 			} else{
 				t = 1.0 + m[0][0] + m[1][1] + m[2][2];
-				q = {m[2][1] - m[1][2], m[0][2] - m[2][0], m[1][0] - m[0][1], t};
+				q = {P(m[2][1] - m[1][2]), P(m[0][2] - m[2][0]), P(m[1][0] - m[0][1]), t};
 			}
 		}
 
-		double f = 0.5 / std::sqrt(t);
+		P f = P(0.5) / std::sqrt(t);
 		q.x *= f;
 		q.y *= f;
 		q.z *= f;
@@ -147,7 +162,12 @@ public:
 	// Quaternion() noexcept = default;
 
 	// hamilton product of quaternions
-	Quaternion& operator*=(const Quaternion& rhs) {
+	QuaternionT& operator*=(const QuaternionT& rhs) {
+		if constexpr(std::is_same_v<P, float> && detail::simd::hasQuat4) {
+			detail::simd::quatMul(&x, &x, &rhs.x);
+			return *this;
+		}
+
 		auto nx = w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y;
 		auto ny = w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x;
 		auto nz = w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w;
@@ -155,14 +175,22 @@ public:
 		*this = {nx, ny, nz, nw};
 		return *this;
 	}
+
+	// Converts the quaternion to another precision.
+	template<typename O>
+	explicit operator QuaternionT<O>() const {
+		return {O(x), O(y), O(z), O(w)};
+	}
 };
 
 // - operators and functions -
-inline Quaternion operator*(Quaternion a, const Quaternion& b) {
+template<typename P>
+QuaternionT<P> operator*(QuaternionT<P> a, const QuaternionT<P>& b) {
 	return (a *= b);
 }
 
-inline Quaternion operator*(double a, Quaternion b) {
+template<typename P>
+QuaternionT<P> operator*(NonDeduced<P> a, QuaternionT<P> b) {
 	b.x *= a;
 	b.y *= a;
 	b.z *= a;
@@ -170,7 +198,8 @@ inline Quaternion operator*(double a, Quaternion b) {
 	return b;
 }
 
-inline Quaternion operator-(Quaternion a, const Quaternion& b) {
+template<typename P>
+QuaternionT<P> operator-(QuaternionT<P> a, const QuaternionT<P>& b) {
 	a.x -= b.x;
 	a.y -= b.y;
 	a.z -= b.z;
@@ -178,7 +207,8 @@ inline Quaternion operator-(Quaternion a, const Quaternion& b) {
 	return a;
 }
 
-inline Quaternion operator+(Quaternion a, const Quaternion& b) {
+template<typename P>
+QuaternionT<P> operator+(QuaternionT<P> a, const QuaternionT<P>& b) {
 	a.x += b.x;
 	a.y += b.y;
 	a.z += b.z;
@@ -186,19 +216,21 @@ inline Quaternion operator+(Quaternion a, const Quaternion& b) {
 	return a;
 }
 
-inline bool operator==(const Quaternion& a, const Quaternion& b) {
+template<typename P>
+bool operator==(const QuaternionT<P>& a, const QuaternionT<P>& b) {
 	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
 }
 
-inline bool operator!=(const Quaternion& a, const Quaternion& b) {
+template<typename P>
+bool operator!=(const QuaternionT<P>& a, const QuaternionT<P>& b) {
 	return a.x != b.x || a.y != b.y || a.z != b.z || a.w != b.w;
 }
 
 // Returns a row-major NxN matrix that represents the given Quaternion.
 // Same as an identity matrix with the first 3 colums being
 //   apply(q, {1, 0, 0}), apply(q, {0, 1, 0}), apply(q, {0, 0, 1})
-template<std::size_t N, typename T = float>
-[[nodiscard]] SquareMat<N, T> toMat(const Quaternion& q) {
+template<std::size_t N, typename T = float, typename P>
+[[nodiscard]] SquareMat<N, T> toMat(const QuaternionT<P>& q) {
 	static_assert(N >= 3);
 	SquareMat<N, T> ret {};
 
@@ -234,32 +266,48 @@ template<std::size_t N, typename T = float>
 
 // Returns the conjugate of the given Quaternion (simply taking the
 // negative of the non-real parts).
-[[nodiscard]] inline Quaternion conjugated(const Quaternion& q) {
+template<typename P>
+[[nodiscard]] QuaternionT<P> conjugated(const QuaternionT<P>& q) {
 	return {-q.x, -q.y, -q.z, q.w};
 }
 
 // Returns the norm of the given Quaternion.
-[[nodiscard]] inline double norm(const Quaternion& q) {
+template<typename P>
+[[nodiscard]] P norm(const QuaternionT<P>& q) {
 	return std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
 }
 
 // Returns a unit quaternion for the given quaternion.
-[[nodiscard]] inline Quaternion normalized(const Quaternion& q) {
+template<typename P>
+[[nodiscard]] QuaternionT<P> normalized(const QuaternionT<P>& q) {
+	if constexpr(std::is_same_v<P, float> && detail::simd::hasQuat4) {
+		QuaternionT<P> ret;
+		if(!detail::simd::quatNormalize(&ret.x, &q.x)) return {};
+		return ret;
+	}
+
 	auto l = norm(q);
-	if(l <= 0.0) return {0.0, 0.0, 0.0, 1.0};
+	if(l <= 0.0) return {P(0.0), P(0.0), P(0.0), P(1.0)};
 	return {q.x / l, q.y / l, q.z / l, q.w / l};
 }
 
 // Returns the given vector rotated by the rotation represented by the given
 // Quaternion.
-template<typename T>
-[[nodiscard]] Vec3<T> apply(const Quaternion& q, const Vec3<T>& v) {
+template<typename P, typename T>
+[[nodiscard]] Vec3<T> apply(const QuaternionT<P>& q, const Vec3<T>& v) {
+	if constexpr(std::is_same_v<P, float> && std::is_same_v<T, float> &&
+			detail::simd::hasQuat4) {
+		Vec3<T> ret;
+		detail::simd::quatApply(ret.data(), &q.x, v.data());
+		return ret;
+	}
+
 	// optimized version, see
 	// https://gamedev.stackexchange.com/questions/28395
-	Vec3d u {q.x, q.y, q.z};
-	auto r = 2.0 * dot(u, v) * u
+	Vec3<P> u {q.x, q.y, q.z};
+	auto r = P(2.0) * dot(u, v) * u
 		+ (q.w * q.w - dot(u, u)) * v
-		+ 2.0 * q.w * cross(u, v);
+		+ P(2.0) * q.w * cross(u, v);
 	return Vec3<T>(r);
 
 	// Reference implementation, using the mathematical definition.
@@ -270,47 +318,169 @@ template<typename T>
 	// return {T(qr.x), T(qr.y), T(qr.z)};
 }
 
-[[nodiscard]] inline double dot(const Quaternion& a, const Quaternion& b) {
-	return a.x * b.x + a.y * b.y + a.z * b.y * a.w * b.y;
+template<typename P>
+[[nodiscard]] P dot(const QuaternionT<P>& a, const QuaternionT<P>& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
 }
 
 // https://en.wikipedia.org/wiki/Slerp
 // Assumes q0 and q1 to be normalized. Result isn't normalized.
-[[nodiscard]] inline Quaternion slerp(Quaternion v0, Quaternion v1, double t) {
+template<typename P>
+[[nodiscard]] QuaternionT<P> slerp(QuaternionT<P> v0, QuaternionT<P> v1, NonDeduced<P> t) {
     // Compute the cosine of the angle between the two vectors.
-    double d = dot(v0, v1);
+    P d = dot(v0, v1);
 
     // If the dot product is negative, slerp won't take
     // the shorter path. Note that v1 and -v1 are equivalent when
     // the negation is applied to all four components. Fix by
     // reversing one quaternion.
     if (d < 0.0f) {
-        v1.x = v1.x;
-        v1.y = v1.y;
-        v1.z = v1.z;
-        v1.w = v1.w;
+        v1.x = -v1.x;
+        v1.y = -v1.y;
+        v1.z = -v1.z;
+        v1.w = -v1.w;
         d = -d;
     }
 
-	constexpr auto dotThreshold = 0.9995;
+	constexpr auto dotThreshold = P(0.9995);
     if (d > dotThreshold) {
         // If the inputs are too close, linearly interpolate and normalize
-        Quaternion result = v0 + t * (v1 - v0);
+        QuaternionT<P> result = v0 + t * (v1 - v0);
         return normalized(result);
     }
 
     // acos is safe, d is in range [0, dotThreshold]
-    double theta0 = std::acos(d); // angle between input vectors
-    double theta = theta0 * t; // angle between v0 and result
-    double sinTheta = std::sin(theta);
-    double sinTheta0 = std::sin(theta0);
+    P theta0 = std::acos(d); // angle between input vectors
+    P theta = theta0 * t; // angle between v0 and result
+    P sinTheta = std::sin(theta);
+    P sinTheta0 = std::sin(theta0);
 
-    double s0 = cos(theta) - d * sinTheta / sinTheta0; // sin(theta0 - theta) / sin(theta0)
-    double s1 = sinTheta / sinTheta0;
+    P s0 = std::cos(theta) - d * sinTheta / sinTheta0; // sin(theta0 - theta) / sin(theta0)
+    P s1 = sinTheta / sinTheta0;
 
     return (s0 * v0) + (s1 * v1);
 }
 
+// Normalized linear interpolation along the shorter path.
+// Assumes q0 and q1 to be normalized, the result is normalized.
+// Way cheaper than slerp but does not interpolate with constant
+// angular velocity.
+template<typename P>
+[[nodiscard]] QuaternionT<P> nlerp(const QuaternionT<P>& q0,
+		const QuaternionT<P>& q1, NonDeduced<P> t) {
+	QuaternionT<P> ret;
+	detail::simd::lerpQ<false>(&ret.x, &q0.x, &q1.x, &t, 0, 1);
+	return ret;
+}
+
+// Approximation of slerp: nlerp with a corrected interpolation factor.
+// The angle between the result and slerp(q0, q1, t) is below 0.0008 radians,
+// for the corrected factor only a few multiplications are needed, so this
+// is almost as fast as nlerp. Unlike slerp, the result is normalized.
+// Assumes q0 and q1 to be normalized.
+template<typename P>
+[[nodiscard]] QuaternionT<P> slerpFast(const QuaternionT<P>& q0,
+		const QuaternionT<P>& q1, NonDeduced<P> t) {
+	QuaternionT<P> ret;
+	detail::simd::lerpQ<true>(&ret.x, &q0.x, &q1.x, &t, 0, 1);
+	return ret;
+}
+
+// - batched interpolation -
+// Interpolate between a[i] and b[i] and write the results into out[i].
+// The interpolation factor is either t[i] or the same t for all.
+// Throws std::invalid_argument if the spans don't have the same size,
+// out may be the same as a or b.
+// nlerp and slerpFast use SIMD instructions if enabled, handling multiple
+// quaternions at once. Their results are the same as for the
+// single-quaternion overloads (unless the compiler contracts floating
+// point operations differently).
+namespace detail {
+	template<typename P>
+	const P* flat(span<const QuaternionT<P>> q) {
+		static_assert(sizeof(QuaternionT<P>) == 4 * sizeof(P));
+		return reinterpret_cast<const P*>(q.data());
+	}
+
+	template<typename P>
+	P* flat(span<QuaternionT<P>> q) {
+		return reinterpret_cast<P*>(q.data());
+	}
+
+	template<bool Fast, typename P>
+	void lerpBatch(const char* func, span<const QuaternionT<P>> a,
+			span<const QuaternionT<P>> b, const P* t, std::size_t tStride,
+			span<QuaternionT<P>> out) {
+		if(b.size() != a.size() || out.size() != a.size()) {
+			throw std::invalid_argument(func);
+		}
+
+		simd::lerpQ<Fast>(flat(out), flat(a), flat(b), t, tStride, a.size());
+	}
+
+	template<typename P, typename F>
+	void slerpBatch(span<const QuaternionT<P>> a, span<const QuaternionT<P>> b,
+			span<QuaternionT<P>> out, F&& t) {
+		if(b.size() != a.size() || out.size() != a.size()) {
+			throw std::invalid_argument("nytl::slerp");
+		}
+
+		for(auto i = 0u; i < a.size(); ++i) {
+			out[i] = slerp(a[i], b[i], t(i));
+		}
+	}
+} // namespace detail
+
+template<typename P>
+void nlerp(span<const QuaternionT<P>> a, span<const NonDeduced<QuaternionT<P>>> b,
+		span<const NonDeduced<P>> t, span<NonDeduced<QuaternionT<P>>> out) {
+	if(t.size() != a.size()) {
+		throw std::invalid_argument("nytl::nlerp");
+	}
+
+	detail::lerpBatch<false>("nytl::nlerp", a, b, t.data(), 1, out);
+}
+
+template<typename P>
+void nlerp(span<const QuaternionT<P>> a, span<const NonDeduced<QuaternionT<P>>> b,
+		NonDeduced<P> t, span<NonDeduced<QuaternionT<P>>> out) {
+	detail::lerpBatch<false>("nytl::nlerp", a, b, &t, 0, out);
+}
+
+template<typename P>
+void slerpFast(span<const QuaternionT<P>> a, span<const NonDeduced<QuaternionT<P>>> b,
+		span<const NonDeduced<P>> t, span<NonDeduced<QuaternionT<P>>> out) {
+	if(t.size() != a.size()) {
+		throw std::invalid_argument("nytl::slerpFast");
+	}
+
+	detail::lerpBatch<true>("nytl::slerpFast", a, b, t.data(), 1, out);
+}
+
+template<typename P>
+void slerpFast(span<const QuaternionT<P>> a, span<const NonDeduced<QuaternionT<P>>> b,
+		NonDeduced<P> t, span<NonDeduced<QuaternionT<P>>> out) {
+	detail::lerpBatch<true>("nytl::slerpFast", a, b, &t, 0, out);
+}
+
+// Exact slerp, computed one quaternion at a time (see slerpFast for
+// a vectorized approximation).
+template<typename P>
+void slerp(span<const QuaternionT<P>> a, span<const NonDeduced<QuaternionT<P>>> b,
+		span<const NonDeduced<P>> t, span<NonDeduced<QuaternionT<P>>> out) {
+	if(t.size() != a.size()) {
+		throw std::invalid_argument("nytl::slerp");
+	}
+
+	detail::slerpBatch(a, b, out, [&](auto i) { return t[i]; });
+}
+
+template<typename P>
+void slerp(span<const QuaternionT<P>> a, span<const NonDeduced<QuaternionT<P>>> b,
+		NonDeduced<P> t, span<NonDeduced<QuaternionT<P>>> out) {
+	detail::slerpBatch(a, b, out, [&](auto) { return t; });
+}
+
 // Sequences of rotation around axes.
 // https://en.wikipedia.org/wiki/Euler_angles
 enum class RotationSequence {
@@ -338,13 +508,13 @@ enum class RotationSequence {
 // rotY(res[0]) * rotX(res[1]) * rotZ(res[2]) (for global axes, notice how
 // this means global Z rotation is applied first) is the same as
 // the given quaternion.
-[[nodiscard]] inline std::array<double, 3>
-eulerAngles(const Quaternion& q, RotationSequence seq) {
+template<typename P>
+[[nodiscard]] std::array<P, 3>
+eulerAngles(const QuaternionT<P>& q, RotationSequence seq) {
 	// TODO: 'indet' handling somewhat hacky atm. We need that value
 	// in case the middle rotation is zero (indeterminite case)
-	auto classicEuler = [](double a, double b, double c, double d, double e,
-			double indet) {
-		auto res = std::array<double, 3> {
+	auto classicEuler = [](P a, P b, P c, P d, P e, P indet) {
+		auto res = std::array<P, 3> {
 			std::atan2(d, e),
 			std::acos(c),
 			std::atan2(a, b),
@@ -354,14 +524,14 @@ eulerAngles(const Quaternion& q, RotationSequence seq) {
 			// need different handling in this case.
 			// (basically middle angle is zero, getting undefined
 			// results atm).
-			return std::array<double, 3>{std::asin(indet), 0.0, 0.0};
+			return std::array<P, 3>{std::asin(indet), P(0.0), P(0.0)};
 		}
 
 		return res;
 	};
 
-	auto taitBryan = [](double a, double b, double c, double d, double e) {
-		return std::array<double, 3> {
+	auto taitBryan = [](P a, P b, P c, P d, P e) {
+		return std::array<P, 3> {
 			std::atan2(a, b),
 			std::asin(c),
 			std::atan2(d, e),
@@ -0,0 +1,213 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the QueuedDispatcher class for deferred callback calls.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_QUEUED_DISPATCHER
+#define NYTL_INCLUDE_QUEUED_DISPATCHER
+
+#include <nytl/callback.hpp> // nytl::Callback
+#include <nytl/nonCopyable.hpp> // nytl::NonCopyable
+#include <nytl/scope.hpp> // nytl::ScopeGuard
+
+#include <tuple> // std::tuple, std::apply
+#include <vector> // std::vector
+#include <utility> // std::move
+#include <cstddef> // std::size_t
+#include <type_traits> // std::decay_t
+#include <algorithm> // std::find
+#include <iterator> // std::make_move_iterator
+#include <stdexcept> // std::invalid_argument
+
+namespace nytl {
+
+/// How a QueuedDispatcher handles events that are equal to already
+/// queued events.
+enum class Coalesce {
+	none, // all events are queued
+	last, // events equal to the last queued event are dropped, O(1)
+	any, // events equal to any queued event are dropped, O(n)
+};
+
+namespace detail {
+	template<typename T, typename = void>
+	struct IsEqualityComparable : std::false_type {};
+
+	template<typename T>
+	struct IsEqualityComparable<T, std::void_t<
+		decltype(std::declval<const T&>() == std::declval<const T&>())>>
+		: std::true_type {};
+
+	template<typename T>
+	struct IsCallback : std::false_type {};
+
+	template<typename S, typename ID, template<typename> typename F>
+	struct IsCallback<Callback<S, ID, F>> : std::true_type {};
+} // namespace detail
+
+/// Queues calls to a callback and dispatches them later on in one batch.
+/// Enqueuing just stores the (decayed) arguments, no registered functions
+/// are called. Useful when the same callback is called many times e.g.
+/// per frame so that the registered functions can be called in one tight loop.
+/// The return values of the registered functions are discarded.
+/// Arguments are stored by value, i.e. functions that take non-const
+/// references will only modify the stored copies. Since the stored
+/// arguments are passed to multiple functions by flushBatched, it
+/// requires a signature without rvalue reference parameters.
+/// Enqueuing does not allocate as long as the number of queued events does
+/// not exceed the number of events previously queued at once.
+/// Like the callbacks, this class is not thread-safe.
+/// \tparam CB The callback type to dispatch to, e.g. nytl::Callback or
+/// nytl::RecursiveCallback.
+template<typename CB, typename Signature = typename CB::Signature>
+class QueuedDispatcher;
+
+template<typename CB, typename Ret, typename... Args>
+class QueuedDispatcher<CB, Ret(Args...)> : public NonCopyable {
+public:
+	using Event = std::tuple<std::decay_t<Args>...>;
+
+	// std::tuple's comparison is not sfinae-friendly, check the elements
+	static constexpr bool comparable = (true && ... &&
+		detail::IsEqualityComparable<std::decay_t<Args>>::value);
+
+public:
+	/// Creates a dispatcher for the given callback, which must
+	/// outlive the dispatcher.
+	/// \throws std::invalid_argument If coalescing is requested but the
+	/// arguments can't be compared.
+	QueuedDispatcher(CB& cb, Coalesce coalesce = Coalesce::none) :
+			callback_(&cb), coalesce_(coalesce) {
+		if(coalesce != Coalesce::none && !comparable) {
+			throw std::invalid_argument("nytl::QueuedDispatcher: "
+				"coalescing requires comparable arguments");
+		}
+	}
+
+	/// Queues a call with the given arguments.
+	/// Returns false if the event was coalesced with a queued one.
+	bool enqueue(Args... args) {
+		if constexpr(comparable) {
+			if(coalesce_ != Coalesce::none && !queue_.empty()) {
+				Event event {std::forward<Args>(args)...};
+				if(coalesce_ == Coalesce::last && queue_.back() == event) {
+					return false;
+				} else if(coalesce_ == Coalesce::any &&
+						std::find(queue_.begin(), queue_.end(), event) != queue_.end()) {
+					return false;
+				}
+
+				queue_.push_back(std::move(event));
+				return true;
+			}
+		}
+
+		queue_.emplace_back(std::forward<Args>(args)...);
+		return true;
+	}
+
+	/// Operator version of enqueue.
+	bool operator()(Args... args) {
+		return enqueue(std::forward<Args>(args)...);
+	}
+
+	/// Calls the callback for all currently queued events, in order.
+	/// Events queued while flushing (e.g. from a registered function)
+	/// are not dispatched in this flush.
+	/// Returns the number of dispatched events.
+	/// If a registered function throws, the exception is propagated and
+	/// the remaining events are queued again.
+	std::size_t flush() {
+		auto batch = take();
+		auto i = std::size_t(0);
+		try {
+			for(; i < batch.size(); ++i) {
+				std::apply([&](auto&... args) {
+					dispatch(std::forward<Args>(args)...);
+				}, batch[i]);
+			}
+		} catch(...) {
+			queue_.insert(queue_.begin(),
+				std::make_move_iterator(batch.begin() + i + 1),
+				std::make_move_iterator(batch.end()));
+			giveBack(std::move(batch));
+			throw;
+		}
+
+		giveBack(std::move(batch));
+		return i;
+	}
+
+	/// Like flush, but calls each registered function for all events
+	/// before calling the next function, keeping the function and its
+	/// data hot. Note that this changes the relative order of calls
+	/// of different functions.
+	/// Only available for nytl::Callback.
+	/// If a registered function throws, the exception is propagated and
+	/// all events of this batch are dropped.
+	std::size_t flushBatched() {
+		static_assert(detail::IsCallback<CB>::value,
+			"nytl::QueuedDispatcher::flushBatched: requires nytl::Callback");
+
+		auto batch = take();
+		auto guard = ScopeGuard([&]{ giveBack(std::move(batch)); });
+		for(auto& sub : callback_->subscriptions()) {
+			for(auto& event : batch) {
+				std::apply([&](auto&... args) { sub.func(args...); }, event);
+			}
+		}
+
+		return batch.size();
+	}
+
+	/// Drops all queued events.
+	void clear() noexcept { queue_.clear(); }
+
+	/// Makes sure the given number of events can be queued without allocation.
+	void reserve(std::size_t size) { queue_.reserve(size); }
+
+	std::size_t size() const noexcept { return queue_.size(); }
+	bool empty() const noexcept { return queue_.empty(); }
+	CB& callback() const noexcept { return *callback_; }
+	Coalesce coalesce() const noexcept { return coalesce_; }
+
+protected:
+	// Takes all queued events. The buffers are swapped so that
+	// no memory has to be allocated.
+	std::vector<Event> take() noexcept {
+		std::vector<Event> batch;
+		std::swap(batch, spare_);
+		std::swap(batch, queue_);
+		return batch;
+	}
+
+	// Returns the given batch buffer for reuse.
+	void giveBack(std::vector<Event>&& batch) noexcept {
+		batch.clear();
+		if(batch.capacity() > spare_.capacity()) {
+			spare_ = std::move(batch);
+		}
+	}
+
+	// The stored event is passed on as if it was passed to call directly.
+	template<typename... A>
+	void dispatch(A&&... args) {
+		if constexpr(std::is_void_v<Ret>) {
+			callback_->call(std::forward<A>(args)...);
+		} else {
+			callback_->collect([](auto&&) {}, std::forward<A>(args)...);
+		}
+	}
+
+	CB* callback_;
+	Coalesce coalesce_;
+	std::vector<Event> queue_; // the queued events
+	std::vector<Event> spare_; // buffer reused for the next queue
+};
+
+} // namespace nytl
+
+#endif // header guard
@@ -11,10 +11,12 @@
 
 #include <nytl/connection.hpp> // nytl::BasicConnection
 #include <nytl/nonCopyable.hpp> // nytl::NonCopyable
+#include <nytl/collector.hpp> // nytl::detail::collect
 #include <nytl/scope.hpp> // nytl::ScopeGuard
 
 #include <functional> // std::function
-#include <forward_list> // std::forward_list
+#include <memory_resource> // std::pmr::memory_resource
+#include <new> // placement new
 #include <utility> // std::move
 #include <cstdint> // std::uint64_t
 #include <cstddef> // std::size_t
@@ -26,7 +28,174 @@
 
 namespace nytl {
 
-// TODO (C++17): use std::pmr for more efficient memory allocations (?)
+namespace detail {
+
+/// Sequence container that stores its elements in chunks of growing size.
+/// In contrast to std::vector, adding elements never moves or invalidates
+/// existing elements (and iterators), making it possible to add elements
+/// while iterating. In contrast to a std::list, elements are mostly
+/// contiguous and there is no allocation per element.
+/// Chunks are only freed on destruction, i.e. reused after clear or erase.
+/// Allocates chunks from a std::pmr::memory_resource.
+template<typename T>
+class ChunkedVector : public NonCopyable {
+public:
+	static constexpr std::size_t firstChunkSize = 8;
+
+	template<typename V>
+	class Iterator {
+	public:
+		Iterator(const ChunkedVector& vec, std::size_t index) noexcept :
+				vec_(&vec), index_(index) {
+			// we only have to support begin and end
+			if(vec.chunks_.empty() || index == vec.size_) {
+				chunk_ = vec.tailChunk_;
+				offset_ = vec.tailOffset_;
+			}
+
+			data_ = chunk_ < vec.chunks_.size() ? vec.chunks_[chunk_] : nullptr;
+		}
+
+		V& operator*() const noexcept { return data_[offset_]; }
+		V* operator->() const noexcept { return data_ + offset_; }
+		std::size_t index() const noexcept { return index_; }
+
+		Iterator& operator++() noexcept {
+			++index_;
+			if(++offset_ == chunkSize(chunk_)) {
+				offset_ = 0u;
+				++chunk_;
+				data_ = chunk_ < vec_->chunks_.size() ? vec_->chunks_[chunk_] : nullptr;
+			}
+
+			return *this;
+		}
+
+		bool operator==(const Iterator& rhs) const noexcept { return index_ == rhs.index_; }
+		bool operator!=(const Iterator& rhs) const noexcept { return index_ != rhs.index_; }
+
+	protected:
+		const ChunkedVector* vec_;
+		V* data_ {};
+		std::size_t chunk_ {};
+		std::size_t offset_ {};
+		std::size_t index_ {};
+	};
+
+	using iterator = Iterator<T>;
+	using const_iterator = Iterator<const T>;
+
+public:
+	ChunkedVector() = default;
+	explicit ChunkedVector(std::pmr::memory_resource* mem) : chunks_(mem) {}
+
+	~ChunkedVector() {
+		clear();
+		std::pmr::polymorphic_allocator<T> alloc(chunks_.get_allocator());
+		for(auto i = 0u; i < chunks_.size(); ++i) {
+			alloc.deallocate(chunks_[i], chunkSize(i));
+		}
+	}
+
+	/// Default-constructs a new element at the end.
+	/// Never invalidates references or iterators.
+	T& emplace_back() {
+		if(tailChunk_ == chunks_.size()) {
+			std::pmr::polymorphic_allocator<T> alloc(chunks_.get_allocator());
+			auto* chunk = alloc.allocate(chunkSize(tailChunk_));
+			try {
+				chunks_.push_back(chunk);
+			} catch(...) {
+				alloc.deallocate(chunk, chunkSize(tailChunk_));
+				throw;
+			}
+		}
+
+		auto* ret = new(chunks_[tailChunk_] + tailOffset_) T();
+		++size_;
+		if(++tailOffset_ == chunkSize(tailChunk_)) {
+			tailOffset_ = 0u;
+			++tailChunk_;
+		}
+
+		return *ret;
+	}
+
+	/// Returns the element with the given index in O(log(index)).
+	T& operator[](std::size_t i) noexcept {
+		// chunk c contains the indices [first * (2^c - 1), first * (2^(c+1) - 1))
+		auto v = i / firstChunkSize + 1;
+		auto chunk = std::size_t(0u);
+		while(v >>= 1) {
+			++chunk;
+		}
+
+		return chunks_[chunk][i - firstChunkSize * ((std::size_t(1u) << chunk) - 1)];
+	}
+
+	/// Destroys the last element.
+	void pop_back() noexcept {
+		if(tailOffset_ == 0u) {
+			--tailChunk_;
+			tailOffset_ = chunkSize(tailChunk_);
+		}
+
+		--tailOffset_;
+		--size_;
+		chunks_[tailChunk_][tailOffset_].~T();
+	}
+
+	/// Destroys all elements, keeps the allocated chunks.
+	void clear() noexcept {
+		while(size_) {
+			pop_back();
+		}
+	}
+
+	/// Erases all elements for which the given predicate returns true,
+	/// keeps the order of the remaining elements.
+	/// The predicate is called exactly once for each element, in order.
+	template<typename Pred>
+	void eraseIf(Pred&& pred) noexcept {
+		auto dst = begin();
+		for(auto src = begin(); src != end(); ++src) {
+			if(pred(*src)) {
+				continue;
+			}
+
+			if(dst != src) {
+				*dst = std::move(*src);
+			}
+
+			++dst;
+		}
+
+		auto count = size_ - dst.index();
+		for(auto i = 0u; i < count; ++i) {
+			pop_back();
+		}
+	}
+
+	iterator begin() noexcept { return {*this, 0u}; }
+	iterator end() noexcept { return {*this, size_}; }
+	const_iterator begin() const noexcept { return {*this, 0u}; }
+	const_iterator end() const noexcept { return {*this, size_}; }
+
+	std::size_t size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0u; }
+
+	static constexpr std::size_t chunkSize(std::size_t chunk) noexcept {
+		return firstChunkSize << chunk;
+	}
+
+protected:
+	std::pmr::vector<T*> chunks_;
+	std::size_t size_ {};
+	std::size_t tailChunk_ {}; // chunk of the next element
+	std::size_t tailOffset_ {}; // offset of the next element in tailChunk_
+};
+
+} // namespace detail
 
 /// List of callback functions.
 /// Everyone can register their functions in a callback object and
@@ -46,7 +215,11 @@ namespace nytl {
 /// Uses the same syntax and semantics as std::function.
 /// \tparam ID A connectionID class, see nytl/connection.hpp for examples.
 /// See docs/callback.md for specification.
-template<typename Signature, typename ID = ConnectionID>
+/// \tparam Function The type used to store the registered functions,
+/// see nytl::Callback. Note that functions that take the connection as
+/// additional parameter are stored together with the connection.
+template<typename Signature, typename ID = ConnectionID,
+	template<typename> typename Function = std::function>
 class RecursiveCallback;
 
 /// Callback class typedef using TrackedConnectionID. Enables connections
@@ -55,28 +228,40 @@ class RecursiveCallback;
 template<typename Signature> using TrackedRecursiveCallback =
 	RecursiveCallback<Signature, TrackedConnectionID>;
 
+/// Callback class typedef using PooledConnectionID. Same as the tracked
+/// version but does not allocate per connection.
+template<typename Signature> using PooledRecursiveCallback =
+	RecursiveCallback<Signature, PooledConnectionID>;
+
 // Callback specialization to enable the Ret(Args...) Signature format.
-template<typename Ret, typename... Args, typename ID>
-class RecursiveCallback<Ret(Args...), ID>
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+class RecursiveCallback<Ret(Args...), ID, Function>
 	: public ConnectableT<ID>, public NonCopyable {
 public:
 	using Signature = Ret(Args...);
+	using FunctionType = Function<Ret(Args...)>;
 	using Connection = ConnectionT<ConnectableT<ID>, ID>;
 
 	RecursiveCallback() = default;
 	~RecursiveCallback();
 
+	/// Allocates the subscriptions from the given memory resource.
+	explicit RecursiveCallback(std::pmr::memory_resource* mem) : subs_(mem) {}
+
 	/// \brief Registers a new Callback function.
 	/// \returns A connection id for the registered function which can be used to
 	/// unregister it.
 	/// \throws std::invalid_argument If an empty function target is registered.
-	Connection add(std::function<Ret(Args...)>);
+	Connection add(FunctionType);
 
 	/// \brief Registers a new Callback function with additional connection parameter.
 	/// \returns A connection id for the registered function which can be used to
 	/// unregister it.
 	/// \throws std::invalid_argument If an empty function target is registered.
-	Connection add(std::function<Ret(Connection, Args...)>);
+	template<typename F, typename = std::enable_if_t<
+		std::is_invocable_r_v<Ret, std::decay_t<F>&, Connection, Args...>>>
+	Connection add(F&&);
 
 	/// Calls all registered functions and returns a vector with the returned objects,
 	/// or void when this is a void callback.
@@ -87,14 +272,23 @@ public:
 	/// from disconnect.
 	auto call(Args...);
 
+	/// Calls all registered functions like call but passes the returned values
+	/// to the given collector instead of returning them in a vector, i.e. does
+	/// not allocate. If the collector returns a bool, false stops the iteration
+	/// and the following functions will not be called.
+	/// Returns the collector. See nytl/collector.hpp for predefined collectors.
+	/// Only available for non-void callbacks.
+	template<typename C>
+	C collect(C collector, Args...);
+
 	/// Clears all registered functions.
 	void clear() noexcept;
 
 	/// Removes the callback function registered with the given id.
 	/// Returns whether the function could be found. If the id is invalid or the
 	/// associated function was already removed, returns false.
-	/// ID::remove() might be defered until all pending iterations (calls/removes)
-	/// are done.
+	/// ID::removed() is called immediately if no iteration (call) is active,
+	/// otherwise it is deferred until all pending iterations are done.
 	/// Passing an invalid id or an id that was not returned from this
 	/// callback is undefined behvaiour.
 	bool disconnect(const ID&) noexcept override;
@@ -124,10 +318,10 @@ protected:
 	// remove subscriptions from the outside without actively
 	// calling disconnect.
 	// We cannot touch func while any iteration is active.
-	// If the
 	struct Subscription {
-		std::function<Ret(Args...)> func;
+		FunctionType func;
 		ID id;
+		std::int64_t key; // the original id value, for lookup
 	};
 
 	// Emplaces a new subscription for the given function.
@@ -143,65 +337,63 @@ protected:
 		// our own state in any bad way
 		ID id = {subID_ + 1};
 
-		// emplace at the last position
-		// might also throw
-		if(subs_.empty()) {
-			subs_.emplace_front();
-			last_ = subs_.begin();
-		} else {
-			last_ = subs_.emplace_after(last_);
-		}
-
+		// might also throw, does not invalidate references
+		auto& sub = subs_.emplace_back();
 		++subID_;
-		last_->id = {id};
-		return *last_;
+		sub.id = {id};
+		sub.key = subID_;
+		return sub;
 	}
 
+	// Calls f for all subscriptions that should be called in a new
+	// call until it returns false. Manages the call id and iteration count.
+	template<typename F>
+	void iterate(F&& f);
+
 	// Removes all old functions that could previously
 	// not be removed because of an active iteration.
 	void removeOld() noexcept {
 		++iterationCount_;
-
-		// just remove subscriptions with id <= 0 and update last_
-		auto it = subs_.begin();
-		while(it != subs_.end() && it->id.get() <= 0) {
-			subs_.pop_front();
-			it = subs_.begin();
-		}
-
-		if(it != subs_.end()) {
-			for(auto next = std::next(it); next != subs_.end(); next = std::next(it)) {
-				if(next->id.get() <= 0) {
-					next->id.removed();
-					subs_.erase_after(it);
-				} else {
-					++it;
-				}
+		removed_ = 0u;
+
+		// First notify the ids and destroy the functions while the store is
+		// in a consistent state since this might run arbitrary code
+		// (e.g. disconnect other subscriptions).
+		for(auto& sub : subs_) {
+			if(sub.id.get() <= 0) {
+				sub.id.removed();
+				[[maybe_unused]] auto func = std::move(sub.func);
+				sub.func = FunctionType {};
 			}
 		}
 
-		last_ = it;
+		// Subscriptions that were removed from the code above still have
+		// their function and are removed the next time.
+		subs_.eraseIf([](const Subscription& sub) {
+			return sub.id.get() <= 0 && !sub.func;
+		});
+
 		--iterationCount_;
 	}
 
-	// TODO: maybe cache current size for performance?
-
 	// Upper approximation of the current size.
 	// May be larger than the actual size.
 	std::size_t size() const {
-		return std::distance(subs_.begin(), subs_.end());
+		return subs_.size() > removed_ ? subs_.size() - removed_ : 0u;
 	}
 
-	std::forward_list<Subscription> subs_ {}; // all registered subscriptions
-	typename decltype(subs_)::iterator last_ {}; // the last entry in subs
+	// all registered subscriptions, in registration order
+	detail::ChunkedVector<Subscription> subs_;
+	std::size_t removed_ {}; // number of removed subs that are still in subs_
 	unsigned int iterationCount_ {}; // the number of active iterations (in call)
 	std::int64_t subID_ {}; // the highest subscription id given
 	std::int64_t callID_ {}; // the highest call id given (see the call function)
 };
 
 // - implementation -
-template<typename Ret, typename... Args, typename ID>
-RecursiveCallback<Ret(Args...), ID>::~RecursiveCallback()
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+RecursiveCallback<Ret(Args...), ID, Function>::~RecursiveCallback()
 {
 	// Output warnings in bad cases.
 	// The following can only happen if e.g. deleted from within a
@@ -215,9 +407,10 @@ RecursiveCallback<Ret(Args...), ID>::~RecursiveCallback()
 	}
 }
 
-template<typename Ret, typename... Args, typename ID>
-ConnectionT<ConnectableT<ID>, ID> RecursiveCallback<Ret(Args...), ID>::
-add(std::function<Ret(Args...)> func) {
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+ConnectionT<ConnectableT<ID>, ID> RecursiveCallback<Ret(Args...), ID, Function>::
+add(FunctionType func) {
 	if(!func) {
 		throw std::invalid_argument("nytl::Callback::add: empty function");
 	}
@@ -227,78 +420,106 @@ add(std::function<Ret(Args...)> func) {
 	return {*this, sub.id};
 }
 
-template<typename Ret, typename... Args, typename ID>
-ConnectionT<ConnectableT<ID>, ID> RecursiveCallback<Ret(Args...), ID>::
-add(std::function<Ret(Connection, Args...)> func)
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+template<typename F, typename>
+ConnectionT<ConnectableT<ID>, ID> RecursiveCallback<Ret(Args...), ID, Function>::
+add(F&& func)
 {
-	if(!func) {
-		throw std::invalid_argument("nytl::Callback::add: empty function");
+	using D = std::decay_t<F>;
+	if constexpr(std::is_constructible_v<bool, const D&>) {
+		if(!static_cast<bool>(func)) {
+			throw std::invalid_argument("nytl::Callback::add: empty function");
+		}
 	}
 
 	auto& sub = emplace();
 	Connection conn {*this, sub.id};
-	sub.func = [conn, f = std::move(func)](Args... args) {
+	sub.func = [conn, f = D(std::forward<F>(func))](Args... args) mutable {
 		return f(conn, std::forward<Args>(args)...);
 	};
 
 	return conn;
 }
 
-template<typename Ret, typename... Args, typename ID>
-auto RecursiveCallback<Ret(Args...), ID>::call(Args... a)
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+auto RecursiveCallback<Ret(Args...), ID, Function>::call(Args... a)
+{
+	if constexpr(std::is_same<Ret, void>::value) {
+		iterate([&](Subscription& sub) {
+			sub.func(std::forward<Args>(a)...);
+			return true;
+		});
+	} else { // the same with a return vector
+		std::vector<Ret> ret;
+		ret.reserve(size());
+		iterate([&](Subscription& sub) {
+			ret.push_back(sub.func(std::forward<Args>(a)...));
+			return true;
+		});
+
+		return ret;
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+template<typename C>
+C RecursiveCallback<Ret(Args...), ID, Function>::collect(C collector, Args... a)
+{
+	static_assert(!std::is_void_v<Ret>, "nytl::RecursiveCallback::collect: void callback");
+	iterate([&](Subscription& sub) {
+		return detail::collect(collector, sub.func(std::forward<Args>(a)...));
+	});
+
+	return collector;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+template<typename F>
+void RecursiveCallback<Ret(Args...), ID, Function>::iterate(F&& f)
 {
 	// wrap callID_ if needed. This is usually not critical (except when
 	// there are 2^32 nested calls...)
 	callID_ = (callID_ == std::numeric_limits<std::int64_t>::max()) ? 1 : callID_ + 1;
 	std::int64_t callid = callID_; // the actual calling id (to include newly removed)
-	auto last = last_; // store it (to not iterate over newly added subs)
+	// we will not call functions that were registered after
+	// this call started
+	auto end = subs_.size();
 
-	// make sure the no list iterators are invalidated while iterating
+	// make sure the no subscriptions are erased or moved while iterating
 	++iterationCount_;
 
 	// make sure the iteration count and cleanup done if possible
 	// even in the case of an exception.
+	// Whether we encountered removed subscriptions, they might have been
+	// removed from the outside by the id.
+	bool removed = false;
 	auto successGuard = ScopeGuard([&]{
-		if(--iterationCount_ == 0) {
+		if(--iterationCount_ == 0 && (removed || removed_)) {
 			removeOld();
 		}
 	});
 
-	if constexpr(std::is_same<Ret, void>::value) {
-		for(auto it = subs_.begin(); it != subs_.end(); ++it) {
-			// if the first check if fasel, -it->id.get() represents the
-			// callID during which it was removed. If this is >= than
-			// the stored callID, it was removed during or after this
-			// call and therefore we still call it
-			if(it->id.get() > 0 || -it->id.get() >= callid) {
-				it->func(std::forward<Args>(a)...);
-				// we will not call functions that were registered after
-				// this call started (this is why we store last above)
-				if(it == last) {
-					break;
-				}
-			}
-		}
-
-	} else { // the same with a return vector
-		std::vector<Ret> ret;
-		ret.reserve(size());
-
-		for(auto it = subs_.begin(); it != subs_.end(); ++it) {
-			if(it->id.get() > 0 || -it->id.get() >= callid) {
-				ret.push_back(it->func(std::forward<Args>(a)...));
-				if(it == last) {
-					break;
-				}
+	// if id is not positive, -id represents the callID during
+	// which it was removed. If this is >= than the stored callID,
+	// it was removed during or after this call and therefore we still call it.
+	// Adding subscriptions does not invalidate the iterators.
+	for(auto it = subs_.begin(); it.index() < end; ++it) {
+		auto id = it->id.get();
+		if(id > 0 || ((removed = true) && -id >= callid)) {
+			if(!f(*it)) {
+				break;
 			}
 		}
-
-		return ret;
 	}
 }
 
-template<typename Ret, typename... Args, typename ID>
-void RecursiveCallback<Ret(Args...), ID>::clear() noexcept
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void RecursiveCallback<Ret(Args...), ID, Function>::clear() noexcept
 {
 	bool remove = iterationCount_ == 0;
 
@@ -306,68 +527,66 @@ void RecursiveCallback<Ret(Args...), ID>::clear() noexcept
 	for(auto& sub : subs_) {
 		if(remove) {
 			sub.id.removed();
-		} else {
+		} else if(sub.id.get() > 0) {
 			sub.id.set(-callID_);
+			++removed_;
 		}
 	}
 
 	// clear/remove only if no one is currently iterating
-	// we only reset end_ (not really needed, cleanup for easier debugging)
 	if(remove) {
 		subs_.clear();
-		last_ = subs_.end();
+		removed_ = 0u;
 	}
 }
 
-// TODO: noexcept?
-template<typename Ret, typename... Args, typename ID>
-bool RecursiveCallback<Ret(Args...), ID>::disconnect(const ID& id) noexcept
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+bool RecursiveCallback<Ret(Args...), ID, Function>::disconnect(const ID& id) noexcept
 {
-	if(subs_.empty())  {
+	if(id.get() <= 0) {
 		return false;
 	}
 
-	auto remove = (iterationCount_ == 0);
-
-	// check for first one
-	if(subs_.begin()->id.get() == id.get()) {
-		if(remove) {
-			subs_.begin()->id.removed();
-			subs_.pop_front();
-			if(subs_.empty()) {
-				last_ = subs_.end();
-			}
+	// subscriptions are ordered by key (unless subID_ wrapped)
+	auto key = id.get();
+	std::size_t first = 0u, last = subs_.size();
+	while(first < last) {
+		auto mid = first + (last - first) / 2;
+		if(subs_[mid].key < key) {
+			first = mid + 1;
 		} else {
-			subs_.begin()->id.set(-callID_);
+			last = mid;
 		}
+	}
 
-		return true;
+	if(first == subs_.size()) {
+		return false;
 	}
 
-	// iterate through subs, always check the next elem (fwd linked list)
-	// the end condition constructs a copy of it and increases it to check
-	for(auto it = subs_.begin(); true; ++it) {
-		auto next = it;
-		if(++next == subs_.end())
-			break;
-
-		if(next->id.get() == id.get()) {
-			if(remove) {
-				// set this before id.removed might change stuff
-				if(++next == subs_.end()) {
-					last_ = it;
-				}
-				next->id.removed();
-				subs_.erase_after(it);
-			} else {
-				next->id.set(-callID_);
-			}
+	auto& sub = subs_[first];
+	if(sub.key != key || sub.id.get() != key) {
+		return false;
+	}
 
-			return true;
+	// We always just mark the subscription as removed. Removal from
+	// the store is done in removeOld, either after the last active
+	// iteration or when enough subscriptions were removed.
+	sub.id.set(-callID_);
+	++removed_;
+	if(iterationCount_ == 0) {
+		// Notify the id and destroy the function already, can't be called
+		// anymore. Calling removed() again from removeOld is harmless.
+		// Destroying might recursively disconnect, so move it out first.
+		sub.id.removed();
+		auto func = std::move(sub.func);
+		sub.func = FunctionType {};
+		if(removed_ > subs_.size() / 2) {
+			removeOld();
 		}
 	}
 
-	return false;
+	return true;
 }
 
 } // namespace nytl
@@ -0,0 +1,1152 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Configuration and small building blocks for the optional SIMD code paths.
+/// SIMD code paths are opt-in: define NYTL_SIMD (preferably project-wide, e.g.
+/// via -DNYTL_SIMD) to enable them. The instruction sets used are the
+/// ones the compiler targets (e.g. -msse4.1, -mavx2 -mfma, -mavx512f or
+/// -march=native), this header does not do any runtime dispatching since
+/// all code using it is inlined into the including translation unit anyways.
+/// Functions using these paths still work in constant expressions, the SIMD
+/// paths are only taken at runtime. Note that results may differ in the
+/// last bits from the scalar paths since e.g. sums are computed in
+/// a different order.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_SIMD
+#define NYTL_INCLUDE_SIMD
+
+#include <type_traits> // std::is_same_v
+#include <cstddef> // std::size_t
+#include <cmath> // std::sqrt
+#include <algorithm> // std::clamp
+
+// We need a way to detect constant evaluation in C++17, otherwise
+// SIMD paths can't be used from constexpr functions.
+#if defined(NYTL_SIMD) && defined(__has_builtin)
+	#if __has_builtin(__builtin_is_constant_evaluated)
+		#define NYTL_SIMD_CONSTEVAL
+	#endif
+#endif
+
+#if defined(NYTL_SIMD) && !defined(NYTL_SIMD_CONSTEVAL) && \
+		defined(__GNUC__) && !defined(__clang__)
+	#if __GNUC__ >= 9
+		#define NYTL_SIMD_CONSTEVAL
+	#endif
+#endif
+
+#ifdef NYTL_SIMD_CONSTEVAL
+	#if defined(__SSE2__) || defined(_M_X64)
+		#define NYTL_SIMD_SSE2
+		#include <emmintrin.h>
+	#endif
+
+	#if defined(__SSE3__)
+		#define NYTL_SIMD_SSE3
+		#include <pmmintrin.h>
+	#endif
+
+	#if defined(__SSSE3__)
+		#define NYTL_SIMD_SSSE3
+		#include <tmmintrin.h>
+	#endif
+
+	#if defined(__AVX__)
+		#define NYTL_SIMD_AVX
+		#include <immintrin.h>
+	#endif
+
+	#if defined(__AVX2__)
+		#define NYTL_SIMD_AVX2
+	#endif
+
+	#if defined(__AVX512F__)
+		#define NYTL_SIMD_AVX512
+	#endif
+
+	#if defined(__FMA__)
+		#define NYTL_SIMD_FMA
+	#endif
+
+	#if defined(__ARM_NEON) && defined(__aarch64__)
+		#define NYTL_SIMD_NEON
+		#include <arm_neon.h>
+	#endif
+
+	#if defined(NYTL_SIMD_SSE2) || defined(NYTL_SIMD_NEON)
+		#define NYTL_SIMD_ANY
+	#endif
+#endif
+
+namespace nytl::detail {
+
+/// Returns whether the current evaluation happens in a constant expression.
+/// Always returns true when SIMD paths are disabled, i.e. all
+/// SIMD paths guarded with this are never taken.
+constexpr bool constantEvaluated() noexcept {
+#ifdef NYTL_SIMD_CONSTEVAL
+	return __builtin_is_constant_evaluated();
+#else
+	return true;
+#endif
+}
+
+namespace simd {
+
+// Small wrappers around the instruction set specific 4-lane float (F4)
+// and double (D4) registers. Only provides the operations needed by
+// the nytl headers.
+
+#if defined(NYTL_SIMD_SSE2)
+	constexpr auto hasF4 = true;
+	using F4 = __m128;
+
+	inline F4 load(const float* ptr) { return _mm_loadu_ps(ptr); }
+	inline void store(float* ptr, F4 v) { _mm_storeu_ps(ptr, v); }
+	inline F4 splat(float v) { return _mm_set1_ps(v); }
+	inline F4 add(F4 a, F4 b) { return _mm_add_ps(a, b); }
+	inline F4 sub(F4 a, F4 b) { return _mm_sub_ps(a, b); }
+	inline F4 mul(F4 a, F4 b) { return _mm_mul_ps(a, b); }
+	inline F4 div(F4 a, F4 b) { return _mm_div_ps(a, b); }
+	inline F4 sqrt(F4 a) { return _mm_sqrt_ps(a); }
+
+	// Same semantics as `(a > b) ? a : b`, `(a < b) ? a : b` per lane.
+	inline F4 max(F4 a, F4 b) { return _mm_max_ps(a, b); }
+	inline F4 min(F4 a, F4 b) { return _mm_min_ps(a, b); }
+
+	// Returns a * b + c, fused if supported.
+	inline F4 fmadd(F4 a, F4 b, F4 c) {
+	#ifdef NYTL_SIMD_FMA
+		return _mm_fmadd_ps(a, b, c);
+	#else
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+	#endif
+	}
+
+	// Returns copysign(1, a) per lane.
+	inline F4 sign1(F4 a) { return _mm_or_ps(_mm_and_ps(_mm_set1_ps(-0.f), a), _mm_set1_ps(1.f)); }
+
+	// Returns the sum of all lanes.
+	inline float hsum(F4 v) {
+		auto shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+		auto sums = _mm_add_ps(v, shuf);
+		shuf = _mm_movehl_ps(shuf, sums);
+		return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+	}
+
+	// Transposes the 4x4 matrix with the given rows in place.
+	inline void transpose(F4& r0, F4& r1, F4& r2, F4& r3) {
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	}
+#elif defined(NYTL_SIMD_NEON)
+	constexpr auto hasF4 = true;
+	using F4 = float32x4_t;
+
+	inline F4 load(const float* ptr) { return vld1q_f32(ptr); }
+	inline void store(float* ptr, F4 v) { vst1q_f32(ptr, v); }
+	inline F4 splat(float v) { return vdupq_n_f32(v); }
+	inline F4 add(F4 a, F4 b) { return vaddq_f32(a, b); }
+	inline F4 sub(F4 a, F4 b) { return vsubq_f32(a, b); }
+	inline F4 mul(F4 a, F4 b) { return vmulq_f32(a, b); }
+	inline F4 div(F4 a, F4 b) { return vdivq_f32(a, b); }
+	inline F4 sqrt(F4 a) { return vsqrtq_f32(a); }
+	inline F4 max(F4 a, F4 b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+	inline F4 min(F4 a, F4 b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+	inline F4 fmadd(F4 a, F4 b, F4 c) { return vfmaq_f32(c, a, b); }
+	inline float hsum(F4 v) { return vaddvq_f32(v); }
+	inline F4 sign1(F4 a) { return vbslq_f32(vdupq_n_u32(0x80000000u), a, vdupq_n_f32(1.f)); }
+
+	inline void transpose(F4& r0, F4& r1, F4& r2, F4& r3) {
+		auto t01 = vtrnq_f32(r0, r1);
+		auto t23 = vtrnq_f32(r2, r3);
+		r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+		r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+		r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+		r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+	}
+#else
+	constexpr auto hasF4 = false;
+#endif
+
+#if defined(NYTL_SIMD_AVX)
+	constexpr auto hasD4 = true;
+	using D4 = __m256d;
+
+	inline D4 load(const double* ptr) { return _mm256_loadu_pd(ptr); }
+	inline void store(double* ptr, D4 v) { _mm256_storeu_pd(ptr, v); }
+	inline D4 splat(double v) { return _mm256_set1_pd(v); }
+	inline D4 add(D4 a, D4 b) { return _mm256_add_pd(a, b); }
+	inline D4 sub(D4 a, D4 b) { return _mm256_sub_pd(a, b); }
+	inline D4 mul(D4 a, D4 b) { return _mm256_mul_pd(a, b); }
+	inline D4 div(D4 a, D4 b) { return _mm256_div_pd(a, b); }
+	inline D4 sqrt(D4 a) { return _mm256_sqrt_pd(a); }
+	inline D4 max(D4 a, D4 b) { return _mm256_max_pd(a, b); }
+	inline D4 min(D4 a, D4 b) { return _mm256_min_pd(a, b); }
+
+	inline D4 fmadd(D4 a, D4 b, D4 c) {
+	#ifdef NYTL_SIMD_FMA
+		return _mm256_fmadd_pd(a, b, c);
+	#else
+		return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+	#endif
+	}
+
+	inline D4 sign1(D4 a) {
+		return _mm256_or_pd(_mm256_and_pd(_mm256_set1_pd(-0.0), a), _mm256_set1_pd(1.0));
+	}
+
+	inline double hsum(D4 v) {
+		auto sums = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+		return _mm_cvtsd_f64(_mm_add_sd(sums, _mm_unpackhi_pd(sums, sums)));
+	}
+
+	inline void transpose(D4& r0, D4& r1, D4& r2, D4& r3) {
+		auto t0 = _mm256_unpacklo_pd(r0, r1);
+		auto t1 = _mm256_unpackhi_pd(r0, r1);
+		auto t2 = _mm256_unpacklo_pd(r2, r3);
+		auto t3 = _mm256_unpackhi_pd(r2, r3);
+		r0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+		r1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+		r2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+		r3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+	}
+#elif defined(NYTL_SIMD_SSE2) || defined(NYTL_SIMD_NEON)
+	// Emulated with two 2-lane registers.
+	constexpr auto hasD4 = true;
+
+	#ifdef NYTL_SIMD_SSE2
+		using D2 = __m128d;
+		inline D2 load2(const double* ptr) { return _mm_loadu_pd(ptr); }
+		inline void store2(double* ptr, D2 v) { _mm_storeu_pd(ptr, v); }
+		inline D2 splat2(double v) { return _mm_set1_pd(v); }
+		inline D2 add(D2 a, D2 b) { return _mm_add_pd(a, b); }
+		inline D2 sub(D2 a, D2 b) { return _mm_sub_pd(a, b); }
+		inline D2 mul(D2 a, D2 b) { return _mm_mul_pd(a, b); }
+		inline D2 div(D2 a, D2 b) { return _mm_div_pd(a, b); }
+		inline D2 sqrt(D2 a) { return _mm_sqrt_pd(a); }
+		inline D2 max(D2 a, D2 b) { return _mm_max_pd(a, b); }
+		inline D2 min(D2 a, D2 b) { return _mm_min_pd(a, b); }
+		inline double hsum(D2 v) {
+			return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+		}
+		inline D2 sign1(D2 a) { return _mm_or_pd(_mm_and_pd(_mm_set1_pd(-0.0), a), _mm_set1_pd(1.0)); }
+
+		// {a[0], b[0]} and {a[1], b[1]}
+		inline D2 unpacklo(D2 a, D2 b) { return _mm_unpacklo_pd(a, b); }
+		inline D2 unpackhi(D2 a, D2 b) { return _mm_unpackhi_pd(a, b); }
+	#else
+		using D2 = float64x2_t;
+		inline D2 load2(const double* ptr) { return vld1q_f64(ptr); }
+		inline void store2(double* ptr, D2 v) { vst1q_f64(ptr, v); }
+		inline D2 splat2(double v) { return vdupq_n_f64(v); }
+		inline D2 add(D2 a, D2 b) { return vaddq_f64(a, b); }
+		inline D2 sub(D2 a, D2 b) { return vsubq_f64(a, b); }
+		inline D2 mul(D2 a, D2 b) { return vmulq_f64(a, b); }
+		inline D2 div(D2 a, D2 b) { return vdivq_f64(a, b); }
+		inline D2 sqrt(D2 a) { return vsqrtq_f64(a); }
+		inline D2 max(D2 a, D2 b) { return vbslq_f64(vcgtq_f64(a, b), a, b); }
+		inline D2 min(D2 a, D2 b) { return vbslq_f64(vcltq_f64(a, b), a, b); }
+		inline double hsum(D2 v) { return vaddvq_f64(v); }
+		inline D2 sign1(D2 a) {
+			return vbslq_f64(vdupq_n_u64(0x8000000000000000ull), a, vdupq_n_f64(1.0));
+		}
+		inline D2 unpacklo(D2 a, D2 b) { return vzip1q_f64(a, b); }
+		inline D2 unpackhi(D2 a, D2 b) { return vzip2q_f64(a, b); }
+	#endif
+
+	struct D4 { D2 lo, hi; };
+
+	inline D4 load(const double* ptr) { return {load2(ptr), load2(ptr + 2)}; }
+	inline void store(double* ptr, D4 v) { store2(ptr, v.lo); store2(ptr + 2, v.hi); }
+	inline D4 splat(double v) { return {splat2(v), splat2(v)}; }
+	inline D4 add(D4 a, D4 b) { return {add(a.lo, b.lo), add(a.hi, b.hi)}; }
+	inline D4 sub(D4 a, D4 b) { return {sub(a.lo, b.lo), sub(a.hi, b.hi)}; }
+	inline D4 mul(D4 a, D4 b) { return {mul(a.lo, b.lo), mul(a.hi, b.hi)}; }
+	inline D4 div(D4 a, D4 b) { return {div(a.lo, b.lo), div(a.hi, b.hi)}; }
+	inline D4 sqrt(D4 a) { return {sqrt(a.lo), sqrt(a.hi)}; }
+	inline D4 max(D4 a, D4 b) { return {max(a.lo, b.lo), max(a.hi, b.hi)}; }
+	inline D4 min(D4 a, D4 b) { return {min(a.lo, b.lo), min(a.hi, b.hi)}; }
+	inline D4 fmadd(D4 a, D4 b, D4 c) { return add(mul(a, b), c); }
+	inline double hsum(D4 v) { return hsum(add(v.lo, v.hi)); }
+	inline D4 sign1(D4 a) { return {sign1(a.lo), sign1(a.hi)}; }
+
+	inline void transpose(D4& r0, D4& r1, D4& r2, D4& r3) {
+		D4 t0 = {unpacklo(r0.lo, r1.lo), unpacklo(r2.lo, r3.lo)};
+		D4 t1 = {unpackhi(r0.lo, r1.lo), unpackhi(r2.lo, r3.lo)};
+		D4 t2 = {unpacklo(r0.hi, r1.hi), unpacklo(r2.hi, r3.hi)};
+		D4 t3 = {unpackhi(r0.hi, r1.hi), unpackhi(r2.hi, r3.hi)};
+		r0 = t0;
+		r1 = t1;
+		r2 = t2;
+		r3 = t3;
+	}
+#else
+	constexpr auto hasD4 = false;
+#endif
+
+/// Whether there is a 4-lane SIMD register type for T.
+template<typename T> constexpr bool has4 =
+	(std::is_same_v<T, float> && hasF4) ||
+	(std::is_same_v<T, double> && hasD4);
+
+/// Whether operations on Vec<D, T> (with all other operands being of the
+/// same type) should use the SIMD path.
+template<std::size_t D, typename T, typename... O> constexpr bool vec4 =
+	D == 4 && has4<T> && (std::is_same_v<T, O> && ...);
+
+// Widest available registers for float (FW, holding widthF lanes) and
+// double (DW, holding widthD lanes). Used by the kernels on many values
+// below, which therefore automatically use AVX-512 or AVX when enabled.
+#if defined(NYTL_SIMD_AVX512)
+	// The zero-masked versions are used where the unmasked intrinsics
+	// trigger false -Wmaybe-uninitialized warnings with some gcc versions.
+	using FW = __m512;
+	using DW = __m512d;
+	constexpr std::size_t widthF = 16;
+	constexpr std::size_t widthD = 8;
+
+	inline FW loadw(const float* ptr) { return _mm512_loadu_ps(ptr); }
+	inline void storew(float* ptr, FW v) { _mm512_storeu_ps(ptr, v); }
+	inline FW splatw(float v) { return _mm512_set1_ps(v); }
+	inline FW add(FW a, FW b) { return _mm512_add_ps(a, b); }
+	inline FW sub(FW a, FW b) { return _mm512_sub_ps(a, b); }
+	inline FW mul(FW a, FW b) { return _mm512_mul_ps(a, b); }
+	inline FW div(FW a, FW b) { return _mm512_div_ps(a, b); }
+	inline FW sqrt(FW a) { return _mm512_maskz_sqrt_ps(0xFFFF, a); }
+	inline FW max(FW a, FW b) { return _mm512_maskz_max_ps(0xFFFF, a, b); }
+	inline FW min(FW a, FW b) { return _mm512_maskz_min_ps(0xFFFF, a, b); }
+	inline FW abs(FW a) { return _mm512_abs_ps(a); }
+
+	inline DW loadw(const double* ptr) { return _mm512_loadu_pd(ptr); }
+	inline void storew(double* ptr, DW v) { _mm512_storeu_pd(ptr, v); }
+	inline DW splatw(double v) { return _mm512_set1_pd(v); }
+	inline DW add(DW a, DW b) { return _mm512_add_pd(a, b); }
+	inline DW sub(DW a, DW b) { return _mm512_sub_pd(a, b); }
+	inline DW mul(DW a, DW b) { return _mm512_mul_pd(a, b); }
+	inline DW div(DW a, DW b) { return _mm512_div_pd(a, b); }
+	inline DW sqrt(DW a) { return _mm512_maskz_sqrt_pd(0xFF, a); }
+	inline DW max(DW a, DW b) { return _mm512_maskz_max_pd(0xFF, a, b); }
+	inline DW min(DW a, DW b) { return _mm512_maskz_min_pd(0xFF, a, b); }
+	inline DW abs(DW a) { return _mm512_abs_pd(a); }
+#elif defined(NYTL_SIMD_AVX)
+	using FW = __m256;
+	using DW = D4;
+	constexpr std::size_t widthF = 8;
+	constexpr std::size_t widthD = 4;
+
+	inline FW loadw(const float* ptr) { return _mm256_loadu_ps(ptr); }
+	inline void storew(float* ptr, FW v) { _mm256_storeu_ps(ptr, v); }
+	inline FW splatw(float v) { return _mm256_set1_ps(v); }
+	inline FW add(FW a, FW b) { return _mm256_add_ps(a, b); }
+	inline FW sub(FW a, FW b) { return _mm256_sub_ps(a, b); }
+	inline FW mul(FW a, FW b) { return _mm256_mul_ps(a, b); }
+	inline FW div(FW a, FW b) { return _mm256_div_ps(a, b); }
+	inline FW sqrt(FW a) { return _mm256_sqrt_ps(a); }
+	inline FW max(FW a, FW b) { return _mm256_max_ps(a, b); }
+	inline FW min(FW a, FW b) { return _mm256_min_ps(a, b); }
+	inline FW abs(FW a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+
+	inline DW loadw(const double* ptr) { return load(ptr); }
+	inline void storew(double* ptr, DW v) { store(ptr, v); }
+	inline DW splatw(double v) { return splat(v); }
+	inline DW abs(DW a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+#elif defined(NYTL_SIMD_ANY)
+	using FW = F4;
+	using DW = D2;
+	constexpr std::size_t widthF = 4;
+	constexpr std::size_t widthD = 2;
+
+	inline FW loadw(const float* ptr) { return load(ptr); }
+	inline void storew(float* ptr, FW v) { store(ptr, v); }
+	inline FW splatw(float v) { return splat(v); }
+	inline DW loadw(const double* ptr) { return load2(ptr); }
+	inline void storew(double* ptr, DW v) { store2(ptr, v); }
+	inline DW splatw(double v) { return splat2(v); }
+
+	#ifdef NYTL_SIMD_SSE2
+		inline FW abs(FW a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+		inline DW abs(DW a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+	#else
+		inline FW abs(FW a) { return vabsq_f32(a); }
+		inline DW abs(DW a) { return vabsq_f64(a); }
+	#endif
+#endif
+
+#ifdef NYTL_SIMD_ANY
+	/// The number of lanes in the widest register for T.
+	template<typename T> constexpr std::size_t width =
+		std::is_same_v<T, float> ? widthF : widthD;
+#endif
+
+// Kernels on 4 contiguous values, T is float or double.
+// They are always declared but may only be called when has4<T> is true.
+// Semantics match the scalar implementations in vec.hpp and vecOps.hpp.
+#ifdef NYTL_SIMD_ANY
+	#define NYTL_SIMD_KERNEL(body) body
+#else
+	#define NYTL_SIMD_KERNEL(body)
+#endif
+
+template<typename T>
+void add4(T* a, const T* b) {
+	NYTL_SIMD_KERNEL(store(a, add(load(a), load(b)));)
+}
+
+template<typename T>
+void sub4(T* a, const T* b) {
+	NYTL_SIMD_KERNEL(store(a, sub(load(a), load(b)));)
+}
+
+template<typename T>
+void scale4(T* a, T fac) {
+	NYTL_SIMD_KERNEL(store(a, mul(load(a), splat(fac)));)
+}
+
+template<typename T>
+T dot4(const T* a, const T* b) {
+	NYTL_SIMD_KERNEL(return hsum(mul(load(a), load(b)));)
+	return {};
+}
+
+// a = (b > a) ? b : a
+template<typename T>
+void max4(T* a, const T* b) {
+	NYTL_SIMD_KERNEL(store(a, max(load(b), load(a)));)
+}
+
+// a = (b < a) ? b : a
+template<typename T>
+void min4(T* a, const T* b) {
+	NYTL_SIMD_KERNEL(store(a, min(load(b), load(a)));)
+}
+
+// a = std::clamp(a, low, high)
+template<typename T>
+void clamp4(T* a, const T* low, const T* high) {
+	NYTL_SIMD_KERNEL(store(a, min(load(high), max(load(low), load(a))));)
+}
+
+template<typename T>
+void clamp4(T* a, T low, T high) {
+	NYTL_SIMD_KERNEL(store(a, min(splat(high), max(splat(low), load(a))));)
+}
+
+// out = a * b for row-major 4x4 matrices (16 contiguous values each).
+// Row r of the result is computed as sum(a[r][i] * b[i]), i.e. by
+// broadcasting the values of a. Uses fused multiply-add when available.
+// out may alias a or b.
+template<typename T>
+void mulMat4(T* out, const T* a, const T* b) {
+	NYTL_SIMD_KERNEL(
+		auto b0 = load(b);
+		auto b1 = load(b + 4);
+		auto b2 = load(b + 8);
+		auto b3 = load(b + 12);
+
+		decltype(b0) rows[4];
+		for(auto r = 0u; r < 4; ++r) {
+			auto acc = mul(splat(a[4 * r]), b0);
+			acc = fmadd(splat(a[4 * r + 1]), b1, acc);
+			acc = fmadd(splat(a[4 * r + 2]), b2, acc);
+			rows[r] = fmadd(splat(a[4 * r + 3]), b3, acc);
+		}
+
+		for(auto r = 0u; r < 4; ++r) {
+			store(out + 4 * r, rows[r]);
+		})
+}
+
+// out = m * v for a row-major 4x4 matrix m.
+// Computes all four row dot products at once by transposing the
+// products, the sums are evaluated in the same order as the scalar dot.
+// out may alias v.
+template<typename T>
+void mulMat4Vec4(T* out, const T* m, const T* v) {
+	NYTL_SIMD_KERNEL(
+		auto vv = load(v);
+		auto r0 = mul(load(m), vv);
+		auto r1 = mul(load(m + 4), vv);
+		auto r2 = mul(load(m + 8), vv);
+		auto r3 = mul(load(m + 12), vv);
+		transpose(r0, r1, r2, r3);
+		store(out, add(add(add(r0, r1), r2), r3));)
+}
+
+// Transposes the 4x4 block at in into the block at out, the strides are
+// the distances between the rows of the blocks (in values).
+// The block is transposed in registers, so out may alias in (but must not
+// partially overlap it).
+template<typename T>
+void transpose4(T* out, std::size_t outStride, const T* in, std::size_t inStride) {
+	NYTL_SIMD_KERNEL(
+		auto r0 = load(in);
+		auto r1 = load(in + inStride);
+		auto r2 = load(in + 2 * inStride);
+		auto r3 = load(in + 3 * inStride);
+		transpose(r0, r1, r2, r3);
+		store(out, r0);
+		store(out + outStride, r1);
+		store(out + 2 * outStride, r2);
+		store(out + 3 * outStride, r3);)
+}
+
+#undef NYTL_SIMD_KERNEL
+
+// Inverse kernels for row-major 4x4 float matrices, only implemented
+// for SSE since they rely on shuffles. Check hasInverse4 before calling.
+// Undefined if the matrix isn't invertible. out may alias m.
+#ifdef NYTL_SIMD_SSE2
+	constexpr auto hasInverse4 = true;
+
+	// Returns {a[X], a[Y], b[Z], b[W]}
+	template<int X, int Y, int Z, int W>
+	F4 shuffle(F4 a, F4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+
+	template<int X, int Y, int Z, int W>
+	F4 swizzle(F4 a) { return shuffle<X, Y, Z, W>(a, a); }
+
+	// Operations on 2x2 matrices {m00, m01, m10, m11} in one register.
+	// a * b
+	inline F4 mat2Mul(F4 a, F4 b) {
+		return add(mul(a, swizzle<0, 3, 0, 3>(b)),
+			mul(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
+	}
+
+	// adj(a) * b
+	inline F4 mat2AdjMul(F4 a, F4 b) {
+		return sub(mul(swizzle<3, 3, 0, 0>(a), b),
+			mul(swizzle<1, 1, 2, 2>(a), swizzle<2, 3, 0, 1>(b)));
+	}
+
+	// a * adj(b)
+	inline F4 mat2MulAdj(F4 a, F4 b) {
+		return sub(mul(a, swizzle<3, 0, 3, 0>(b)),
+			mul(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
+	}
+
+	// xyz cross product, the w lane is zero for finite values.
+	inline F4 cross3(F4 a, F4 b) {
+		return sub(mul(swizzle<1, 2, 0, 3>(a), swizzle<2, 0, 1, 3>(b)),
+			mul(swizzle<2, 0, 1, 3>(a), swizzle<1, 2, 0, 3>(b)));
+	}
+#else
+	constexpr auto hasInverse4 = false;
+#endif
+
+// General 4x4 inverse using the 2x2 block matrix formulation.
+inline void inverse4(float* out, const float* m) {
+#ifdef NYTL_SIMD_SSE2
+	auto r0 = load(m);
+	auto r1 = load(m + 4);
+	auto r2 = load(m + 8);
+	auto r3 = load(m + 12);
+
+	// sub matrices
+	auto a = _mm_movelh_ps(r0, r1);
+	auto b = _mm_movehl_ps(r1, r0);
+	auto c = _mm_movelh_ps(r2, r3);
+	auto d = _mm_movehl_ps(r3, r2);
+
+	// determinants of the sub matrices {|a|, |b|, |c|, |d|}
+	auto dets = sub(
+		mul(shuffle<0, 2, 0, 2>(r0, r2), shuffle<1, 3, 1, 3>(r1, r3)),
+		mul(shuffle<1, 3, 1, 3>(r0, r2), shuffle<0, 2, 0, 2>(r1, r3)));
+	auto detA = swizzle<0, 0, 0, 0>(dets);
+	auto detB = swizzle<1, 1, 1, 1>(dets);
+	auto detC = swizzle<2, 2, 2, 2>(dets);
+	auto detD = swizzle<3, 3, 3, 3>(dets);
+
+	auto dc = mat2AdjMul(d, c);
+	auto ab = mat2AdjMul(a, b);
+	auto x = sub(mul(detD, a), mat2Mul(b, dc));
+	auto w = sub(mul(detA, d), mat2Mul(c, ab));
+	auto y = sub(mul(detB, c), mat2MulAdj(d, ab));
+	auto z = sub(mul(detC, b), mat2MulAdj(a, dc));
+
+	// |m| = |a||d| + |b||c| - tr(adj(a) b adj(d) c)
+	auto tr = mul(ab, swizzle<0, 2, 1, 3>(dc));
+	tr = add(tr, swizzle<2, 3, 0, 1>(tr));
+	tr = add(tr, swizzle<1, 0, 3, 2>(tr));
+	auto det = sub(add(mul(detA, detD), mul(detB, detC)), tr);
+
+	auto fac = div(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), det);
+	x = mul(x, fac);
+	y = mul(y, fac);
+	z = mul(z, fac);
+	w = mul(w, fac);
+
+	// adjugate of the blocks and store
+	store(out, shuffle<3, 1, 3, 1>(x, y));
+	store(out + 4, shuffle<2, 0, 2, 0>(x, y));
+	store(out + 8, shuffle<3, 1, 3, 1>(z, w));
+	store(out + 12, shuffle<2, 0, 2, 0>(z, w));
+#else
+	(void) out;
+	(void) m;
+#endif
+}
+
+// Inverse of an affine 4x4 matrix, i.e. the last row must be (0, 0, 0, 1).
+// The inverse of the linear part is computed via cross products.
+inline void inverseAffine4(float* out, const float* m) {
+#ifdef NYTL_SIMD_SSE2
+	auto r0 = load(m);
+	auto r1 = load(m + 4);
+	auto r2 = load(m + 8);
+
+	// cofactor rows of the linear part
+	auto c0 = cross3(r1, r2);
+	auto c1 = cross3(r2, r0);
+	auto c2 = cross3(r0, r1);
+
+	auto fac = splat(1.f / hsum(mul(r0, c0)));
+	c0 = mul(c0, fac);
+	c1 = mul(c1, fac);
+	c2 = mul(c2, fac);
+
+	// translation column as vector, then -inv(linear) * translation
+	auto t = _mm_setzero_ps();
+	auto t0 = r0;
+	auto t1 = r1;
+	auto t2 = r2;
+	transpose(t0, t1, t2, t);
+	t = mul(splat(-1.f), add(add(
+		mul(c0, swizzle<0, 0, 0, 0>(t)),
+		mul(c1, swizzle<1, 1, 1, 1>(t))),
+		mul(c2, swizzle<2, 2, 2, 2>(t))));
+
+	// the inverse of the linear part is the transposed cofactor matrix
+	transpose(c0, c1, c2, t);
+	store(out, c0);
+	store(out + 4, c1);
+	store(out + 8, c2);
+	store(out + 12, _mm_setr_ps(0.f, 0.f, 0.f, 1.f));
+#else
+	(void) out;
+	(void) m;
+#endif
+}
+
+// Kernels for float quaternions stored as {x, y, z, w}. They have the
+// same requirements as the inverse kernels, check hasQuat4 before calling.
+constexpr auto hasQuat4 = hasInverse4;
+
+// Hamilton product a * b, as sum of the b components multiplied with
+// a.w, a.x, a.y and a.z in the same order as the scalar implementation.
+// out may alias a or b.
+inline void quatMul(float* out, const float* a, const float* b) {
+#ifdef NYTL_SIMD_SSE2
+	auto qa = load(a);
+	auto qb = load(b);
+	auto r = mul(swizzle<3, 3, 3, 3>(qa), qb);
+	r = add(r, mul(swizzle<0, 0, 0, 0>(qa),
+		mul(swizzle<3, 2, 1, 0>(qb), _mm_setr_ps(1.f, -1.f, 1.f, -1.f))));
+	r = add(r, mul(swizzle<1, 1, 1, 1>(qa),
+		mul(swizzle<2, 3, 0, 1>(qb), _mm_setr_ps(1.f, 1.f, -1.f, -1.f))));
+	r = add(r, mul(swizzle<2, 2, 2, 2>(qa),
+		mul(swizzle<1, 0, 3, 2>(qb), _mm_setr_ps(-1.f, 1.f, 1.f, -1.f))));
+	store(out, r);
+#else
+	(void) out;
+	(void) a;
+	(void) b;
+#endif
+}
+
+// Rotates the 3 values at v by the quaternion q, writes them to out.
+// out may alias v.
+inline void quatApply(float* out, const float* q, const float* v) {
+#ifdef NYTL_SIMD_SSE2
+	auto qv = load(q);
+	auto u = _mm_and_ps(qv, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)));
+	auto vv = _mm_setr_ps(v[0], v[1], v[2], 0.f);
+	auto w = swizzle<3, 3, 3, 3>(qv);
+	auto two = splat(2.f);
+
+	auto r = mul(mul(two, splat(hsum(mul(u, vv)))), u);
+	r = add(r, mul(sub(mul(w, w), splat(hsum(mul(u, u)))), vv));
+	r = add(r, mul(mul(two, w), cross3(u, vv)));
+
+	alignas(16) float res[4];
+	_mm_store_ps(res, r);
+	out[0] = res[0];
+	out[1] = res[1];
+	out[2] = res[2];
+#else
+	(void) out;
+	(void) q;
+	(void) v;
+#endif
+}
+
+// Writes q / |q| to out and returns true, or returns false
+// without writing anything if |q| is zero. out may alias q.
+inline bool quatNormalize(float* out, const float* q) {
+#ifdef NYTL_SIMD_SSE2
+	auto qv = load(q);
+	auto l = std::sqrt(hsum(mul(qv, qv)));
+	if(l <= 0.f) {
+		return false;
+	}
+
+	store(out, div(qv, splat(l)));
+	return true;
+#else
+	(void) out;
+	(void) q;
+	return false;
+#endif
+}
+
+// Kernels on n contiguous values.
+// Valid for all arithmetic T, only use SIMD for blocks of width<T>
+// values when possible and handle the rest in a scalar loop.
+#ifdef NYTL_SIMD_ANY
+	#define NYTL_SIMD_LOOP(n, i, body) \
+		if constexpr(has4<T>) { \
+			for(; i + width<T> <= n; i += width<T>) { \
+				body \
+			} \
+		}
+#else
+	#define NYTL_SIMD_LOOP(n, i, body)
+#endif
+
+// a[i] += b[i]
+template<typename T>
+void addN(T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, add(loadw(a + i), loadw(b + i)));)
+	for(; i < n; ++i) a[i] += b[i];
+}
+
+// a[i] -= b[i]
+template<typename T>
+void subN(T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, sub(loadw(a + i), loadw(b + i)));)
+	for(; i < n; ++i) a[i] -= b[i];
+}
+
+// a[i] *= b[i]
+template<typename T>
+void mulN(T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, mul(loadw(a + i), loadw(b + i)));)
+	for(; i < n; ++i) a[i] *= b[i];
+}
+
+// a[i] *= fac
+template<typename T>
+void scaleN(T* a, T fac, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, mul(loadw(a + i), splatw(fac)));)
+	for(; i < n; ++i) a[i] *= fac;
+}
+
+// acc[i] += a[i] * b[i]
+// Not fused, to match the scalar results.
+template<typename T>
+void mulAddN(T* acc, const T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(acc + i, add(loadw(acc + i), mul(loadw(a + i), loadw(b + i))));)
+	for(; i < n; ++i) acc[i] += a[i] * b[i];
+}
+
+// a[i] = std::sqrt(a[i])
+template<typename T>
+void sqrtN(T* a, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, sqrt(loadw(a + i)));)
+	for(; i < n; ++i) a[i] = std::sqrt(a[i]);
+}
+
+// a[i] = num / a[i]
+template<typename T>
+void invN(T* a, T num, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, div(splatw(num), loadw(a + i)));)
+	for(; i < n; ++i) a[i] = num / a[i];
+}
+
+// a[i] = (b[i] > a[i]) ? b[i] : a[i]
+template<typename T>
+void maxN(T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, max(loadw(b + i), loadw(a + i)));)
+	for(; i < n; ++i) if(b[i] > a[i]) a[i] = b[i];
+}
+
+// a[i] = (b[i] < a[i]) ? b[i] : a[i]
+template<typename T>
+void minN(T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, min(loadw(b + i), loadw(a + i)));)
+	for(; i < n; ++i) if(b[i] < a[i]) a[i] = b[i];
+}
+
+// a[i] = std::clamp(a[i], low[i], high[i])
+template<typename T>
+void clampN(T* a, const T* low, const T* high, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i,
+		storew(a + i, min(loadw(high + i), max(loadw(low + i), loadw(a + i))));)
+	for(; i < n; ++i) a[i] = std::clamp(a[i], low[i], high[i]);
+}
+
+// a[i] = std::clamp(a[i], low, high)
+template<typename T>
+void clampN(T* a, T low, T high, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, min(splatw(high), max(splatw(low), loadw(a + i))));)
+	for(; i < n; ++i) a[i] = std::clamp(a[i], low, high);
+}
+
+// a[i] += fac * b[i]
+// Not fused, to match the scalar results.
+template<typename T>
+void axpyN(T* a, T fac, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, add(loadw(a + i), mul(splatw(fac), loadw(b + i))));)
+	for(; i < n; ++i) a[i] += fac * b[i];
+}
+
+// a[i] = std::abs(a[i])
+template<typename T>
+void absN(T* a, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_LOOP(n, i, storew(a + i, abs(loadw(a + i)));)
+	for(; i < n; ++i) a[i] = std::abs(a[i]);
+}
+
+#undef NYTL_SIMD_LOOP
+
+// Kernels on n vectors of dimension D stored contiguously (AoS layout,
+// e.g. an array of Vec<D, T>). Blocks of width<T> vectors are transposed
+// into one register per component so that all per-vector work (including
+// sqrt and division) is done for width<T> vectors at once. Remaining
+// vectors are handled in a scalar loop. Output and input may be the same.
+#ifdef NYTL_SIMD_ANY
+	// Loads component c of width<T> consecutive vectors of dimension D.
+	template<std::size_t D, typename T>
+	auto gatherw(const T* vecs, std::size_t c) {
+		alignas(64) T buf[width<T>];
+		for(auto j = 0u; j < width<T>; ++j) buf[j] = vecs[j * D + c];
+		return loadw(buf);
+	}
+
+	// Stores the register into component c of width<T> consecutive vectors.
+	template<std::size_t D, typename T, typename R>
+	void scatterw(T* vecs, std::size_t c, R reg) {
+		alignas(64) T buf[width<T>];
+		storew(buf, reg);
+		for(auto j = 0u; j < width<T>; ++j) vecs[j * D + c] = buf[j];
+	}
+
+	#define NYTL_SIMD_VEC_LOOP(n, i, body) \
+		if constexpr(has4<T>) { \
+			for(; i + width<T> <= n; i += width<T>) { \
+				body \
+			} \
+		}
+#else
+	#define NYTL_SIMD_VEC_LOOP(n, i, body)
+#endif
+
+// out[i] = dot(a[i], b[i])
+template<std::size_t D, typename T>
+void dotV(T* out, const T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_VEC_LOOP(n, i,
+		auto acc = splatw(T {0});
+		for(auto c = 0u; c < D; ++c) {
+			acc = add(acc, mul(gatherw<D>(a + i * D, c), gatherw<D>(b + i * D, c)));
+		}
+		storew(out + i, acc);)
+
+	for(; i < n; ++i) {
+		T sum {0};
+		for(auto c = 0u; c < D; ++c) sum += a[i * D + c] * b[i * D + c];
+		out[i] = sum;
+	}
+}
+
+// out[i] = length(a[i] - b[i])
+template<std::size_t D, typename T>
+void distanceV(T* out, const T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_VEC_LOOP(n, i,
+		auto acc = splatw(T {0});
+		for(auto c = 0u; c < D; ++c) {
+			auto d = sub(gatherw<D>(a + i * D, c), gatherw<D>(b + i * D, c));
+			acc = add(acc, mul(d, d));
+		}
+		storew(out + i, sqrt(acc));)
+
+	for(; i < n; ++i) {
+		T sum {0};
+		for(auto c = 0u; c < D; ++c) {
+			auto d = a[i * D + c] - b[i * D + c];
+			sum += d * d;
+		}
+		out[i] = std::sqrt(sum);
+	}
+}
+
+// out[i] = normalized(a[i])
+template<std::size_t D, typename T>
+void normalizeV(T* out, const T* a, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_VEC_LOOP(n, i,
+		decltype(splatw(T {})) comps[D];
+		auto acc = splatw(T {0});
+		for(auto c = 0u; c < D; ++c) {
+			comps[c] = gatherw<D>(a + i * D, c);
+			acc = add(acc, mul(comps[c], comps[c]));
+		}
+		auto fac = div(splatw(T {1}), sqrt(acc));
+		for(auto c = 0u; c < D; ++c) {
+			scatterw<D>(out + i * D, c, mul(fac, comps[c]));
+		})
+
+	for(; i < n; ++i) {
+		T sum {0};
+		for(auto c = 0u; c < D; ++c) sum += a[i * D + c] * a[i * D + c];
+		auto fac = T {1} / std::sqrt(sum);
+		for(auto c = 0u; c < D; ++c) out[i * D + c] = fac * a[i * D + c];
+	}
+}
+
+// out[i] = cross(a[i], b[i]) for 3-dimensional vectors
+template<typename T>
+void crossV(T* out, const T* a, const T* b, std::size_t n) {
+	std::size_t i = 0u;
+	NYTL_SIMD_VEC_LOOP(n, i,
+		auto ax = gatherw<3>(a + i * 3, 0);
+		auto ay = gatherw<3>(a + i * 3, 1);
+		auto az = gatherw<3>(a + i * 3, 2);
+		auto bx = gatherw<3>(b + i * 3, 0);
+		auto by = gatherw<3>(b + i * 3, 1);
+		auto bz = gatherw<3>(b + i * 3, 2);
+		scatterw<3>(out + i * 3, 0, sub(mul(ay, bz), mul(az, by)));
+		scatterw<3>(out + i * 3, 1, sub(mul(az, bx), mul(ax, bz)));
+		scatterw<3>(out + i * 3, 2, sub(mul(ax, by), mul(ay, bx)));)
+
+	for(; i < n; ++i) {
+		auto va = a + i * 3;
+		auto vb = b + i * 3;
+		T res[3] = {
+			(va[1] * vb[2]) - (va[2] * vb[1]),
+			(va[2] * vb[0]) - (va[0] * vb[2]),
+			(va[0] * vb[1]) - (va[1] * vb[0]),
+		};
+		std::copy(res, res + 3, out + i * 3);
+	}
+}
+
+// Corrects the interpolation factor t for normalized lerp between two
+// quaternions with the absolute dot product d, so that the result
+// approximates slerp. Polynomial fit by Arseny Kapoulkine
+// (zeux.io/2015/07/23/approximating-slerp/), the angular error of the
+// result is below 0.0008 radians (see docs/bench/quaternion.cpp).
+template<typename T>
+T slerpFactor(T t, T d) {
+	auto a = T(1.0904) + d * (T(-3.2452) + d * (T(3.55645) - d * T(1.43519)));
+	auto b = T(0.848013) + d * (T(-1.06021) + d * T(0.215638));
+	auto h = t - T(0.5);
+	auto k = a * h * h + b;
+	return t + t * h * (t - T(1)) * k;
+}
+
+#ifdef NYTL_SIMD_ANY
+	// Same as slerpFactor (with the same order of operations) for registers.
+	template<typename T, typename R>
+	R slerpFactor4(R t, R d) {
+		auto c = [](double v) { return splat(T(v)); };
+		auto a = add(c(1.0904), mul(d, add(c(-3.2452), mul(d, sub(c(3.55645), mul(d, c(1.43519)))))));
+		auto b = add(c(0.848013), mul(d, add(c(-1.06021), mul(d, c(0.215638)))));
+		auto h = sub(t, c(0.5));
+		auto k = add(mul(mul(a, h), h), b);
+		return add(t, mul(mul(mul(t, h), sub(t, c(1.0))), k));
+	}
+#endif
+
+// Normalized linear interpolation of n quaternions (4 values x, y, z, w
+// each) along the shorter path, i.e. b[i] is negated if dot(a[i], b[i]) < 0:
+// out[i] = normalized(a[i] + t * (b[i] - a[i])). tStride must be 1 (t has
+// one factor per quaternion) or 0 (the same factor t[0] for all).
+// If Fast is true, t is corrected with slerpFactor first, so the results
+// approximate slerp. The SIMD path performs the same operations as the
+// scalar path, so (unless the compiler contracts them, see -ffp-contract)
+// the results don't depend on whether it was taken for a quaternion.
+template<bool Fast, typename T>
+void lerpQ(T* out, const T* a, const T* b, const T* t, std::size_t tStride, std::size_t n) {
+	std::size_t i = 0u;
+
+	// Quaternions have exactly 4 values, so 4 of them are transposed
+	// in registers to get one register per component.
+#ifdef NYTL_SIMD_ANY
+	if constexpr(has4<T>) {
+		for(; i + 4 <= n; i += 4) {
+			auto qa = a + i * 4;
+			auto qb = b + i * 4;
+			auto ax = load(qa), ay = load(qa + 4), az = load(qa + 8), aw = load(qa + 12);
+			auto bx = load(qb), by = load(qb + 4), bz = load(qb + 8), bw = load(qb + 12);
+			transpose(ax, ay, az, aw);
+			transpose(bx, by, bz, bw);
+
+			auto d = add(add(add(mul(ax, bx), mul(ay, by)), mul(az, bz)), mul(aw, bw));
+			auto s = sign1(d);
+			auto tt = tStride ? load(t + i) : splat(t[0]);
+			if constexpr(Fast) {
+				tt = slerpFactor4<T>(tt, mul(d, s));
+			}
+
+			auto rx = add(ax, mul(tt, sub(mul(s, bx), ax)));
+			auto ry = add(ay, mul(tt, sub(mul(s, by), ay)));
+			auto rz = add(az, mul(tt, sub(mul(s, bz), az)));
+			auto rw = add(aw, mul(tt, sub(mul(s, bw), aw)));
+			auto len = sqrt(add(add(add(mul(rx, rx), mul(ry, ry)), mul(rz, rz)), mul(rw, rw)));
+			rx = div(rx, len);
+			ry = div(ry, len);
+			rz = div(rz, len);
+			rw = div(rw, len);
+
+			transpose(rx, ry, rz, rw);
+			store(out + i * 4, rx);
+			store(out + i * 4 + 4, ry);
+			store(out + i * 4 + 8, rz);
+			store(out + i * 4 + 12, rw);
+		}
+	}
+#endif
+
+	for(; i < n; ++i) {
+		auto qa = a + i * 4;
+		auto qb = b + i * 4;
+		T d {0};
+		for(auto c = 0u; c < 4; ++c) d += qa[c] * qb[c];
+
+		auto s = std::copysign(T {1}, d);
+		auto tt = t[i * tStride];
+		if constexpr(Fast) {
+			tt = slerpFactor(tt, d * s);
+		}
+
+		T r[4];
+		T len {0};
+		for(auto c = 0u; c < 4; ++c) {
+			r[c] = qa[c] + tt * (s * qb[c] - qa[c]);
+			len += r[c] * r[c];
+		}
+
+		len = std::sqrt(len);
+		for(auto c = 0u; c < 4; ++c) out[i * 4 + c] = r[c] / len;
+	}
+}
+
+// Transforms n vectors with the row-major 4x4 matrix m (16 contiguous
+// values) and writes the first three components of the results.
+// If Pos is true, the vectors are treated as positions: the w component
+// is 1 (or the fourth input component for DI == 4) and the results
+// are divided by their w component, i.e. out[i] = multPos(m, in[i]).
+// Otherwise they are treated as directions: w is 0 and there is no divide.
+// The broadcasted matrix values are held in registers for all vectors.
+#ifdef NYTL_SIMD_ANY
+	template<bool Pos, typename R>
+	void transformw(const R* m, R x, R y, R z, [[maybe_unused]] R w, R* out) {
+		R res[4];
+		for(auto r = 0u; r < (Pos ? 4u : 3u); ++r) {
+			res[r] = add(add(mul(m[4 * r], x), mul(m[4 * r + 1], y)), mul(m[4 * r + 2], z));
+			if constexpr(Pos) {
+				res[r] = add(res[r], mul(m[4 * r + 3], w));
+			}
+		}
+
+		for(auto c = 0u; c < 3u; ++c) {
+			out[c] = Pos ? div(res[c], res[3]) : res[c];
+		}
+	}
+#endif
+
+template<bool Pos, typename T>
+void transform(const T* m, const T* x, const T* y, const T* z,
+		[[maybe_unused]] T w, T* ox, T* oy, T* oz) {
+	T res[4];
+	for(auto r = 0u; r < (Pos ? 4u : 3u); ++r) {
+		res[r] = m[4 * r] * x[0] + m[4 * r + 1] * y[0] + m[4 * r + 2] * z[0];
+		if constexpr(Pos) {
+			res[r] += m[4 * r + 3] * w;
+		}
+	}
+
+	T* outs[3] = {ox, oy, oz};
+	for(auto c = 0u; c < 3u; ++c) {
+		*outs[c] = Pos ? res[c] / res[3] : res[c];
+	}
+}
+
+// AoS version for vectors of dimension DI (3 or 4), out are vec3s.
+template<bool Pos, std::size_t DI, typename T>
+void transformV(T* out, const T* m, const T* in, std::size_t n) {
+	static_assert(DI == 3 || DI == 4);
+	std::size_t i = 0u;
+
+#ifdef NYTL_SIMD_ANY
+	if constexpr(has4<T>) {
+		using R = decltype(splatw(T {}));
+		R mw[16];
+		for(auto j = 0u; j < 16u; ++j) mw[j] = splatw(m[j]);
+		for(; i + width<T> <= n; i += width<T>) {
+			auto vin = in + i * DI;
+			auto w = (DI == 4 && Pos) ? gatherw<DI>(vin, DI - 1) : splatw(T {1});
+			R res[3];
+			transformw<Pos>(mw, gatherw<DI>(vin, 0), gatherw<DI>(vin, 1),
+				gatherw<DI>(vin, 2), w, res);
+			for(auto c = 0u; c < 3u; ++c) scatterw<3>(out + i * 3, c, res[c]);
+		}
+	}
+#endif
+
+	for(; i < n; ++i) {
+		auto vin = in + i * DI;
+		auto w = DI == 4 ? vin[DI - 1] : T {1};
+		transform<Pos>(m, vin, vin + 1, vin + 2, w,
+			out + i * 3, out + i * 3 + 1, out + i * 3 + 2);
+	}
+}
+
+// SoA version, in and out are the x, y, z lanes.
+template<bool Pos, typename T>
+void transformSoA(T* const out[3], const T* m, const T* const in[3], std::size_t n) {
+	std::size_t i = 0u;
+
+#ifdef NYTL_SIMD_ANY
+	if constexpr(has4<T>) {
+		using R = decltype(splatw(T {}));
+		R mw[16];
+		for(auto j = 0u; j < 16u; ++j) mw[j] = splatw(m[j]);
+		for(; i + width<T> <= n; i += width<T>) {
+			R res[3];
+			transformw<Pos>(mw, loadw(in[0] + i), loadw(in[1] + i),
+				loadw(in[2] + i), splatw(T {1}), res);
+			for(auto c = 0u; c < 3u; ++c) storew(out[c] + i, res[c]);
+		}
+	}
+#endif
+
+	for(; i < n; ++i) {
+		transform<Pos>(m, in[0] + i, in[1] + i, in[2] + i, T {1},
+			out[0] + i, out[1] + i, out[2] + i);
+	}
+}
+
+#undef NYTL_SIMD_VEC_LOOP
+
+} // namespace simd
+} // namespace nytl::detail
+
+#endif // header guard
@@ -0,0 +1,329 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the SlotCallback template class.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_SLOT_CALLBACK
+#define NYTL_INCLUDE_SLOT_CALLBACK
+
+#include <nytl/connection.hpp> // nytl::BasicConnection
+#include <nytl/nonCopyable.hpp> // nytl::NonCopyable
+#include <nytl/collector.hpp> // nytl::detail::collect
+
+#include <functional> // std::function
+#include <utility> // std::move
+#include <cstdint> // std::uint32_t
+#include <cstddef> // std::size_t
+#include <type_traits> // std::is_same
+#include <vector> // std::vector
+#include <limits> // std::numeric_limits
+#include <stdexcept> // std::invalid_argument
+
+namespace nytl {
+
+/// Callback that stores its subscriptions in a slot map, making disconnect
+/// O(1) (amortized) instead of O(n) while still calling the registered
+/// functions densely and in registration order.
+/// The connection id values encode a slot index and its generation, so
+/// a stale id of a slot that was already reused will not disconnect
+/// the new function.
+/// Otherwise the public interface and semantics are identical with
+/// nytl::Callback, i.e. no recursive operations are allowed and the class
+/// is not thread-safe in any way.
+///
+/// \tparam Signature The signature of the registered functions.
+/// \tparam ID A connectionID class, see nytl/connection.hpp for examples.
+/// \tparam Function The type used to store the registered functions,
+/// see nytl::Callback.
+template<typename Signature, typename ID = ConnectionID,
+	template<typename> typename Function = std::function>
+class SlotCallback;
+
+/// SlotCallback class typedef using TrackedConnectionID.
+template<typename Signature> using TrackedSlotCallback =
+	SlotCallback<Signature, TrackedConnectionID>;
+
+// SlotCallback specialization to enable the Ret(Args...) Signature format.
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+class SlotCallback<Ret(Args...), ID, Function>
+	: public ConnectableT<ID>, public NonCopyable {
+public:
+	/// Represents one callback subscription entry.
+	/// Subscriptions that were removed but not yet compacted
+	/// have an invalid slot.
+	struct Subscription {
+		Function<Ret(Args...)> func;
+		ID id;
+		std::uint32_t slot;
+	};
+
+	using Signature = Ret(Args...);
+	using FunctionType = Function<Ret(Args...)>;
+	using Connection = ConnectionT<ConnectableT<ID>, ID>;
+
+	static constexpr auto invalidSlot = std::numeric_limits<std::uint32_t>::max();
+
+public:
+	SlotCallback() = default;
+	~SlotCallback();
+
+	/// \brief Registers a new Callback function.
+	/// \returns A connection id for the registered function which can be used to
+	/// unregister it.
+	/// \throws std::invalid_argument If an empty function target is registered.
+	Connection add(FunctionType);
+
+	/// Calls all registered functions in registration order and returns a
+	/// vector with the returned objects, or void when this is a void callback.
+	/// If a registered function throws, the exception is not caught, i.e. the following
+	/// handlers will not be called.
+	auto call(Args...);
+
+	/// Calls all registered functions like call but passes the returned values
+	/// to the given collector instead of returning them in a vector, i.e. does
+	/// not allocate. If the collector returns a bool, false stops the iteration
+	/// and the following functions will not be called.
+	/// Returns the collector. See nytl/collector.hpp for predefined collectors.
+	/// Only available for non-void callbacks.
+	template<typename C>
+	C collect(C collector, Args...);
+
+	/// Clears all registered functions.
+	void clear() noexcept;
+
+	/// Removes the callback function registered with the given id in O(1).
+	/// Returns whether the function could be found. If the id is invalid or the
+	/// associated function was already removed, returns false.
+	/// Disconnecting an id that was not returned from this callback is
+	/// undefined behaviour.
+	bool disconnect(const ID&) noexcept override;
+
+	/// Operator version of add
+	template<typename F>
+	Connection operator+=(F&& func) {
+		return add(std::forward<F>(func));
+	}
+
+	/// Operator version of add that previously calls clear.
+	template<typename F>
+	Connection operator=(F&& func) {
+		clear();
+		return add(std::forward<F>(func));
+	}
+
+	/// Operator version of call.
+	auto operator() (Args... a) {
+		return call(std::forward<Args>(a)...);
+	}
+
+	/// Returns the number of registered functions.
+	std::size_t size() const noexcept { return subs_.size() - dead_; }
+
+protected:
+	struct Slot {
+		std::uint32_t index; // index into subs_ or the next free slot
+		std::uint32_t generation; // starts at 1, always positive as int32
+	};
+
+	static constexpr std::uint32_t maxGeneration = std::numeric_limits<std::int32_t>::max();
+
+	// The id value is always positive since generation is in [1, 2^31)
+	static std::int64_t encode(std::uint32_t slot, std::uint32_t generation) {
+		return (std::int64_t(generation) << 32) | slot;
+	}
+
+	// Removes all dead subscriptions, keeping the order.
+	void compact() noexcept;
+
+	std::vector<Subscription> subs_ {}; // registration order, may contain dead ones
+	std::vector<Slot> slots_ {};
+	std::uint32_t freeSlot_ {invalidSlot}; // head of the free slot list
+	std::size_t dead_ {}; // number of dead subscriptions in subs_
+};
+
+// - implementation -
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+SlotCallback<Ret(Args...), ID, Function>::~SlotCallback()
+{
+	for(auto& sub : subs_) {
+		if(sub.slot != invalidSlot) {
+			sub.id.removed();
+		}
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+ConnectionT<ConnectableT<ID>, ID> SlotCallback<Ret(Args...), ID, Function>::
+add(FunctionType func) {
+	if(!func) {
+		throw std::invalid_argument("nytl::SlotCallback::add: empty function");
+	}
+
+	if(subs_.size() >= invalidSlot) {
+		throw std::length_error("nytl::SlotCallback::add: too many subscriptions");
+	}
+
+	auto slot = freeSlot_;
+	auto generation = 1u;
+	if(slot == invalidSlot) {
+		slot = std::uint32_t(slots_.size());
+	} else {
+		generation = slots_[slot].generation;
+	}
+
+	// this expression might throw. In this case we have not changed
+	// our own state in any bad way
+	ID id = {encode(slot, generation)};
+	subs_.push_back({std::move(func), id, slot});
+
+	if(slot == freeSlot_) {
+		freeSlot_ = slots_[slot].index;
+	} else {
+		try {
+			slots_.push_back({invalidSlot, generation});
+		} catch(...) {
+			subs_.pop_back();
+			throw;
+		}
+	}
+
+	slots_[slot].index = std::uint32_t(subs_.size() - 1);
+	return {*this, id};
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+auto SlotCallback<Ret(Args...), ID, Function>::call(Args... a)
+{
+	if constexpr(std::is_same<Ret, void>::value) {
+		for(auto& sub : subs_) {
+			if(sub.slot != invalidSlot) {
+				sub.func(std::forward<Args>(a)...);
+			}
+		}
+	} else {
+		std::vector<Ret> ret;
+		ret.reserve(size());
+
+		for(auto& sub : subs_) {
+			if(sub.slot != invalidSlot) {
+				ret.push_back(sub.func(std::forward<Args>(a)...));
+			}
+		}
+
+		return ret;
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+template<typename C>
+C SlotCallback<Ret(Args...), ID, Function>::collect(C collector, Args... a)
+{
+	static_assert(!std::is_void_v<Ret>, "nytl::SlotCallback::collect: void callback");
+	for(auto& sub : subs_) {
+		if(sub.slot != invalidSlot &&
+				!detail::collect(collector, sub.func(std::forward<Args>(a)...))) {
+			break;
+		}
+	}
+
+	return collector;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void SlotCallback<Ret(Args...), ID, Function>::clear() noexcept
+{
+	for(auto& sub : subs_) {
+		if(sub.slot != invalidSlot) {
+			sub.id.removed();
+		}
+	}
+
+	subs_.clear();
+	dead_ = 0u;
+
+	// we keep the slots (and their generations) so that
+	// old ids stay invalid
+	freeSlot_ = invalidSlot;
+	for(auto i = slots_.size(); i-- > 0;) {
+		auto& slot = slots_[i];
+		if(slot.generation < maxGeneration) {
+			++slot.generation;
+			slot.index = freeSlot_;
+			freeSlot_ = std::uint32_t(i);
+		}
+	}
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+bool SlotCallback<Ret(Args...), ID, Function>::disconnect(const ID& id) noexcept
+{
+	auto value = id.get();
+	if(value <= 0) {
+		return false;
+	}
+
+	auto slotID = std::uint32_t(value & 0xFFFFFFFFu);
+	auto generation = std::uint32_t(value >> 32);
+	if(slotID >= slots_.size() || slots_[slotID].generation != generation) {
+		return false;
+	}
+
+	auto& slot = slots_[slotID];
+	auto& sub = subs_[slot.index];
+	sub.id.removed();
+	sub.slot = invalidSlot;
+	sub.func = FunctionType {};
+	++dead_;
+
+	// slots that would overflow their generation are never reused
+	if(++slot.generation < maxGeneration) {
+		slot.index = freeSlot_;
+		freeSlot_ = slotID;
+	} else {
+		slot.index = invalidSlot;
+	}
+
+	// amortized O(1) since we only compact when at least half
+	// the subscriptions are dead
+	if(dead_ > subs_.size() / 2) {
+		compact();
+	}
+
+	return true;
+}
+
+template<typename Ret, typename... Args, typename ID,
+	template<typename> typename Function>
+void SlotCallback<Ret(Args...), ID, Function>::compact() noexcept
+{
+	auto dst = std::size_t(0);
+	for(auto src = std::size_t(0); src < subs_.size(); ++src) {
+		if(subs_[src].slot == invalidSlot) {
+			continue;
+		}
+
+		if(dst != src) {
+			subs_[dst] = std::move(subs_[src]);
+		}
+
+		slots_[subs_[dst].slot].index = std::uint32_t(dst);
+		++dst;
+	}
+
+	subs_.erase(subs_.begin() + dst, subs_.end());
+	dead_ = 0u;
+}
+
+} // namespace nytl
+
+#endif // header guard
@@ -70,6 +70,16 @@ template<typename... T> void unused(T&&...) {}
 /// \module utility
 template<typename A, typename> using Variadic = A;
 
+/// \brief Typedef for T that prevents template argument deduction for T.
+/// Useful for parameters that should just be converted to the type deduced
+/// from another parameter, e.g. a std::vector passed as nytl::span.
+/// ```cpp
+/// template<typename T> void fill(nytl::span<nytl::NonDeduced<T>>, T value);
+/// ```
+/// \module utility
+template<typename T> struct Identity { using type = T; };
+template<typename T> using NonDeduced = typename Identity<T>::type;
+
 /// \brief Assures that the returned value can be used as template-dependent expressions.
 /// This allows e.g. to defer operator of function lookup so that specific headers don't
 /// have to be included by a template functions if a function is not used.
@@ -5,8 +5,13 @@
 #include <nytl/vecOps.hpp>
 #include <nytl/matOps.hpp>
 #include <nytl/quaternion.hpp>
+#include <nytl/span.hpp>
+#include <nytl/vecSoA.hpp>
+#include <nytl/simd.hpp>
+#include <nytl/tmpUtil.hpp>
 #include <cmath>
 #include <cassert>
+#include <stdexcept>
 
 // Implements all kinds of useful 2D and 3D transforms and
 // matrix creation functions, projections, lookAt matrix and so on.
@@ -54,6 +59,91 @@ Vec3<P> multPos(const Mat4<P>& m, Vec3<P> v) {
 	return {v4[0] / v4[3], v4[1] / v4[3], v4[2] / v4[3]};
 }
 
+// Multiplies the given transformation matrix with the given
+// direction (i.e. w = 0), ignoring the translation.
+template<typename P> [[nodiscard]]
+Vec3<P> multDir(const Mat4<P>& m, Vec3<P> v) {
+	return {
+		m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+		m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+		m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z,
+	};
+}
+
+// Batched versions of multPos and multDir for transforming many
+// points at once, e.g. vertices. The matrix is held in (SIMD)
+// registers for all points, see nytl/simd.hpp.
+// out[i] = multPos(m, in[i]) or multDir(m, in[i]). For Vec4 input,
+// multPos uses the given w component (instead of 1) and multDir
+// ignores it. 'in' and 'out' must have the same size, otherwise
+// std::invalid_argument is thrown. They may be the same for Vec3.
+namespace detail {
+	template<bool Pos, size_t DI, typename P>
+	void transformBatch(const Mat4<P>& m, span<const Vec<DI, P>> in,
+			span<Vec3<P>> out) {
+		static_assert(sizeof(Vec<DI, P>) == DI * sizeof(P));
+		if(in.size() != out.size()) {
+			throw std::invalid_argument("nytl::multPos/multDir: size mismatch");
+		}
+
+		detail::simd::transformV<Pos, DI>(&out.data()->x, m[0].data(),
+			reinterpret_cast<const P*>(in.data()), in.size());
+	}
+
+	template<bool Pos, typename P, typename A1, typename A2>
+	void transformBatch(const Mat4<P>& m, const VecSoA<3, P, A1>& in,
+			VecSoA<3, P, A2>& out, size_t begin, size_t end) {
+		const P* ins[3];
+		P* outs[3];
+		for(auto c = 0u; c < 3u; ++c) {
+			ins[c] = in.lane(c).data() + begin;
+			outs[c] = out.lane(c).data() + begin;
+		}
+
+		detail::simd::transformSoA<Pos>(outs, m[0].data(), ins, end - begin);
+	}
+
+	template<bool Pos, typename P, typename A1, typename A2>
+	void transformBatch(const Mat4<P>& m, const VecSoA<3, P, A1>& in,
+			VecSoA<3, P, A2>& out) {
+		if(in.size() != out.size()) {
+			throw std::invalid_argument("nytl::multPos/multDir: size mismatch");
+		}
+
+		transformBatch<Pos>(m, in, out, 0, in.size());
+	}
+} // namespace detail
+
+template<typename P>
+void multPos(const Mat4<P>& m, span<const Vec3<P>> in, span<NonDeduced<Vec3<P>>> out) {
+	detail::transformBatch<true>(m, in, out);
+}
+
+template<typename P>
+void multPos(const Mat4<P>& m, span<const Vec4<P>> in, span<NonDeduced<Vec3<P>>> out) {
+	detail::transformBatch<true>(m, in, out);
+}
+
+template<typename P, typename A1, typename A2>
+void multPos(const Mat4<P>& m, const VecSoA<3, P, A1>& in, VecSoA<3, P, A2>& out) {
+	detail::transformBatch<true>(m, in, out);
+}
+
+template<typename P>
+void multDir(const Mat4<P>& m, span<const Vec3<P>> in, span<NonDeduced<Vec3<P>>> out) {
+	detail::transformBatch<false>(m, in, out);
+}
+
+template<typename P>
+void multDir(const Mat4<P>& m, span<const Vec4<P>> in, span<NonDeduced<Vec3<P>>> out) {
+	detail::transformBatch<false>(m, in, out);
+}
+
+template<typename P, typename A1, typename A2>
+void multDir(const Mat4<P>& m, const VecSoA<3, P, A1>& in, VecSoA<3, P, A2>& out) {
+	detail::transformBatch<false>(m, in, out);
+}
+
 // Given a unit vector, returns two unit vectors that are orthogonal
 // to it.
 template<typename P> [[nodiscard]]
@@ -453,13 +543,13 @@ SquareMat<4, P> perspectiveRevInf(P fov, P aspect, P near) {
 // For a left-handed view space, the camera points along the positive
 // z axis by default and everything z > 0 is in front of the camera after
 // multiplying by this matrix.
-template<size_t D = 4, typename P> [[nodiscard]]
-SquareMat<D, P> lookAt(const Quaternion& rot, Vec3<P> pos) {
+template<size_t D = 4, typename P, typename Q> [[nodiscard]]
+SquareMat<D, P> lookAt(const QuaternionT<Q>& rot, Vec3<P> pos) {
 	// transpose is same as inverse for rotation matrices
 	auto ret = transpose(toMat<4, P>(rot));
-	ret[0][3] = -dot(pos, Vec3f(ret[0]));
-	ret[1][3] = -dot(pos, Vec3f(ret[1]));
-	ret[2][3] = -dot(pos, Vec3f(ret[2]));
+	ret[0][3] = -dot(pos, Vec3<P>(ret[0]));
+	ret[1][3] = -dot(pos, Vec3<P>(ret[1]));
+	ret[2][3] = -dot(pos, Vec3<P>(ret[2]));
 	return ret;
 
 	// reference implementation, same result but slower
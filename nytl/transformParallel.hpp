@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Multi-threaded versions of the batched transform functions.
+/// Separate from transform.hpp since they require nytl/parallel.hpp,
+/// i.e. threads.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_TRANSFORM_PARALLEL
+#define NYTL_INCLUDE_TRANSFORM_PARALLEL
+
+#include <nytl/transform.hpp> // nytl::detail::transformBatch
+#include <nytl/parallel.hpp> // nytl::ThreadPool, nytl::parallelFor
+
+#include <stdexcept> // std::invalid_argument
+#include <cstddef> // std::size_t
+
+namespace nytl {
+
+/// Multi-threaded versions of the batched multPos/multDir functions.
+/// Split the range into chunks of 'grain' points that are transformed by
+/// the workers of the given pool (and the calling thread).
+template<typename P, size_t DI>
+void multPos(ThreadPool& pool, const Mat4<P>& m, span<const Vec<DI, P>> in,
+		span<NonDeduced<Vec3<P>>> out, size_t grain = 16 * 1024) {
+	if(in.size() != out.size()) {
+		throw std::invalid_argument("nytl::multPos: size mismatch");
+	}
+
+	parallelFor(pool, in.size(), grain, [&](size_t begin, size_t end) {
+		detail::transformBatch<true>(m, in.subspan(begin, end - begin),
+			out.subspan(begin, end - begin));
+	});
+}
+
+template<typename P, size_t DI>
+void multDir(ThreadPool& pool, const Mat4<P>& m, span<const Vec<DI, P>> in,
+		span<NonDeduced<Vec3<P>>> out, size_t grain = 16 * 1024) {
+	if(in.size() != out.size()) {
+		throw std::invalid_argument("nytl::multDir: size mismatch");
+	}
+
+	parallelFor(pool, in.size(), grain, [&](size_t begin, size_t end) {
+		detail::transformBatch<false>(m, in.subspan(begin, end - begin),
+			out.subspan(begin, end - begin));
+	});
+}
+
+template<typename P, typename A1, typename A2>
+void multPos(ThreadPool& pool, const Mat4<P>& m, const VecSoA<3, P, A1>& in,
+		VecSoA<3, P, A2>& out, size_t grain = 16 * 1024) {
+	if(in.size() != out.size()) {
+		throw std::invalid_argument("nytl::multPos: size mismatch");
+	}
+
+	parallelFor(pool, in.size(), grain, [&](size_t begin, size_t end) {
+		detail::transformBatch<true>(m, in, out, begin, end);
+	});
+}
+
+template<typename P, typename A1, typename A2>
+void multDir(ThreadPool& pool, const Mat4<P>& m, const VecSoA<3, P, A1>& in,
+		VecSoA<3, P, A2>& out, size_t grain = 16 * 1024) {
+	if(in.size() != out.size()) {
+		throw std::invalid_argument("nytl::multDir: size mismatch");
+	}
+
+	parallelFor(pool, in.size(), grain, [&](size_t begin, size_t end) {
+		detail::transformBatch<false>(m, in, out, begin, end);
+	});
+}
+
+} // namespace nytl
+
+#endif // header guard
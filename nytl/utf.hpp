@@ -9,41 +9,384 @@
 #ifndef NYTL_INCLUDE_UTF
 #define NYTL_INCLUDE_UTF
 
+#include <nytl/simd.hpp> // NYTL_SIMD_SSE2, NYTL_SIMD_AVX2
+#include <nytl/span.hpp> // nytl::span
+
 #include <string> // std::string
 #include <string_view> // std::string_view
 #include <array> // std::array
-#include <locale> // std::wstring_convert
-#include <codecvt> // std::codecvt_utf8
-#include <stdexcept> // std::out_of_range
-
-// all operations assume correct utf8 string and don't perform any sanity checks.
+#include <stdexcept> // std::out_of_range, std::range_error
+#include <type_traits> // std::is_same_v
+#include <cstdint> // std::uint64_t
+#include <cstring> // std::memcpy
+#include <algorithm> // std::min
+
+// Operations other than validUtf8 assume correct utf8 strings and don't
+// perform sanity checks. They never read outside the given strings though,
+// also not for malformed or truncated input.
 // for implementation details see https://en.wikipedia.org/wiki/UTF-8
 
 namespace nytl {
+namespace detail {
+
+inline unsigned popcount64(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+	return unsigned(__builtin_popcountll(x));
+#else
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return unsigned((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/// Returns the byte length of the utf8 character starting at the given
+/// position, clamped to the end of the string.
+template<typename It>
+std::size_t charLength(It it, It end) {
+	auto length = std::size_t(1u);
+	if((*it) & (1 << 7)) {
+		++length;
+		if((*it) & (1 << 5)) {
+			++length;
+			if((*it) & (1 << 4))
+				++length;
+		}
+	}
+
+	return std::min(length, std::size_t(end - it));
+}
+
+/// Counts the continuation bytes (10xxxxxx) in the given range,
+/// 8 bytes at a time.
+inline std::size_t continuationCountScalar(const unsigned char* data, std::size_t size) {
+	std::size_t count = 0u;
+	std::size_t i = 0u;
+	for(; i + 8 <= size; i += 8) {
+		std::uint64_t x;
+		std::memcpy(&x, data + i, 8);
+
+		// bit 7 of each byte: set in x, bit 6 not set
+		count += popcount64(x & ~(x << 1) & 0x8080808080808080ull);
+	}
+
+	for(; i < size; ++i) {
+		count += ((data[i] & 0xC0u) == 0x80u);
+	}
+
+	return count;
+}
+
+/// Scalar utf8 validation, skips ascii 8 bytes at a time.
+inline bool validUtf8Scalar(const unsigned char* it, const unsigned char* end) {
+	while(it != end) {
+		if(end - it >= 8) {
+			std::uint64_t x;
+			std::memcpy(&x, it, 8);
+			if(!(x & 0x8080808080808080ull)) {
+				it += 8;
+				continue;
+			}
+		}
+
+		auto c = *it;
+		if(c < 0x80u) {
+			++it;
+			continue;
+		}
+
+		// allowed range of the second byte, see the table in rfc 3629
+		std::size_t length;
+		unsigned char lo = 0x80u, hi = 0xBFu;
+		if(c < 0xC2u) { // continuation or overlong 2-byte
+			return false;
+		} else if(c < 0xE0u) {
+			length = 2u;
+		} else if(c < 0xF0u) {
+			length = 3u;
+			if(c == 0xE0u) lo = 0xA0u; // overlong
+			else if(c == 0xEDu) hi = 0x9Fu; // surrogates
+		} else if(c < 0xF5u) {
+			length = 4u;
+			if(c == 0xF0u) lo = 0x90u; // overlong
+			else if(c == 0xF4u) hi = 0x8Fu; // > U+10FFFF
+		} else {
+			return false;
+		}
+
+		if(std::size_t(end - it) < length || it[1] < lo || it[1] > hi) {
+			return false;
+		}
+
+		for(auto i = 2u; i < length; ++i) {
+			if((it[i] & 0xC0u) != 0x80u) {
+				return false;
+			}
+		}
+
+		it += length;
+	}
+
+	return true;
+}
+
+// Unaligned load of a vector register. Using memcpy instead of casting
+// the pointer avoids the alignment requirement, compiles to the same load.
+template<typename V>
+V loadUnaligned(const void* ptr) {
+	V v;
+	std::memcpy(&v, ptr, sizeof(V));
+	return v;
+}
+
+// Vectorized validation using the lookup algorithm from Keiser, Lemire:
+// "Validating UTF-8 In Less Than One Instruction Per Byte" (2020).
+// The error classes of each pair of consecutive bytes are looked up
+// by the high and low nibble of the first and the high nibble of the
+// second byte, a set bit in all three lookups means an error.
+// Errors that need more context (too many/few continuation bytes) are
+// checked separately using the previous bytes.
+namespace utf8v {
+	constexpr unsigned char tooShort = 1 << 0; // 11______ 0_______, 11______ 11______
+	constexpr unsigned char tooLong = 1 << 1; // 0_______ 10______
+	constexpr unsigned char overlong3 = 1 << 2; // 11100000 100_____
+	constexpr unsigned char tooLarge = 1 << 3; // 11110100 1001____, 11110100 101_____, 11110101+
+	constexpr unsigned char surrogate = 1 << 4; // 11101101 101_____
+	constexpr unsigned char overlong2 = 1 << 5; // 1100000_ 10______
+	constexpr unsigned char tooLarge1000 = 1 << 6; // 11110101+ 1000____
+	constexpr unsigned char overlong4 = 1 << 6; // 11110000 1000____
+	constexpr unsigned char twoConts = 1 << 7; // 10______ 10______
+	constexpr unsigned char carry = tooShort | tooLong | twoConts;
+	constexpr unsigned char large = carry | tooLarge | tooLarge1000;
+
+	// indexed by the high nibble of the first byte
+	constexpr unsigned char byte1High[16] = {
+		tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,
+		twoConts, twoConts, twoConts, twoConts,
+		tooShort | overlong2,
+		tooShort,
+		tooShort | overlong3 | surrogate,
+		tooShort | tooLarge | tooLarge1000 | overlong4,
+	};
+
+	// indexed by the low nibble of the first byte
+	constexpr unsigned char byte1Low[16] = {
+		carry | overlong3 | overlong2 | overlong4,
+		carry | overlong2,
+		carry, carry,
+		carry | tooLarge,
+		large, large, large,
+		large, large, large, large,
+		large, large | surrogate, large, large,
+	};
+
+	// indexed by the high nibble of the second byte
+	constexpr unsigned char byte2High[16] = {
+		tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,
+		tooLong | overlong2 | twoConts | overlong3 | tooLarge1000 | overlong4,
+		tooLong | overlong2 | twoConts | overlong3 | tooLarge,
+		tooLong | overlong2 | twoConts | surrogate | tooLarge,
+		tooLong | overlong2 | twoConts | surrogate | tooLarge,
+		tooShort, tooShort, tooShort, tooShort,
+	};
+
+	// the last bytes of a block that start sequences that can't be
+	// complete in the block are larger than these values
+	constexpr unsigned char maxIncomplete[32] = {
+		255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+		255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+		0xF0u - 1, 0xE0u - 1, 0xC0u - 1,
+	};
+
+#if defined(NYTL_SIMD_AVX2)
+	struct Checker {
+		static constexpr auto blockSize = 32u;
+		using Block = __m256i;
+
+		Block error = _mm256_setzero_si256();
+		Block prevInput = _mm256_setzero_si256();
+		Block prevIncomplete = _mm256_setzero_si256();
+
+		static Block load(const unsigned char* ptr) {
+			return loadUnaligned<Block>(ptr);
+		}
+
+		static Block table(const unsigned char (&values)[16]) {
+			return _mm256_broadcastsi128_si256(
+				loadUnaligned<__m128i>(values));
+		}
+
+		// the input shifted by N bytes, the first bytes taken from prevInput
+		template<int N>
+		Block prev(Block input) const {
+			auto shifted = _mm256_permute2x128_si256(prevInput, input, 0x21);
+			return _mm256_alignr_epi8(input, shifted, 16 - N);
+		}
+
+		void check(Block input) {
+			if(_mm256_movemask_epi8(input) == 0) {
+				error = _mm256_or_si256(error, prevIncomplete);
+			} else {
+				auto nibble = _mm256_set1_epi8(0x0F);
+				auto prev1 = prev<1>(input);
+				auto special = _mm256_and_si256(_mm256_and_si256(
+					_mm256_shuffle_epi8(table(byte1High),
+						_mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+					_mm256_shuffle_epi8(table(byte1Low),
+						_mm256_and_si256(prev1, nibble))),
+					_mm256_shuffle_epi8(table(byte2High),
+						_mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+				// the bytes following 3/4-byte leads must be continuation bytes
+				auto third = _mm256_subs_epu8(prev<2>(input), _mm256_set1_epi8(char(0xE0u - 1)));
+				auto fourth = _mm256_subs_epu8(prev<3>(input), _mm256_set1_epi8(char(0xF0u - 1)));
+				auto must23 = _mm256_cmpgt_epi8(_mm256_or_si256(third, fourth),
+					_mm256_setzero_si256());
+				auto must23x80 = _mm256_and_si256(must23, _mm256_set1_epi8(char(0x80u)));
+
+				error = _mm256_or_si256(error, _mm256_xor_si256(must23x80, special));
+				prevIncomplete = _mm256_subs_epu8(input, load(maxIncomplete));
+			}
+
+			prevInput = input;
+		}
+
+		bool valid() {
+			error = _mm256_or_si256(error, prevIncomplete);
+			return _mm256_testz_si256(error, error);
+		}
+	};
+#elif defined(NYTL_SIMD_SSSE3)
+	struct Checker {
+		static constexpr auto blockSize = 16u;
+		using Block = __m128i;
+
+		Block error = _mm_setzero_si128();
+		Block prevInput = _mm_setzero_si128();
+		Block prevIncomplete = _mm_setzero_si128();
+
+		static Block load(const unsigned char* ptr) {
+			return loadUnaligned<Block>(ptr);
+		}
+
+		template<int N>
+		Block prev(Block input) const {
+			return _mm_alignr_epi8(input, prevInput, 16 - N);
+		}
+
+		void check(Block input) {
+			if(_mm_movemask_epi8(input) == 0) {
+				error = _mm_or_si128(error, prevIncomplete);
+			} else {
+				auto nibble = _mm_set1_epi8(0x0F);
+				auto prev1 = prev<1>(input);
+				auto special = _mm_and_si128(_mm_and_si128(
+					_mm_shuffle_epi8(load(byte1High),
+						_mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+					_mm_shuffle_epi8(load(byte1Low),
+						_mm_and_si128(prev1, nibble))),
+					_mm_shuffle_epi8(load(byte2High),
+						_mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+				// the bytes following 3/4-byte leads must be continuation bytes
+				auto third = _mm_subs_epu8(prev<2>(input), _mm_set1_epi8(char(0xE0u - 1)));
+				auto fourth = _mm_subs_epu8(prev<3>(input), _mm_set1_epi8(char(0xF0u - 1)));
+				auto must23 = _mm_cmpgt_epi8(_mm_or_si128(third, fourth), _mm_setzero_si128());
+				auto must23x80 = _mm_and_si128(must23, _mm_set1_epi8(char(0x80u)));
+
+				error = _mm_or_si128(error, _mm_xor_si128(must23x80, special));
+				prevIncomplete = _mm_subs_epu8(input, load(maxIncomplete + 16));
+			}
+
+			prevInput = input;
+		}
+
+		bool valid() {
+			error = _mm_or_si128(error, prevIncomplete);
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+		}
+	};
+#endif
+} // namespace utf8v
+} // namespace detail
+
+/// \brief Returns whether the given string is valid utf8.
+/// Rejects overlong encodings, surrogates, code points above U+10FFFF
+/// and truncated or otherwise malformed sequences.
+/// Vectorized with NYTL_SIMD if SSSE3 or AVX2 is available.
+inline bool validUtf8(std::string_view utf8) {
+	auto data = reinterpret_cast<const unsigned char*>(utf8.data());
+	auto size = utf8.size();
+
+#if defined(NYTL_SIMD_AVX2) || defined(NYTL_SIMD_SSSE3)
+	using Checker = detail::utf8v::Checker;
+	constexpr auto blockSize = Checker::blockSize;
+
+	Checker checker;
+	auto i = std::size_t(0u);
+	for(; i + blockSize <= size; i += blockSize) {
+		checker.check(Checker::load(data + i));
+	}
+
+	// pad the last block with zeros (ascii)
+	if(i < size) {
+		unsigned char last[blockSize] {};
+		std::memcpy(last, data + i, size - i);
+		checker.check(Checker::load(last));
+	}
+
+	return checker.valid();
+#else
+	return detail::validUtf8Scalar(data, data + size);
+#endif
+}
 
 /// \brief Returns the number of characters in a utf8-encoded unicode string.
 /// This differs from std::string::size because it does not return the bytes in the
 /// string, but the count of utf8-encoded characters.
+/// Counts all bytes that are not continuation bytes, i.e. for malformed input
+/// every byte not belonging to a character is counted as one.
+/// Vectorized with NYTL_SIMD.
 inline std::size_t charCount(std::string_view utf8) {
-	std::size_t count = 0u;
-	auto it = utf8.begin();
+	auto data = reinterpret_cast<const unsigned char*>(utf8.data());
+	auto size = utf8.size();
+	auto i = std::size_t(0u);
+	auto continuation = std::size_t(0u);
+
+#if defined(NYTL_SIMD_AVX2)
+	// continuation bytes are exactly the bytes < -64 as signed.
+	// Counted per byte lane (at most 255 iterations), then summed up
+	auto limit = _mm256_set1_epi8(-64);
+	while(i + 32 <= size) {
+		auto acc = _mm256_setzero_si256();
+		for(auto j = 0u; j < 255u && i + 32 <= size; ++j, i += 32) {
+			auto v = detail::loadUnaligned<__m256i>(data + i);
+			acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(limit, v));
+		}
 
-	while(it != utf8.end()) {
-		auto length = 1u;
-		if((*it) & (1 << 7)) {
-			++length;
-			if((*it) & (1 << 5)) {
-				++length;
-				if((*it) & (1 << 4))
-					++length;
-			}
+		auto sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+		continuation += std::size_t(_mm256_extract_epi64(sums, 0)) +
+			std::size_t(_mm256_extract_epi64(sums, 1)) +
+			std::size_t(_mm256_extract_epi64(sums, 2)) +
+			std::size_t(_mm256_extract_epi64(sums, 3));
+	}
+#elif defined(NYTL_SIMD_SSE2)
+	auto limit = _mm_set1_epi8(-64);
+	while(i + 16 <= size) {
+		auto acc = _mm_setzero_si128();
+		for(auto j = 0u; j < 255u && i + 16 <= size; ++j, i += 16) {
+			auto v = detail::loadUnaligned<__m128i>(data + i);
+			acc = _mm_sub_epi8(acc, _mm_cmplt_epi8(v, limit));
 		}
 
-		++count;
-		it += length;
+		auto sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+		continuation += std::size_t(_mm_cvtsi128_si32(sums)) +
+			std::size_t(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
 	}
+#endif
 
-	return count;
+	continuation += detail::continuationCountScalar(data + i, size - i);
+	return size - continuation;
 }
 
 /// \brief Returns the character at position n (started at 0) from the given utf8 string.
@@ -61,15 +404,7 @@ inline std::array<char, 5> nth(std::string_view utf8, std::size_t n) {
 	auto it = utf8.begin();
 
 	while(it != utf8.end()) {
-		auto length = 1u;
-		if((*it) & (1 << 7)) {
-			++length;
-			if((*it) & (1 << 5)) {
-				++length;
-				if((*it) & (1 << 4))
-					++length;
-			}
-		}
+		auto length = detail::charLength(it, utf8.end());
 
 		if(count == n) {
 			std::array<char, 5> ret {};
@@ -96,18 +431,10 @@ inline const char& nth(std::string_view utf8, std::size_t n, std::uint8_t& size)
 	auto it = utf8.begin();
 
 	while(it != utf8.end()) {
-		auto length = 1u;
-		if((*it) & (1 << 7)) {
-			++length;
-			if((*it) & (1 << 5)) {
-				++length;
-				if((*it) & (1 << 4))
-					++length;
-			}
-		}
+		auto length = detail::charLength(it, utf8.end());
 
 		if(count == n) {
-			size = length;
+			size = std::uint8_t(length);
 			return *it;
 		}
 
@@ -131,18 +458,10 @@ inline char& nth(std::string& utf8, std::size_t n, std::uint8_t& size) {
 	auto it = utf8.begin();
 
 	while(it != utf8.end()) {
-		auto length = 1u;
-		if((*it) & (1 << 7)) {
-			++length;
-			if((*it) & (1 << 5)) {
-				++length;
-				if((*it) & (1 << 4))
-					++length;
-			}
-		}
+		auto length = detail::charLength(it, utf8.end());
 
 		if(count == n) {
-			size = length;
+			size = std::uint8_t(length);
 			return *it;
 		}
 
@@ -154,38 +473,472 @@ inline char& nth(std::string& utf8, std::size_t n, std::uint8_t& size) {
 	throw std::out_of_range("nytl::nth(utf8, n, size)");
 }
 
+/// Status of a conversion into a caller-provided buffer.
+enum class UtfStatus {
+	ok, // the whole input was converted
+	invalid, // stopped at an invalid sequence
+	incomplete, // stopped at a sequence truncated by the end of the input
+	outputFull, // stopped since the next character did not fit into the output
+};
+
+/// Result of a conversion into a caller-provided buffer.
+/// The input up to 'read' was converted completely into the output up to 'written'.
+/// For a status other than ok, 'read' points to the sequence that
+/// could not be converted.
+struct UtfResult {
+	std::size_t read {}; // number of consumed input code units
+	std::size_t written {}; // number of produced output code units
+	UtfStatus status {UtfStatus::ok};
+};
+
+namespace detail {
+
+template<typename V>
+void storeUnaligned(void* ptr, V v) {
+	std::memcpy(ptr, &v, sizeof(V));
+}
+
+template<typename C>
+std::uint32_t codeUnit(C c) {
+	if constexpr(std::is_same_v<C, char>) {
+		return static_cast<unsigned char>(c);
+	} else {
+		return std::uint32_t(c);
+	}
+}
+
+// Decodes the code point starting at it. On success, sets cp and the
+// number of code units it takes. Otherwise sets length to the number of
+// code units forming the (truncated or invalid) sequence, i.e. the maximal
+// subpart as defined by the unicode standard. Always at least 1.
+inline UtfStatus decode(const char* it, const char* end, char32_t& cp,
+		std::size_t& length) {
+	auto c = codeUnit(*it);
+	length = 1u;
+	if(c < 0x80u) {
+		cp = c;
+		return UtfStatus::ok;
+	}
+
+	// allowed range of the second byte, see validUtf8Scalar
+	unsigned lo = 0x80u, hi = 0xBFu;
+	auto expected = std::size_t(0u);
+	if(c < 0xC2u) {
+		return UtfStatus::invalid;
+	} else if(c < 0xE0u) {
+		expected = 2u;
+		cp = c & 0x1Fu;
+	} else if(c < 0xF0u) {
+		expected = 3u;
+		cp = c & 0x0Fu;
+		if(c == 0xE0u) lo = 0xA0u;
+		else if(c == 0xEDu) hi = 0x9Fu;
+	} else if(c < 0xF5u) {
+		expected = 4u;
+		cp = c & 0x07u;
+		if(c == 0xF0u) lo = 0x90u;
+		else if(c == 0xF4u) hi = 0x8Fu;
+	} else {
+		return UtfStatus::invalid;
+	}
+
+	auto available = std::size_t(end - it);
+	for(; length < expected; ++length) {
+		if(length == available) {
+			return UtfStatus::incomplete;
+		}
+
+		auto b = codeUnit(it[length]);
+		if(b < lo || b > hi) {
+			return UtfStatus::invalid;
+		}
+
+		lo = 0x80u;
+		hi = 0xBFu;
+		cp = (cp << 6) | (b & 0x3Fu);
+	}
+
+	return UtfStatus::ok;
+}
+
+inline UtfStatus decode(const char16_t* it, const char16_t* end, char32_t& cp,
+		std::size_t& length) {
+	auto c = codeUnit(*it);
+	length = 1u;
+	if(c < 0xD800u || c > 0xDFFFu) {
+		cp = c;
+		return UtfStatus::ok;
+	}
+
+	if(c > 0xDBFFu) { // low surrogate without high surrogate
+		return UtfStatus::invalid;
+	}
+
+	if(end - it < 2) {
+		return UtfStatus::incomplete;
+	}
+
+	auto c2 = codeUnit(it[1]);
+	if(c2 < 0xDC00u || c2 > 0xDFFFu) {
+		return UtfStatus::invalid;
+	}
+
+	cp = 0x10000u + ((c - 0xD800u) << 10) + (c2 - 0xDC00u);
+	length = 2u;
+	return UtfStatus::ok;
+}
+
+inline UtfStatus decode(const char32_t* it, const char32_t*, char32_t& cp,
+		std::size_t& length) {
+	auto c = *it;
+	length = 1u;
+	if(c > 0x10FFFFu || (c >= 0xD800u && c <= 0xDFFFu)) {
+		return UtfStatus::invalid;
+	}
+
+	cp = c;
+	return UtfStatus::ok;
+}
+
+// Returns the number of code units needed to encode the given
+// (valid) code point.
+template<typename C>
+std::size_t encodedLength(char32_t cp) {
+	if constexpr(std::is_same_v<C, char>) {
+		return cp < 0x80u ? 1u : cp < 0x800u ? 2u : cp < 0x10000u ? 3u : 4u;
+	} else if constexpr(std::is_same_v<C, char16_t>) {
+		return cp < 0x10000u ? 1u : 2u;
+	} else {
+		return 1u;
+	}
+}
+
+inline void encode(char32_t cp, char* out) {
+	if(cp < 0x80u) {
+		out[0] = char(cp);
+	} else if(cp < 0x800u) {
+		out[0] = char(0xC0u | (cp >> 6));
+		out[1] = char(0x80u | (cp & 0x3Fu));
+	} else if(cp < 0x10000u) {
+		out[0] = char(0xE0u | (cp >> 12));
+		out[1] = char(0x80u | ((cp >> 6) & 0x3Fu));
+		out[2] = char(0x80u | (cp & 0x3Fu));
+	} else {
+		out[0] = char(0xF0u | (cp >> 18));
+		out[1] = char(0x80u | ((cp >> 12) & 0x3Fu));
+		out[2] = char(0x80u | ((cp >> 6) & 0x3Fu));
+		out[3] = char(0x80u | (cp & 0x3Fu));
+	}
+}
+
+inline void encode(char32_t cp, char16_t* out) {
+	if(cp < 0x10000u) {
+		out[0] = char16_t(cp);
+	} else {
+		cp -= 0x10000u;
+		out[0] = char16_t(0xD800u + (cp >> 10));
+		out[1] = char16_t(0xDC00u + (cp & 0x3FFu));
+	}
+}
+
+inline void encode(char32_t cp, char32_t* out) {
+	out[0] = cp;
+}
+
+// Whether the code unit is converted 1:1, i.e. ascii for conversions
+// from or to utf8 and non-surrogate units between utf16 and utf32.
+template<typename From, typename To>
+bool direct(From c) {
+	auto u = codeUnit(c);
+	if constexpr(std::is_same_v<From, char> || std::is_same_v<To, char>) {
+		return u < 0x80u;
+	} else {
+		return u < 0xD800u || (u > 0xDFFFu && u < 0x10000u);
+	}
+}
+
+#ifdef NYTL_SIMD_SSE2
+// Vectorized versions of copyDirect. Copy blocks as long as all units
+// in them can be converted directly, return the number of copied units.
+inline std::size_t copyDirectSimd(const char* in, char16_t* out, std::size_t n) {
+	auto zero = _mm_setzero_si128();
+	auto i = std::size_t(0u);
+	for(; i + 16 <= n; i += 16) {
+		auto v = loadUnaligned<__m128i>(in + i);
+		if(_mm_movemask_epi8(v)) {
+			break;
+		}
+
+		storeUnaligned(out + i, _mm_unpacklo_epi8(v, zero));
+		storeUnaligned(out + i + 8, _mm_unpackhi_epi8(v, zero));
+	}
+
+	return i;
+}
+
+inline std::size_t copyDirectSimd(const char* in, char32_t* out, std::size_t n) {
+	auto zero = _mm_setzero_si128();
+	auto i = std::size_t(0u);
+	for(; i + 16 <= n; i += 16) {
+		auto v = loadUnaligned<__m128i>(in + i);
+		if(_mm_movemask_epi8(v)) {
+			break;
+		}
+
+		auto lo = _mm_unpacklo_epi8(v, zero);
+		auto hi = _mm_unpackhi_epi8(v, zero);
+		storeUnaligned(out + i, _mm_unpacklo_epi16(lo, zero));
+		storeUnaligned(out + i + 4, _mm_unpackhi_epi16(lo, zero));
+		storeUnaligned(out + i + 8, _mm_unpacklo_epi16(hi, zero));
+		storeUnaligned(out + i + 12, _mm_unpackhi_epi16(hi, zero));
+	}
+
+	return i;
+}
+
+inline std::size_t copyDirectSimd(const char16_t* in, char* out, std::size_t n) {
+	auto mask = _mm_set1_epi16(short(0xFF80u));
+	auto i = std::size_t(0u);
+	for(; i + 16 <= n; i += 16) {
+		auto a = loadUnaligned<__m128i>(in + i);
+		auto b = loadUnaligned<__m128i>(in + i + 8);
+		auto high = _mm_and_si128(_mm_or_si128(a, b), mask);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF) {
+			break;
+		}
+
+		storeUnaligned(out + i, _mm_packus_epi16(a, b));
+	}
+
+	return i;
+}
+
+inline std::size_t copyDirectSimd(const char32_t* in, char* out, std::size_t n) {
+	auto mask = _mm_set1_epi32(int(0xFFFFFF80u));
+	auto i = std::size_t(0u);
+	for(; i + 16 <= n; i += 16) {
+		auto a = loadUnaligned<__m128i>(in + i);
+		auto b = loadUnaligned<__m128i>(in + i + 4);
+		auto c = loadUnaligned<__m128i>(in + i + 8);
+		auto d = loadUnaligned<__m128i>(in + i + 12);
+		auto high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), mask);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF) {
+			break;
+		}
+
+		storeUnaligned(out + i, _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+
+	return i;
+}
+
+inline std::size_t copyDirectSimd(const char16_t* in, char32_t* out, std::size_t n) {
+	auto zero = _mm_setzero_si128();
+	auto mask = _mm_set1_epi16(short(0xF800u));
+	auto surrogate = _mm_set1_epi16(short(0xD800u));
+	auto i = std::size_t(0u);
+	for(; i + 8 <= n; i += 8) {
+		auto v = loadUnaligned<__m128i>(in + i);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), surrogate))) {
+			break;
+		}
+
+		storeUnaligned(out + i, _mm_unpacklo_epi16(v, zero));
+		storeUnaligned(out + i + 4, _mm_unpackhi_epi16(v, zero));
+	}
+
+	return i;
+}
+
+inline std::size_t copyDirectSimd(const char32_t* in, char16_t* out, std::size_t n) {
+	auto zero = _mm_setzero_si128();
+	auto mask = _mm_set1_epi32(0xF800);
+	auto surrogate = _mm_set1_epi32(0xD800);
+	auto bias32 = _mm_set1_epi32(0x8000);
+	auto bias16 = _mm_set1_epi16(short(0x8000u));
+	auto i = std::size_t(0u);
+	for(; i + 8 <= n; i += 8) {
+		auto a = loadUnaligned<__m128i>(in + i);
+		auto b = loadUnaligned<__m128i>(in + i + 4);
+		auto large = _mm_srli_epi32(_mm_or_si128(a, b), 16);
+		auto surrogates = _mm_or_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(a, mask), surrogate),
+			_mm_cmpeq_epi32(_mm_and_si128(b, mask), surrogate));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(large, zero)) != 0xFFFF ||
+				_mm_movemask_epi8(surrogates)) {
+			break;
+		}
+
+		// there is no unsigned 32-to-16 bit pack in sse2, shift the
+		// values into the signed range and back
+		auto packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+		storeUnaligned(out + i, _mm_add_epi16(packed, bias16));
+	}
+
+	return i;
+}
+#endif // NYTL_SIMD_SSE2
+
+// Copies the longest prefix of units that can be converted 1:1.
+// Returns the number of copied units.
+template<typename From, typename To>
+std::size_t copyDirect(const From* in, std::size_t inSize, To* out, std::size_t outSize) {
+	auto n = std::min(inSize, outSize);
+	auto i = std::size_t(0u);
+#ifdef NYTL_SIMD_SSE2
+	i = copyDirectSimd(in, out, n);
+#endif
+
+	for(; i < n && direct<From, To>(in[i]); ++i) {
+		out[i] = To(codeUnit(in[i]));
+	}
+
+	return i;
+}
+
+template<typename From, typename To>
+UtfResult transcode(const From* in, std::size_t inSize, To* out, std::size_t outSize) {
+	UtfResult res;
+	while(res.read < inSize) {
+		auto n = copyDirect(in + res.read, inSize - res.read,
+			out + res.written, outSize - res.written);
+		res.read += n;
+		res.written += n;
+		if(res.read == inSize) {
+			break;
+		}
+
+		char32_t cp;
+		std::size_t length;
+		auto status = decode(in + res.read, in + inSize, cp, length);
+		if(status != UtfStatus::ok) {
+			res.status = status;
+			return res;
+		}
+
+		auto outLength = encodedLength<To>(cp);
+		if(outSize - res.written < outLength) {
+			res.status = UtfStatus::outputFull;
+			return res;
+		}
+
+		encode(cp, out + res.written);
+		res.read += length;
+		res.written += outLength;
+	}
+
+	return res;
+}
+
+// Converts the given string into a string of the given type.
+// The buffer is allocated once with the given size, which must be
+// sufficient for the result.
+template<typename Ret, typename From>
+Ret transcode(std::basic_string_view<From> in, std::size_t size, const char* func) {
+	using To = typename Ret::value_type;
+	Ret ret(size, To {});
+	auto res = transcode(in.data(), in.size(), ret.data(), ret.size());
+	if(res.status != UtfStatus::ok) {
+		throw std::range_error(std::string(func) + ": invalid input");
+	}
+
+	ret.resize(res.written);
+	return ret;
+}
+
+// Returns the number of utf8 code units needed to encode the given
+// (valid) string.
+template<typename C>
+std::size_t utf8Size(std::basic_string_view<C> str) {
+	auto size = std::size_t(0u);
+	for(auto c : str) {
+		auto u = codeUnit(c);
+		if constexpr(std::is_same_v<C, char16_t>) {
+			// each surrogate half makes up 2 of the 4 bytes
+			size += u < 0x80u ? 1u : (u < 0x800u || (u >= 0xD800u && u <= 0xDFFFu)) ? 2u : 3u;
+		} else {
+			size += encodedLength<char>(u);
+		}
+	}
+
+	return size;
+}
+
+} // namespace detail
+
 /// \brief Converts the given utf16 string to a utf8 string.
+/// \throws std::range_error for invalid input, e.g. unpaired surrogates.
 inline std::string toUtf8(std::u16string_view utf16) {
-	std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
-	return converter.to_bytes(utf16.begin(), utf16.end());
+	return detail::transcode<std::string>(utf16, detail::utf8Size(utf16), "nytl::toUtf8");
 }
 
 /// \brief Converts the given utf32 string to a utf8 string.
+/// \throws std::range_error for invalid input, e.g. surrogates or
+/// values above U+10FFFF.
 inline std::string toUtf8(std::u32string_view utf32) {
-	std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> converter;
-	return converter.to_bytes(utf32.begin(), utf32.end());
+	return detail::transcode<std::string>(utf32, detail::utf8Size(utf32), "nytl::toUtf8");
 }
 
 /// \brief Converts the given utf8 string to a utf16 string.
+/// \throws std::range_error for invalid input, see validUtf8.
 inline std::u16string toUtf16(std::string_view utf8) {
-	std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
-	return converter.from_bytes(utf8.begin(), utf8.end());
+	return detail::transcode<std::u16string>(utf8, utf8.size(), "nytl::toUtf16");
 }
 
 /// \brief Converts the given utf32 string to a utf16 string.
+/// \throws std::range_error for invalid input.
 inline std::u16string toUtf16(std::u32string_view utf32) {
-	return toUtf16(toUtf8(utf32));
+	return detail::transcode<std::u16string>(utf32, 2 * utf32.size(), "nytl::toUtf16");
 }
 
 /// \brief Converts the given utf8 string to a utf32 string.
+/// \throws std::range_error for invalid input, see validUtf8.
 inline std::u32string toUtf32(std::string_view utf8) {
-	std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> converter;
-	return converter.from_bytes(utf8.begin(), utf8.end());
+	return detail::transcode<std::u32string>(utf8, utf8.size(), "nytl::toUtf32");
 }
 
 /// \brief Converts the given utf16 string to a utf32 string.
+/// \throws std::range_error for invalid input.
 inline std::u32string toUtf32(std::u16string_view utf16) {
-	return toUtf32(toUtf8(utf16));
+	return detail::transcode<std::u32string>(utf16, utf16.size(), "nytl::toUtf32");
+}
+
+/// \brief Converts the given utf16 string into the given buffer.
+/// Converts as much as possible, characters are never split.
+/// Stops at invalid or incomplete input or when the buffer is full,
+/// see UtfResult. Does not allocate.
+inline UtfResult toUtf8(std::u16string_view utf16, span<char> out) {
+	return detail::transcode(utf16.data(), utf16.size(), out.data(), out.size());
+}
+
+/// \brief Converts the given utf32 string into the given buffer.
+/// See toUtf8(std::u16string_view, span<char>).
+inline UtfResult toUtf8(std::u32string_view utf32, span<char> out) {
+	return detail::transcode(utf32.data(), utf32.size(), out.data(), out.size());
+}
+
+/// \brief Converts the given utf8 string into the given buffer.
+/// See toUtf8(std::u16string_view, span<char>).
+inline UtfResult toUtf16(std::string_view utf8, span<char16_t> out) {
+	return detail::transcode(utf8.data(), utf8.size(), out.data(), out.size());
+}
+
+/// \brief Converts the given utf32 string into the given buffer.
+/// See toUtf8(std::u16string_view, span<char>).
+inline UtfResult toUtf16(std::u32string_view utf32, span<char16_t> out) {
+	return detail::transcode(utf32.data(), utf32.size(), out.data(), out.size());
+}
+
+/// \brief Converts the given utf8 string into the given buffer.
+/// See toUtf8(std::u16string_view, span<char>).
+inline UtfResult toUtf32(std::string_view utf8, span<char32_t> out) {
+	return detail::transcode(utf8.data(), utf8.size(), out.data(), out.size());
+}
+
+/// \brief Converts the given utf16 string into the given buffer.
+/// See toUtf8(std::u16string_view, span<char>).
+inline UtfResult toUtf32(std::u16string_view utf16, span<char32_t> out) {
+	return detail::transcode(utf16.data(), utf16.size(), out.data(), out.size());
 }
 
 } // namespace nytl
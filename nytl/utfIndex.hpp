@@ -0,0 +1,265 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the Utf8Index class for fast character lookups in large utf8 strings.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_UTF_INDEX
+#define NYTL_INCLUDE_UTF_INDEX
+
+#include <nytl/utf.hpp> // nytl::charCount
+
+#include <string_view> // std::string_view
+#include <vector> // std::vector
+#include <algorithm> // std::upper_bound, std::lower_bound
+#include <stdexcept> // std::out_of_range, std::invalid_argument
+#include <cstddef> // std::size_t
+
+namespace nytl {
+
+/// \brief Index over a utf8 string to find characters by their index (and
+/// vice versa) without scanning the string from the beginning.
+/// Divides the string into blocks of at most blockSize bytes and stores the
+/// byte offset and the number of characters before each block. Lookups
+/// therefore take O(log(n / blockSize) + blockSize).
+/// Blocks are kept at least blockSize / 2 bytes large (unless the whole
+/// string is smaller), also when the index is updated.
+/// The counts are computed with nytl::charCount, i.e. every byte that is not
+/// a utf8 continuation byte counts as character. For valid utf8 this matches
+/// nytl::nth, but malformed input never results in out-of-range accesses.
+/// Does not copy the string. When the string is changed, the index must be
+/// updated, local edits only recount the affected blocks.
+class Utf8Index {
+public:
+	static constexpr std::size_t defaultBlockSize = 256u;
+
+public:
+	/// Builds the index for the given string.
+	/// \throws std::invalid_argument if blockSize is zero.
+	explicit Utf8Index(std::string_view str = {},
+			std::size_t blockSize = defaultBlockSize) : blockSize_(blockSize) {
+		if(blockSize == 0u) {
+			throw std::invalid_argument("nytl::Utf8Index: blockSize must not be zero");
+		}
+
+		rebuild(str);
+	}
+
+	/// Rebuilds the index for the given string.
+	inline void rebuild(std::string_view str);
+
+	/// Updates the index after the string was changed by replacing 'removed'
+	/// bytes at the given offset with 'inserted' bytes. The given string must
+	/// be the changed one (it may have been moved in memory).
+	/// Takes O(n / blockSize + blockSize + inserted).
+	/// \throws std::out_of_range if the changed range is not inside the old string
+	/// or the sizes don't match.
+	inline void update(std::string_view str, std::size_t offset,
+		std::size_t removed, std::size_t inserted);
+
+	/// Returns the byte offset at which the character with the given index starts.
+	/// For n == charCount(), returns the size of the string.
+	/// \throws std::out_of_range if n > charCount()
+	inline std::size_t offset(std::size_t n) const;
+
+	/// Returns the character with the given index, see nytl::nth.
+	/// \throws std::out_of_range if n >= charCount()
+	inline std::string_view nth(std::size_t n) const;
+
+	/// Returns the number of characters starting before the given byte offset,
+	/// i.e. the index of the character starting at the offset.
+	/// \throws std::out_of_range if byteOffset > string().size()
+	inline std::size_t charIndex(std::size_t byteOffset) const;
+
+	/// Returns the number of characters in the string in O(1).
+	std::size_t charCount() const noexcept { return chars_.back(); }
+
+	const std::string_view& string() const noexcept { return str_; }
+	std::size_t blockSize() const noexcept { return blockSize_; }
+
+	/// Returns the number of blocks.
+	std::size_t blockCount() const noexcept { return bytes_.size() - 1; }
+
+protected:
+	// Splits the range [begin, end) of str_ into blocks of equal size (at
+	// most blockSize_ and at least blockSize_ / 2 if the range is
+	// large enough), appends their start offsets and character counts
+	// (relative to begin) to the given vectors.
+	// Returns the number of characters in the range.
+	inline std::size_t split(std::size_t begin, std::size_t end,
+		std::vector<std::size_t>& bytes, std::vector<std::size_t>& chars) const;
+
+	std::string_view str_;
+	std::size_t blockSize_;
+
+	// Start offset and number of characters before each block.
+	// Has an additional entry for the end of the string, i.e. the
+	// last entries hold the size and character count of the string.
+	std::vector<std::size_t> bytes_ {0u, 0u};
+	std::vector<std::size_t> chars_ {0u, 0u};
+};
+
+// - implementation -
+std::size_t Utf8Index::split(std::size_t begin, std::size_t end,
+		std::vector<std::size_t>& bytes, std::vector<std::size_t>& chars) const {
+	auto size = end - begin;
+	auto blocks = size / blockSize_ + (size % blockSize_ != 0u);
+	auto count = std::size_t(0u);
+	auto off = begin;
+	for(auto i = std::size_t(0u); i < blocks; ++i) {
+		// distribute the remainder over the first blocks
+		auto length = size / blocks + (i < size % blocks);
+		bytes.push_back(off);
+		chars.push_back(count);
+		count += nytl::charCount(str_.substr(off, length));
+		off += length;
+	}
+
+	return count;
+}
+
+void Utf8Index::rebuild(std::string_view str) {
+	str_ = str;
+	bytes_.clear();
+	chars_.clear();
+
+	auto count = split(0u, str.size(), bytes_, chars_);
+	if(bytes_.empty()) { // we always have at least one block
+		bytes_.push_back(0u);
+		chars_.push_back(0u);
+	}
+
+	bytes_.push_back(str.size());
+	chars_.push_back(count);
+}
+
+void Utf8Index::update(std::string_view str, std::size_t offset,
+		std::size_t removed, std::size_t inserted) {
+	auto oldSize = bytes_.back();
+	if(offset > oldSize || removed > oldSize - offset ||
+			str.size() != oldSize - removed + inserted) {
+		throw std::out_of_range("nytl::Utf8Index::update: invalid range");
+	}
+
+	str_ = str;
+
+	// the blocks [first, last) overlap the changed range and are split again,
+	// all blocks after them are just shifted
+	auto first = std::size_t(std::upper_bound(bytes_.begin(), bytes_.end() - 1, offset) -
+		bytes_.begin() - 1);
+	auto last = std::size_t(std::lower_bound(bytes_.begin() + first + 1, bytes_.end(),
+		offset + removed) - bytes_.begin());
+
+	// merge too small ranges with the neighbor blocks, otherwise
+	// edits would split the string into more and more small blocks
+	auto newEnd = [&]{ return bytes_[last] - removed + inserted; };
+	while(newEnd() - bytes_[first] < blockSize_) {
+		if(last + 1 < bytes_.size()) {
+			++last;
+		} else if(first > 0u) {
+			--first;
+		} else {
+			break;
+		}
+	}
+
+	auto begin = bytes_[first];
+	auto end = newEnd();
+	auto oldCount = chars_[last] - chars_[first];
+
+	std::vector<std::size_t> bytes, chars;
+	auto count = split(begin, end, bytes, chars);
+	if(bytes.empty()) { // the string is empty, we always have one block
+		bytes.push_back(begin);
+		chars.push_back(0u);
+	}
+
+	for(auto& c : chars) {
+		c += chars_[first];
+	}
+
+	// shift the following blocks
+	for(auto i = last; i < bytes_.size(); ++i) {
+		bytes_[i] = bytes_[i] - removed + inserted;
+		chars_[i] = chars_[i] - oldCount + count;
+	}
+
+	bytes_.erase(bytes_.begin() + first, bytes_.begin() + last);
+	chars_.erase(chars_.begin() + first, chars_.begin() + last);
+	bytes_.insert(bytes_.begin() + first, bytes.begin(), bytes.end());
+	chars_.insert(chars_.begin() + first, chars.begin(), chars.end());
+}
+
+std::size_t Utf8Index::offset(std::size_t n) const {
+	if(n >= charCount()) {
+		if(n == charCount()) {
+			return str_.size();
+		}
+
+		throw std::out_of_range("nytl::Utf8Index::offset");
+	}
+
+	// the last block with less than n characters before it contains char n
+	auto block = std::size_t(std::upper_bound(chars_.begin(), chars_.end(), n) -
+		chars_.begin() - 1);
+	auto off = bytes_[block];
+	auto remaining = n - chars_[block];
+
+	// skip larger chunks using the vectorized count first
+	constexpr auto chunk = std::size_t(64u);
+	while(true) {
+		auto count = nytl::charCount(str_.substr(off, chunk));
+		if(count > remaining) {
+			break;
+		}
+
+		remaining -= count;
+		off += chunk;
+	}
+
+	// char n is the first non-continuation byte after skipping 'remaining'
+	for(;; ++off) {
+		if((static_cast<unsigned char>(str_[off]) & 0xC0u) != 0x80u) {
+			if(remaining == 0u) {
+				return off;
+			}
+
+			--remaining;
+		}
+	}
+}
+
+std::string_view Utf8Index::nth(std::size_t n) const {
+	if(n >= charCount()) {
+		throw std::out_of_range("nytl::Utf8Index::nth");
+	}
+
+	auto off = offset(n);
+	auto end = off + 1;
+	while(end < str_.size() && (static_cast<unsigned char>(str_[end]) & 0xC0u) == 0x80u) {
+		++end;
+	}
+
+	return str_.substr(off, end - off);
+}
+
+std::size_t Utf8Index::charIndex(std::size_t byteOffset) const {
+	if(byteOffset > str_.size()) {
+		throw std::out_of_range("nytl::Utf8Index::charIndex");
+	}
+
+	auto block = std::size_t(std::upper_bound(bytes_.begin(), bytes_.end(), byteOffset) -
+		bytes_.begin() - 1);
+	if(block == bytes_.size() - 1) {
+		return charCount();
+	}
+
+	auto begin = bytes_[block];
+	return chars_[block] + nytl::charCount(str_.substr(begin, byteOffset - begin));
+}
+
+} // namespace nytl
+
+#endif // header guard
@@ -0,0 +1,221 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the UtfTranscoder class for converting chunked utf input.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_UTF_STREAM
+#define NYTL_INCLUDE_UTF_STREAM
+
+#include <nytl/utf.hpp> // nytl::UtfResult, nytl::detail::transcode
+#include <nytl/span.hpp> // nytl::span
+
+#include <string_view> // std::basic_string_view
+#include <type_traits> // std::is_same_v
+#include <algorithm> // std::min, std::copy_n
+#include <cstddef> // std::size_t
+
+namespace nytl {
+
+/// How a UtfTranscoder handles invalid input.
+enum class UtfErrorMode {
+	replace, // every invalid sequence is replaced with U+FFFD
+	strict, // invalid input stops the conversion
+};
+
+/// \brief Stateful converter between utf encodings for input arriving in chunks,
+/// e.g. from a file or socket. Chunks may end anywhere, partial characters
+/// are carried over to the next chunk. The result does not depend on how
+/// the input is split into chunks.
+/// Writes into caller-provided buffers and never allocates.
+/// Invalid sequences are handled as specified by the error mode. In replace
+/// mode, each maximal subpart of an invalid sequence (as defined by the unicode
+/// standard) is replaced by one U+FFFD.
+/// \tparam From The input code unit type, char, char16_t or char32_t.
+/// \tparam To The output code unit type, char, char16_t or char32_t.
+template<typename From, typename To>
+class UtfTranscoder {
+public:
+	static_assert(!std::is_same_v<From, To>, "nytl::UtfTranscoder: same encodings");
+
+	static constexpr char32_t replacement = 0xFFFDu;
+	static constexpr std::size_t maxPending = 4u;
+
+public:
+	explicit UtfTranscoder(UtfErrorMode mode = UtfErrorMode::replace) noexcept :
+		mode_(mode) {}
+
+	/// Converts as much of the given chunk as possible into the given buffer.
+	/// The returned result holds the number of consumed input and produced
+	/// output code units:
+	/// - ok: the whole chunk was consumed. A partial character at the end of
+	///   the chunk was consumed and will be completed by the next chunk.
+	/// - outputFull: the buffer was not large enough. Call again with
+	///   the remaining input. Buffers must have space for at least
+	///   one character (4 code units are always enough) to make progress.
+	/// - invalid: only in strict mode, there was an invalid sequence.
+	///   The input up to 'read' was converted. The transcoder stays in the
+	///   failed state until it is reset.
+	UtfResult convert(std::basic_string_view<From> chunk, span<To> out);
+
+	/// Signals the end of the input. Handles a partial character left over
+	/// from the last chunk like an invalid sequence. Afterwards, the transcoder
+	/// can be used for the next input. Might return outputFull, in which case
+	/// it must be called again with more space.
+	UtfResult finish(span<To> out);
+
+	/// Resets the transcoder, drops a pending partial character and
+	/// leaves the failed state.
+	void reset() noexcept {
+		pendingSize_ = 0u;
+		failed_ = false;
+	}
+
+	/// Returns whether a partial character from the last chunk is pending.
+	bool pending() const noexcept { return pendingSize_ != 0u; }
+
+	/// Returns whether invalid input was found in strict mode.
+	bool failed() const noexcept { return failed_; }
+
+	UtfErrorMode mode() const noexcept { return mode_; }
+
+protected:
+	// Handles an invalid sequence at the current position. Returns false
+	// if the conversion has to be stopped, res.status is set then.
+	bool handleInvalid(UtfResult& res, span<To> out);
+
+	UtfErrorMode mode_;
+	bool failed_ {};
+	std::size_t pendingSize_ {};
+	From pending_[maxPending] {}; // partial character from the last chunk
+};
+
+/// Converts utf8 chunks to utf16 or utf32.
+template<typename To = char32_t>
+using Utf8Decoder = UtfTranscoder<char, To>;
+
+/// Converts utf16 or utf32 chunks to utf8.
+template<typename From = char32_t>
+using Utf8Encoder = UtfTranscoder<From, char>;
+
+// - implementation -
+template<typename From, typename To>
+bool UtfTranscoder<From, To>::handleInvalid(UtfResult& res, span<To> out) {
+	if(mode_ == UtfErrorMode::strict) {
+		failed_ = true;
+		res.status = UtfStatus::invalid;
+		return false;
+	}
+
+	auto length = detail::encodedLength<To>(replacement);
+	if(std::size_t(out.size()) - res.written < length) {
+		res.status = UtfStatus::outputFull;
+		return false;
+	}
+
+	detail::encode(replacement, out.data() + res.written);
+	res.written += length;
+	return true;
+}
+
+template<typename From, typename To>
+UtfResult UtfTranscoder<From, To>::convert(std::basic_string_view<From> in,
+		span<To> out) {
+	UtfResult res;
+	if(failed_) {
+		res.status = UtfStatus::invalid;
+		return res;
+	}
+
+	// complete the partial character from the last chunk first.
+	// Since the pending units are an incomplete but valid prefix, a complete
+	// or invalid sequence always ends in the new chunk
+	if(pendingSize_) {
+		From buf[maxPending];
+		auto count = std::min(in.size(), maxPending - pendingSize_);
+		std::copy_n(pending_, pendingSize_, buf);
+		std::copy_n(in.data(), count, buf + pendingSize_);
+
+		char32_t cp;
+		std::size_t length;
+		auto status = detail::decode(buf, buf + pendingSize_ + count, cp, length);
+		if(status == UtfStatus::incomplete) {
+			std::copy_n(in.data(), count, pending_ + pendingSize_);
+			pendingSize_ += count;
+			res.read = count;
+			return res;
+		}
+
+		if(status == UtfStatus::invalid) {
+			if(!handleInvalid(res, out)) {
+				return res;
+			}
+		} else {
+			auto outLength = detail::encodedLength<To>(cp);
+			if(std::size_t(out.size()) < outLength) {
+				res.status = UtfStatus::outputFull;
+				return res;
+			}
+
+			detail::encode(cp, out.data());
+			res.written = outLength;
+		}
+
+		res.read = length - pendingSize_;
+		pendingSize_ = 0u;
+	}
+
+	while(res.read < in.size()) {
+		auto r = detail::transcode(in.data() + res.read, in.size() - res.read,
+			out.data() + res.written, std::size_t(out.size()) - res.written);
+		res.read += r.read;
+		res.written += r.written;
+		if(r.status == UtfStatus::ok) {
+			break;
+		} else if(r.status == UtfStatus::outputFull) {
+			res.status = r.status;
+			return res;
+		} else if(r.status == UtfStatus::incomplete) {
+			pendingSize_ = in.size() - res.read;
+			std::copy_n(in.data() + res.read, pendingSize_, pending_);
+			res.read = in.size();
+			break;
+		}
+
+		char32_t cp;
+		std::size_t length;
+		detail::decode(in.data() + res.read, in.data() + in.size(), cp, length);
+		if(!handleInvalid(res, out)) {
+			return res;
+		}
+
+		res.read += length;
+	}
+
+	return res;
+}
+
+template<typename From, typename To>
+UtfResult UtfTranscoder<From, To>::finish(span<To> out) {
+	UtfResult res;
+	if(failed_) {
+		res.status = UtfStatus::invalid;
+		return res;
+	}
+
+	if(pendingSize_) {
+		if(!handleInvalid(res, out)) {
+			return res;
+		}
+
+		pendingSize_ = 0u;
+	}
+
+	return res;
+}
+
+} // namespace nytl
+
+#endif // header guard
@@ -14,6 +14,9 @@
 // specializations
 #include <nytl/vec2.hpp> // nytl::Vec<2, T>
 #include <nytl/vec3.hpp> // nytl::Vec<3, T>
+#include <nytl/vec4.hpp> // nytl::Vec<4, T>
+
+#include <nytl/simd.hpp> // nytl::detail::simd
 
 #include <array> // std::array
 #include <algorithm> // std::min
@@ -52,6 +55,13 @@ Vec(Args&&... args) ->
 // - free operators -
 template<size_t D, typename T1, typename T2>
 constexpr Vec<D, T1>& operator+=(Vec<D, T1>& a, const Vec<D, T2>& b) {
+	if constexpr(detail::simd::vec4<D, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::add4(a.data(), b.data());
+			return a;
+		}
+	}
+
 	for(size_t i = 0; i < D; ++i)
 		a[i] += b[i];
 	return a;
@@ -59,6 +69,13 @@ constexpr Vec<D, T1>& operator+=(Vec<D, T1>& a, const Vec<D, T2>& b) {
 
 template<size_t D, typename T1, typename T2>
 constexpr Vec<D, T1>& operator-=(Vec<D, T1>& a, const Vec<D, T2>& b) {
+	if constexpr(detail::simd::vec4<D, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::sub4(a.data(), b.data());
+			return a;
+		}
+	}
+
 	for(size_t i = 0; i < D; ++i)
 		a[i] -= b[i];
 	return a;
@@ -66,6 +83,13 @@ constexpr Vec<D, T1>& operator-=(Vec<D, T1>& a, const Vec<D, T2>& b) {
 
 template<size_t D, typename T, typename F>
 constexpr Vec<D, T>& operator*=(Vec<D, T>& vec, const F& fac) {
+	if constexpr(detail::simd::vec4<D, T, F>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::scale4(vec.data(), fac);
+			return vec;
+		}
+	}
+
 	for(auto i = 0u; i < D; ++i)
 		vec[i] *= fac;
 	return vec;
@@ -73,6 +97,14 @@ constexpr Vec<D, T>& operator*=(Vec<D, T>& vec, const F& fac) {
 
 template<size_t D, typename T1, typename T2>
 constexpr auto operator+(const Vec<D, T1>& a, const Vec<D, T2>& b) {
+	if constexpr(detail::simd::vec4<D, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			auto ret = a;
+			detail::simd::add4(ret.data(), b.data());
+			return ret;
+		}
+	}
+
 	Vec<D, decltype(a[0] + b[0])> ret {};
 	for(auto i = 0u; i < D; ++i)
 		ret[i] = a[i] + b[i];
@@ -81,6 +113,14 @@ constexpr auto operator+(const Vec<D, T1>& a, const Vec<D, T2>& b) {
 
 template<size_t D, typename T1, typename T2>
 constexpr auto operator-(const Vec<D, T1>& a, const Vec<D, T2>& b) {
+	if constexpr(detail::simd::vec4<D, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			auto ret = a;
+			detail::simd::sub4(ret.data(), b.data());
+			return ret;
+		}
+	}
+
 	Vec<D, decltype(a[0] - b[0])> ret {};
 	for(auto i = 0u; i < D; ++i)
 		ret[i] = a[i] - b[i];
@@ -102,6 +142,14 @@ constexpr auto operator+(const Vec<D, T>& a) {
 template<size_t D, typename F, typename T>
 constexpr auto operator*(const F& f, const Vec<D, T>& a)
 		-> Vec<D, decltype(f * a[0])> {
+	if constexpr(detail::simd::vec4<D, T, F>) {
+		if(!detail::constantEvaluated()) {
+			auto ret = a;
+			detail::simd::scale4(ret.data(), f);
+			return ret;
+		}
+	}
+
 	Vec<D, decltype(f * a[0])> ret {};
 	for(auto i = 0u; i < D; ++i)
 		ret[i] = f * a[i];
@@ -0,0 +1,198 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Batched versions of the vecOps.hpp operations on spans of vectors.
+/// All operations take their input vectors as span<const Vec<D, T>> (from
+/// which the dimension and value type are deduced) and write the results
+/// into an output span of the same size, otherwise std::invalid_argument
+/// is thrown. The output span may alias an input span.
+/// Compared to calling the single-vector operations in a loop, these
+/// process many vectors at once, i.e. with NYTL_SIMD enabled, the widest
+/// SIMD registers available (SSE2/NEON, AVX or AVX-512, see nytl/simd.hpp)
+/// are used for float and double. The results match the ones of the
+/// single-vector operations, other types just use the scalar loops.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_VEC_BATCH
+#define NYTL_INCLUDE_VEC_BATCH
+
+#include <nytl/vec.hpp> // nytl::Vec
+#include <nytl/span.hpp> // nytl::span
+#include <nytl/simd.hpp> // nytl::detail::simd
+#include <nytl/tmpUtil.hpp> // nytl::NonDeduced
+
+#include <cmath> // std::sqrt
+#include <algorithm> // std::copy
+#include <stdexcept> // std::invalid_argument
+
+namespace nytl {
+namespace detail {
+	template<typename... S>
+	void checkBatchSizes(const char* func, size_t size, const S&... others) {
+		if(((others.size() != size) || ...)) {
+			throw std::invalid_argument(func);
+		}
+	}
+
+	// Vec<D, T> has the layout of T[D], so spans of vectors can be
+	// processed as flat arrays of values.
+	template<size_t D, typename T>
+	T* flat(span<Vec<D, T>> vecs) {
+		static_assert(sizeof(Vec<D, T>) == D * sizeof(T));
+		return reinterpret_cast<T*>(vecs.data());
+	}
+
+	template<size_t D, typename T>
+	const T* flat(span<const Vec<D, T>> vecs) {
+		static_assert(sizeof(Vec<D, T>) == D * sizeof(T));
+		return reinterpret_cast<const T*>(vecs.data());
+	}
+
+	// Copies in to out if they don't alias.
+	template<size_t D, typename T>
+	void copyBatch(span<const Vec<D, T>> in, span<Vec<D, T>> out) {
+		if(in.data() != out.data()) {
+			std::copy(in.begin(), in.end(), out.begin());
+		}
+	}
+} // namespace detail
+
+/// out[i] = dot(a[i], b[i])
+template<size_t D, typename T>
+void dot(span<const Vec<D, T>> a, span<const NonDeduced<Vec<D, T>>> b,
+		span<NonDeduced<T>> out) {
+	detail::checkBatchSizes("nytl::dot", a.size(), b, out);
+	detail::simd::dotV<D>(out.data(), detail::flat(a), detail::flat(b), a.size());
+}
+
+/// out[i] = length(a[i])
+template<size_t D, typename T>
+void length(span<const Vec<D, T>> a, span<NonDeduced<T>> out) {
+	dot(a, a, out);
+	detail::simd::sqrtN(out.data(), out.size());
+}
+
+/// out[i] = distance(a[i], b[i])
+template<size_t D, typename T>
+void distance(span<const Vec<D, T>> a, span<const NonDeduced<Vec<D, T>>> b,
+		span<NonDeduced<T>> out) {
+	detail::checkBatchSizes("nytl::distance", a.size(), b, out);
+	detail::simd::distanceV<D>(out.data(), detail::flat(a),
+		detail::flat(b), a.size());
+}
+
+/// out[i] = normalized(a[i])
+/// Undefined for null vectors.
+template<size_t D, typename T>
+void normalized(span<const Vec<D, T>> a, span<NonDeduced<Vec<D, T>>> out) {
+	detail::checkBatchSizes("nytl::normalized", a.size(), out);
+	detail::simd::normalizeV<D>(detail::flat(out), detail::flat(a), a.size());
+}
+
+/// Normalizes all given vectors in place.
+/// Undefined for null vectors.
+template<size_t D, typename T>
+void normalize(span<Vec<D, T>> a) {
+	detail::simd::normalizeV<D>(detail::flat(a), detail::flat(a), a.size());
+}
+
+/// out[i] = cross(a[i], b[i])
+template<typename T>
+void cross(span<const Vec<3, T>> a, span<const NonDeduced<Vec<3, T>>> b,
+		span<NonDeduced<Vec<3, T>>> out) {
+	detail::checkBatchSizes("nytl::cross", a.size(), b, out);
+	detail::simd::crossV(detail::flat(out), detail::flat(a),
+		detail::flat(b), a.size());
+}
+
+/// out[i] = mix(a[i], b[i], t)
+template<size_t D, typename T>
+void mix(span<const Vec<D, T>> a, span<const NonDeduced<Vec<D, T>>> b,
+		NonDeduced<T> t, span<NonDeduced<Vec<D, T>>> out) {
+	detail::checkBatchSizes("nytl::mix", a.size(), b, out);
+	auto n = a.size() * D;
+	if(out.data() == b.data()) {
+		detail::simd::scaleN(detail::flat(out), t, n);
+		detail::simd::axpyN(detail::flat(out), T(1 - t), detail::flat(a), n);
+	} else {
+		detail::copyBatch(a, out);
+		detail::simd::scaleN(detail::flat(out), T(1 - t), n);
+		detail::simd::axpyN(detail::flat(out), t, detail::flat(b), n);
+	}
+}
+
+namespace vec {
+namespace cw {
+
+/// out[i] = vec::cw::clamp(in[i], low, high)
+template<size_t D, typename T>
+void clamp(span<const Vec<D, T>> in, NonDeduced<T> low, NonDeduced<T> high,
+		span<NonDeduced<Vec<D, T>>> out) {
+	nytl::detail::checkBatchSizes("nytl::vec::cw::clamp", in.size(), out);
+	nytl::detail::copyBatch(in, out);
+	nytl::detail::simd::clampN(nytl::detail::flat(out), low, high, out.size() * D);
+}
+
+/// out[i] = vec::cw::clamp(in[i], low, high)
+template<size_t D, typename T>
+void clamp(span<const Vec<D, T>> in, const NonDeduced<Vec<D, T>>& low,
+		const NonDeduced<Vec<D, T>>& high, span<NonDeduced<Vec<D, T>>> out) {
+	nytl::detail::checkBatchSizes("nytl::vec::cw::clamp", in.size(), out);
+	nytl::detail::copyBatch(in, out);
+
+	// Bounds repeated for a block of vectors, so the flat kernel can be used.
+	constexpr auto blockVecs = 64u;
+	T lows[blockVecs * D];
+	T highs[blockVecs * D];
+	for(auto i = 0u; i < blockVecs * D; ++i) {
+		lows[i] = low[i % D];
+		highs[i] = high[i % D];
+	}
+
+	auto vals = nytl::detail::flat(out);
+	for(auto off = 0u; off < out.size(); off += blockVecs) {
+		auto count = std::min<size_t>(blockVecs, out.size() - off);
+		nytl::detail::simd::clampN(vals + off * D, lows, highs, count * D);
+	}
+}
+
+// Batched versions of the component-wise utility functions.
+// out[i] = vec::cw::func(in[i])
+// Only abs and sqrt have SIMD implementations.
+#define NYTL_VEC_BATCH_UTIL_FUNC(func, kernel) \
+	template<size_t D, typename T> \
+	void func(span<const Vec<D, T>> in, span<NonDeduced<Vec<D, T>>> out) { \
+		nytl::detail::checkBatchSizes("nytl::vec::cw::" #func, in.size(), out); \
+		nytl::detail::copyBatch(in, out); \
+		auto vals = nytl::detail::flat(out); \
+		auto n = out.size() * D; \
+		kernel \
+	}
+
+#define NYTL_VEC_BATCH_SCALAR(func) \
+	for(auto i = 0u; i < n; ++i) vals[i] = std::func(vals[i]);
+
+NYTL_VEC_BATCH_UTIL_FUNC(abs, nytl::detail::simd::absN(vals, n);)
+NYTL_VEC_BATCH_UTIL_FUNC(sqrt, nytl::detail::simd::sqrtN(vals, n);)
+NYTL_VEC_BATCH_UTIL_FUNC(sin, NYTL_VEC_BATCH_SCALAR(sin))
+NYTL_VEC_BATCH_UTIL_FUNC(cos, NYTL_VEC_BATCH_SCALAR(cos))
+NYTL_VEC_BATCH_UTIL_FUNC(tan, NYTL_VEC_BATCH_SCALAR(tan))
+NYTL_VEC_BATCH_UTIL_FUNC(asin, NYTL_VEC_BATCH_SCALAR(asin))
+NYTL_VEC_BATCH_UTIL_FUNC(acos, NYTL_VEC_BATCH_SCALAR(acos))
+NYTL_VEC_BATCH_UTIL_FUNC(atan, NYTL_VEC_BATCH_SCALAR(atan))
+NYTL_VEC_BATCH_UTIL_FUNC(log, NYTL_VEC_BATCH_SCALAR(log))
+NYTL_VEC_BATCH_UTIL_FUNC(exp, NYTL_VEC_BATCH_SCALAR(exp))
+NYTL_VEC_BATCH_UTIL_FUNC(exp2, NYTL_VEC_BATCH_SCALAR(exp2))
+NYTL_VEC_BATCH_UTIL_FUNC(floor, NYTL_VEC_BATCH_SCALAR(floor))
+NYTL_VEC_BATCH_UTIL_FUNC(ceil, NYTL_VEC_BATCH_SCALAR(ceil))
+
+#undef NYTL_VEC_BATCH_SCALAR
+#undef NYTL_VEC_BATCH_UTIL_FUNC
+
+} // namespace cw
+} // namespace vec
+} // namespace nytl
+
+#endif // header guard
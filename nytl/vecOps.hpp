@@ -14,6 +14,7 @@
 #include <nytl/vec.hpp>
 #include <nytl/tmpUtil.hpp> // nytl::templatize
 #include <nytl/math.hpp> // nytl::accumulate
+#include <nytl/simd.hpp> // nytl::detail::simd
 
 #include <cmath> // std::acos
 #include <iosfwd> // std::ostream
@@ -44,6 +45,12 @@ constexpr auto multiply(const Vec<D, T>& a) {
 /// not automatically handle the dot definition for other structures.
 template<size_t D, typename T1, typename T2>
 constexpr auto dot(const Vec<D, T1>& a, const Vec<D, T2>& b) {
+	if constexpr(detail::simd::vec4<D, T1, T2>) {
+		if(!detail::constantEvaluated()) {
+			return detail::simd::dot4(a.data(), b.data());
+		}
+	}
+
 	decltype(a[0] * b[0] + a[0] * b[0]) ret {0};
 	for(auto i = 0u; i < D; ++i)
 		ret += a[i] * b[i];
@@ -228,6 +235,13 @@ namespace cw { // vec component-wise operations
 /// Returns a vector holding the component-wise maximum of the given vectors.
 template<size_t D, typename T>
 constexpr auto max(Vec<D, T> a, const Vec<D, T>& b) {
+	if constexpr(detail::simd::vec4<D, T>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::max4(a.data(), b.data());
+			return a;
+		}
+	}
+
 	for(auto i = 0u; i < D; ++i)
 		if(b[i] > a[i])
 			a[i] = b[i];
@@ -245,6 +259,13 @@ constexpr auto max(Vec<D, T> a, const T& b) {
 /// Returns a vector holding the component-wise minimum of the given vectors.
 template<size_t D, typename T>
 constexpr auto min(Vec<D, T> a, const Vec<D, T>& b) {
+	if constexpr(detail::simd::vec4<D, T>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::min4(a.data(), b.data());
+			return a;
+		}
+	}
+
 	for(auto i = 0u; i < D; ++i)
 		if(b[i] < a[i])
 			a[i] = b[i];
@@ -385,6 +406,13 @@ constexpr void pow(Vec<D, T1>& a, const Vec<D, T2>& b) {
 
 template<size_t D, typename T>
 constexpr void clamp(Vec<D, T>& a, T low, T high) {
+	if constexpr(detail::simd::vec4<D, T>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::clamp4(a.data(), low, high);
+			return;
+		}
+	}
+
 	for(auto i = 0u; i < D; ++i) {
 		a[i] = std::clamp(a[i], low, high);
 	}
@@ -392,6 +420,13 @@ constexpr void clamp(Vec<D, T>& a, T low, T high) {
 
 template<size_t D, typename T>
 constexpr void clamp(Vec<D, T>& a, const Vec<D, T>& low, const Vec<D, T>& high) {
+	if constexpr(detail::simd::vec4<D, T>) {
+		if(!detail::constantEvaluated()) {
+			detail::simd::clamp4(a.data(), low.data(), high.data());
+			return;
+		}
+	}
+
 	for(auto i = 0u; i < D; ++i) {
 		a[i] = std::clamp(a[i], low[i], high[i]);
 	}
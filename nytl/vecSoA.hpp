@@ -0,0 +1,311 @@
+// Copyright (c) 2017-2020 nyorain
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+
+/// \file Defines the VecSoA structure-of-arrays container and bulk operations on it.
+
+#pragma once
+
+#ifndef NYTL_INCLUDE_VEC_SOA
+#define NYTL_INCLUDE_VEC_SOA
+
+#include <nytl/vec.hpp> // nytl::Vec
+#include <nytl/span.hpp> // nytl::span
+#include <nytl/simd.hpp> // nytl::detail::simd
+#include <nytl/tmpUtil.hpp> // nytl::NonDeduced
+
+#include <array> // std::array
+#include <vector> // std::vector
+#include <memory> // std::allocator
+#include <algorithm> // std::min
+#include <stdexcept> // std::invalid_argument
+#include <type_traits> // std::conditional_t
+#include <utility> // std::index_sequence
+
+namespace nytl {
+
+/// \brief Container of Vec<D, T> objects in structure-of-arrays layout.
+/// Instead of storing the vectors contiguously, each component is stored
+/// in its own contiguous lane, i.e. there is one array for all x values,
+/// one for all y values and so on. This makes processing many vectors
+/// at once (see the operations in namespace nytl::soa) way more efficient
+/// since it can be done lane-wise with SIMD instructions.
+/// Elements can be accessed as proxy objects that convert from and to Vec.
+/// \tparam D The dimension of the stored vectors.
+/// \tparam T The value type of the stored vectors.
+/// \tparam Alloc The allocator used for each lane.
+template<size_t D, typename T, typename Alloc = std::allocator<T>>
+class VecSoA {
+public:
+	using Value = Vec<D, T>;
+	using Lane = std::vector<T, Alloc>;
+
+	/// Proxy object referencing one vector in a VecSoA.
+	/// Can be converted to (and assigned from) a Vec.
+	template<bool Const>
+	class BasicReference {
+	public:
+		using Container = std::conditional_t<Const, const VecSoA, VecSoA>;
+
+	public:
+		BasicReference(Container& soa, size_t id) : soa_(&soa), id_(id) {}
+		BasicReference(const BasicReference&) = default;
+
+		/// Returns a reference to component i of the referenced vector.
+		auto& operator[](size_t i) const { return soa_->lanes_[i][id_]; }
+
+		operator Value() const { return soa_->get(id_); }
+
+		// Only valid for non-const references.
+		const BasicReference& operator=(const Value& vec) const {
+			soa_->set(id_, vec);
+			return *this;
+		}
+
+		// Assigns the referenced value. Needed since the implicitly
+		// defined copy assignment operator would rebind the reference.
+		const BasicReference& operator=(const BasicReference& other) const {
+			return (*this = Value(other));
+		}
+
+	protected:
+		Container* soa_;
+		size_t id_;
+	};
+
+	using Reference = BasicReference<false>;
+	using ConstReference = BasicReference<true>;
+
+public:
+	VecSoA() = default;
+	explicit VecSoA(const Alloc& alloc) : lanes_(makeLanes(alloc)) {}
+	explicit VecSoA(size_t size, const Value& value = {}, const Alloc& alloc = {}) :
+			lanes_(makeLanes(alloc)) {
+		resize(size, value);
+	}
+
+	VecSoA(span<const Value> values, const Alloc& alloc = {}) :
+			lanes_(makeLanes(alloc)) {
+		reserve(values.size());
+		for(auto& val : values) {
+			push_back(val);
+		}
+	}
+
+	/// The number of stored vectors.
+	size_t size() const { return lanes_[0].size(); }
+	bool empty() const { return lanes_[0].empty(); }
+
+	void resize(size_t size, const Value& value = {}) {
+		for(auto c = 0u; c < D; ++c) {
+			lanes_[c].resize(size, value[c]);
+		}
+	}
+
+	void reserve(size_t size) {
+		for(auto& lane : lanes_) {
+			lane.reserve(size);
+		}
+	}
+
+	void clear() noexcept {
+		for(auto& lane : lanes_) {
+			lane.clear();
+		}
+	}
+
+	void push_back(const Value& value) {
+		for(auto c = 0u; c < D; ++c) {
+			lanes_[c].push_back(value[c]);
+		}
+	}
+
+	void pop_back() {
+		for(auto& lane : lanes_) {
+			lane.pop_back();
+		}
+	}
+
+	/// Returns (a copy of) the vector with the given index.
+	Value get(size_t i) const {
+		Value ret {};
+		for(auto c = 0u; c < D; ++c) {
+			ret[c] = lanes_[c][i];
+		}
+		return ret;
+	}
+
+	/// Sets the vector with the given index.
+	void set(size_t i, const Value& value) {
+		for(auto c = 0u; c < D; ++c) {
+			lanes_[c][i] = value[c];
+		}
+	}
+
+	Reference operator[](size_t i) { return {*this, i}; }
+	ConstReference operator[](size_t i) const { return {*this, i}; }
+
+	/// Returns the contiguous lane holding component c of all vectors.
+	span<T> lane(size_t c) { return lanes_[c]; }
+	span<const T> lane(size_t c) const { return lanes_[c]; }
+
+	/// Writes all stored vectors (in AoS form) into the given span,
+	/// which must have the same size as this container.
+	/// Throws std::invalid_argument if the sizes don't match.
+	void copyTo(span<Value> out) const {
+		if(size_t(out.size()) != size()) {
+			throw std::invalid_argument("nytl::VecSoA::copyTo: size mismatch");
+		}
+
+		for(auto i = 0u; i < size(); ++i) {
+			out[i] = get(i);
+		}
+	}
+
+protected:
+	static std::array<Lane, D> makeLanes(const Alloc& alloc) {
+		return makeLanes(alloc, std::make_index_sequence<D>());
+	}
+
+	template<size_t... I>
+	static std::array<Lane, D> makeLanes(const Alloc& alloc, std::index_sequence<I...>) {
+		return {{((void) I, Lane(alloc))...}};
+	}
+
+	std::array<Lane, D> lanes_ {};
+};
+
+/// Bulk operations on VecSoA objects.
+/// They have the same semantics as the similar named operations in vec.hpp
+/// and vecOps.hpp but are applied on all stored vectors.
+/// Operations with a VecSoA as first parameter modify it in place.
+/// Operations involving multiple containers (or spans) throw
+/// std::invalid_argument if they don't have matching sizes.
+namespace soa {
+namespace detail {
+	template<typename... S>
+	void checkSizes(const char* func, size_t size, const S&... others) {
+		if(((others.size() != size) || ...)) {
+			throw std::invalid_argument(func);
+		}
+	}
+
+	// Number of elements of temporary per-vector values
+	// we compute on the stack in one iteration.
+	constexpr auto blockSize = 256u;
+} // namespace detail
+
+/// a[i] += b[i]
+template<size_t D, typename T, typename A1, typename A2>
+void add(VecSoA<D, T, A1>& a, const VecSoA<D, T, A2>& b) {
+	detail::checkSizes("nytl::soa::add", a.size(), b);
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::addN(a.lane(c).data(), b.lane(c).data(), a.size());
+	}
+}
+
+/// a[i] -= b[i]
+template<size_t D, typename T, typename A1, typename A2>
+void sub(VecSoA<D, T, A1>& a, const VecSoA<D, T, A2>& b) {
+	detail::checkSizes("nytl::soa::sub", a.size(), b);
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::subN(a.lane(c).data(), b.lane(c).data(), a.size());
+	}
+}
+
+/// a[i] *= fac
+template<size_t D, typename T, typename A>
+void scale(VecSoA<D, T, A>& a, T fac) {
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::scaleN(a.lane(c).data(), fac, a.size());
+	}
+}
+
+/// out[i] = dot(a[i], b[i])
+template<size_t D, typename T, typename A1, typename A2>
+void dot(const VecSoA<D, T, A1>& a, const VecSoA<D, T, A2>& b, span<NonDeduced<T>> out) {
+	detail::checkSizes("nytl::soa::dot", a.size(), b, out);
+	std::fill(out.begin(), out.end(), T {0});
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::mulAddN(out.data(),
+			a.lane(c).data(), b.lane(c).data(), a.size());
+	}
+}
+
+/// out[i] = length(a[i])
+template<size_t D, typename T, typename A>
+void length(const VecSoA<D, T, A>& a, span<NonDeduced<T>> out) {
+	dot(a, a, out);
+	nytl::detail::simd::sqrtN(out.data(), out.size());
+}
+
+/// a[i] = normalized(a[i])
+/// Undefined for null vectors.
+template<size_t D, typename T, typename A>
+void normalize(VecSoA<D, T, A>& a) {
+	T facs[detail::blockSize];
+	for(auto off = 0u; off < a.size(); off += detail::blockSize) {
+		auto count = std::min<size_t>(detail::blockSize, a.size() - off);
+		std::fill(facs, facs + count, T {0});
+		for(auto c = 0u; c < D; ++c) {
+			auto lane = a.lane(c).data() + off;
+			nytl::detail::simd::mulAddN(facs, lane, lane, count);
+		}
+
+		nytl::detail::simd::sqrtN(facs, count);
+		nytl::detail::simd::invN(facs, T {1}, count);
+		for(auto c = 0u; c < D; ++c) {
+			nytl::detail::simd::mulN(a.lane(c).data() + off, facs, count);
+		}
+	}
+}
+
+/// a[i] = vec::cw::max(a[i], b[i])
+template<size_t D, typename T, typename A1, typename A2>
+void max(VecSoA<D, T, A1>& a, const VecSoA<D, T, A2>& b) {
+	detail::checkSizes("nytl::soa::max", a.size(), b);
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::maxN(a.lane(c).data(), b.lane(c).data(), a.size());
+	}
+}
+
+/// a[i] = vec::cw::min(a[i], b[i])
+template<size_t D, typename T, typename A1, typename A2>
+void min(VecSoA<D, T, A1>& a, const VecSoA<D, T, A2>& b) {
+	detail::checkSizes("nytl::soa::min", a.size(), b);
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::minN(a.lane(c).data(), b.lane(c).data(), a.size());
+	}
+}
+
+/// a[i] = vec::cw::clamp(a[i], low, high)
+template<size_t D, typename T, typename A>
+void clamp(VecSoA<D, T, A>& a, T low, T high) {
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::clampN(a.lane(c).data(), low, high, a.size());
+	}
+}
+
+/// a[i] = vec::cw::clamp(a[i], low, high)
+template<size_t D, typename T, typename A>
+void clamp(VecSoA<D, T, A>& a, const Vec<D, T>& low, const Vec<D, T>& high) {
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::clampN(a.lane(c).data(), low[c], high[c], a.size());
+	}
+}
+
+/// a[i] = vec::cw::clamp(a[i], low[i], high[i])
+template<size_t D, typename T, typename A1, typename A2, typename A3>
+void clamp(VecSoA<D, T, A1>& a, const VecSoA<D, T, A2>& low,
+		const VecSoA<D, T, A3>& high) {
+	detail::checkSizes("nytl::soa::clamp", a.size(), low, high);
+	for(auto c = 0u; c < D; ++c) {
+		nytl::detail::simd::clampN(a.lane(c).data(),
+			low.lane(c).data(), high.lane(c).data(), a.size());
+	}
+}
+
+} // namespace soa
+} // namespace nytl
+
+#endif // header guard